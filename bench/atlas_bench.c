@@ -0,0 +1,152 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_CreateWindow, SDL_CreateRenderer, SDL_CreateTexture, SDL_GetNumRenderDrivers, SDL_GetRenderDriverInfo
+#include <stdio.h> // printf, snprintf
+#include "../constants/color_theme.c" // text_cursor_color, selection_color, scrollbar_color (used by the renderer)
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/element_tree.c" // ElementTree, new_element_tree, add_new_element, free_textures
+#include "../include/font.c" // init_fonts, close_fonts
+#include "../include/glyph_atlas.c" // init_glyph_atlas, close_glyph_atlas
+#include "../include/layout.c" // set_dimensions
+#include "../include/renderer.c" // render_element_tree
+#include "../include/string.c" // to_s8
+#include "../include/types.c" // i32, i64, u64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Draws a grid of text labels whose text changes every frame, like a dashboard of counters, first by rasterizing each label into its own texture and then from the glyph atlas. The frames where every label changes and the frames where none does are timed separately, and the texture memory held by the labels (and by the atlas) is printed for both paths after each. The atlas only draws labels whose text changed, so in the first unchanged frame the labels are rasterized into their textures, which are copied after that. The atlas is enabled with init_glyph_atlas on every renderer, although apps only enable it on accelerated ones (init_accelerated_glyph_atlas). The bench runs once per available render driver, so the software renderer is always measured and an accelerated renderer when there is one. Run from the repository root so that the fonts are found. Use SDL_VIDEODRIVER=dummy to run without a display, which leaves only the software renderer.
+
+*/
+
+#define LABEL_COLUMNS 6
+#define LABEL_ROWS 30
+#define LABEL_COUNT (LABEL_COLUMNS * LABEL_ROWS)
+#define FRAMES 200
+
+char label_text[LABEL_COUNT][32];
+
+// Returns the bytes of the label textures, at four bytes per pixel
+i64 get_texture_bytes(Element **labels) {
+  i64 bytes = 0;
+  for (i32 i = 0; i < LABEL_COUNT; i++) {
+    if (labels[i]->render.texture != 0) {
+      bytes += (i64)labels[i]->render.width * labels[i]->render.height * 4;
+    }
+  }
+  return bytes;
+}
+
+// Builds the label grid and draws it for a number of frames, changing every label each frame
+void run_case(Arena *bench_arena, SDL_Renderer *renderer, char *renderer_name, bool use_atlas, i32 window_width, i32 window_height) {
+  if (use_atlas && !init_glyph_atlas(renderer)) return;
+  Arena *element_arena = arena_open(4096);
+  ElementTree *tree = new_element_tree(element_arena);
+  tree->target_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+  tree->size = (TreeSize){
+    .width = window_width,
+    .height = window_height,
+  };
+  Element *grid = add_new_element(tree->arena, tree->root);
+  *grid = (Element){
+    .layout_direction = layout_direction.vertical,
+    .padding = (Padding){10, 10, 10, 10},
+  };
+  Element *labels[LABEL_COUNT];
+  for (i32 row = 0; row < LABEL_ROWS; row++) {
+    Element *row_element = add_new_element(tree->arena, grid);
+    *row_element = (Element){
+      .layout_direction = layout_direction.horizontal,
+    };
+    for (i32 column = 0; column < LABEL_COLUMNS; column++) {
+      i32 i = row * LABEL_COLUMNS + column;
+      labels[i] = add_new_element(tree->arena, row_element);
+      snprintf(label_text[i], 32, "Value %d", i);
+      *labels[i] = (Element){
+        .width = 100,
+        .height = 20,
+        .text = to_s8(label_text[i]),
+      };
+    }
+  }
+  set_dimensions(tree);
+
+  SDL_SetRenderTarget(renderer, tree->target_texture);
+  render_element_tree(renderer, tree);
+  char *path_name = use_atlas ? "glyph atlas" : "element textures";
+  // The samples keep a pointer to their name
+  char *changing_name = arena_fill(bench_arena, 64);
+  char *unchanged_name = arena_fill(bench_arena, 64);
+  snprintf(changing_name, 64, "%s, %s", renderer_name, path_name);
+  snprintf(unchanged_name, 64, "%s, %s, unchanged", renderer_name, path_name);
+  BenchSamples *changing_samples = new_bench_samples(bench_arena, changing_name);
+  for (i32 frame = 0; frame < FRAMES; frame++) {
+    for (i32 i = 0; i < LABEL_COUNT; i++) {
+      snprintf(label_text[i], 32, "Value %d", i * FRAMES + frame);
+      labels[i]->text = to_s8(label_text[i]);
+      labels[i]->changed = true;
+    }
+    u64 start = bench_start();
+    render_element_tree(renderer, tree);
+    SDL_RenderPresent(renderer);
+    bench_stop(changing_samples, start);
+  }
+  i64 changing_bytes = get_texture_bytes(labels);
+  // Frames where no label changes, so element textures are only copied
+  BenchSamples *unchanged_samples = new_bench_samples(bench_arena, unchanged_name);
+  for (i32 frame = 0; frame < FRAMES; frame++) {
+    u64 start = bench_start();
+    render_element_tree(renderer, tree);
+    SDL_RenderPresent(renderer);
+    bench_stop(unchanged_samples, start);
+  }
+  print_bench_samples(changing_samples);
+  print_bench_samples(unchanged_samples);
+  i64 atlas_bytes = use_atlas ? GLYPH_ATLAS_SIZE * GLYPH_ATLAS_SIZE * 4 : 0;
+  printf("%s, %s: %lld KB of label textures while changing and %lld KB when unchanged, %lld KB of atlas texture\n", renderer_name, path_name,
+         (long long)changing_bytes / 1024, (long long)get_texture_bytes(labels) / 1024, (long long)atlas_bytes / 1024);
+
+  free_textures(tree->root);
+  SDL_DestroyTexture(tree->target_texture);
+  arena_close(element_arena);
+  close_glyph_atlas();
+}
+
+i32 main() {
+  i32 window_width = 640;
+  i32 window_height = 640;
+
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Window *window = SDL_CreateWindow("Atlas bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_HIDDEN);
+  if (!window) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *bench_arena = arena_open(4096);
+  printf("%d labels changing every frame, window %d x %d\n", LABEL_COUNT, window_width, window_height);
+
+  for (i32 driver = 0; driver < SDL_GetNumRenderDrivers(); driver++) {
+    SDL_RendererInfo info;
+    if (SDL_GetRenderDriverInfo(driver, &info) != 0) continue;
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, driver, 0);
+    if (!renderer) {
+      printf("%s renderer not available: %s\n", info.name, SDL_GetError());
+      continue;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_GetRendererInfo(renderer, &info);
+    bool accelerated = (info.flags & SDL_RENDERER_ACCELERATED) != 0;
+    printf("%s renderer (%s)\n", info.name, accelerated ? "accelerated" : "software");
+    run_case(bench_arena, renderer, (char *)info.name, false, window_width, window_height);
+    run_case(bench_arena, renderer, (char *)info.name, true, window_width, window_height);
+    SDL_DestroyRenderer(renderer);
+  }
+
+  arena_close(bench_arena);
+  close_fonts();
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
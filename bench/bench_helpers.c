@@ -0,0 +1,168 @@
+#ifndef C9_BENCH_HELPERS
+
+#include <SDL2/SDL.h> // SDL_GetPerformanceCounter, SDL_GetPerformanceFrequency
+#include <stdbool.h> // bool
+#include <stdio.h> // printf
+#include <stdlib.h> // qsort
+#include "../include/arena.c" // Arena
+#include "../include/array.c" // Array, array_create, array_push, array_get, array_length
+#include "../include/types.c" // i32, u8, u64, f64
+
+/*
+
+Bench helpers time repeated runs of a piece of code and print the mean and percentiles of the samples in milliseconds. Samples are stored in an arena array so that no allocation is done while timing. Results can be printed as aligned text, or as CSV or JSON rows for scripts.
+
+```c
+BenchSamples *samples = new_bench_samples(arena, "scroll");
+for (i32 i = 0; i < 1000; i++) {
+  u64 start = bench_start();
+  do_work();
+  bench_stop(samples, start);
+}
+print_bench_samples(samples);
+print_bench_csv_header();
+print_bench_csv(samples, "case name");
+```
+
+*/
+
+typedef struct {
+  char *name;
+  Array *times; // Sample times in milliseconds (f64)
+} BenchSamples;
+
+typedef struct {
+  i32 count;
+  f64 mean;
+  f64 min;
+  f64 p50;
+  f64 p95;
+  f64 p99;
+  f64 max;
+} BenchSummary;
+
+typedef struct {
+  u8 text;
+  u8 csv;
+  u8 json;
+} BenchFormats;
+
+BenchFormats bench_format = {
+  .text = 0,
+  .csv = 1,
+  .json = 2,
+};
+
+BenchSamples *new_bench_samples(Arena *arena, char *name) {
+  BenchSamples *samples = arena_fill(arena, sizeof(BenchSamples));
+  *samples = (BenchSamples){
+    .name = name,
+    .times = array_create(arena, sizeof(f64)),
+  };
+  return samples;
+}
+
+// Returns the current time in performance counter ticks
+u64 bench_start(void) {
+  return SDL_GetPerformanceCounter();
+}
+
+// Returns the milliseconds passed since start
+f64 bench_elapsed(u64 start) {
+  return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+// Adds the milliseconds passed since start as a sample and returns them
+f64 bench_stop(BenchSamples *samples, u64 start) {
+  f64 elapsed = bench_elapsed(start);
+  array_push(samples->times, &elapsed);
+  return elapsed;
+}
+
+static i32 compare_f64(const void *a, const void *b) {
+  f64 left = *(const f64 *)a;
+  f64 right = *(const f64 *)b;
+  return (left > right) - (left < right);
+}
+
+// Returns the value at percentile (0-100) of the sorted values
+static f64 sorted_percentile(f64 *sorted, i32 count, f64 percentile) {
+  if (count == 0) return 0;
+  i32 index = (i32)(percentile / 100.0 * (count - 1) + 0.5);
+  return sorted[index];
+}
+
+// Returns the sample count, mean, min, median, p95, p99 and max of the samples
+BenchSummary summarize_bench_samples(BenchSamples *samples) {
+  BenchSummary summary = {0};
+  i32 count = array_length(samples->times);
+  if (count == 0) return summary;
+  f64 *sorted = malloc(count * sizeof(f64));
+  if (sorted == 0) return summary;
+  f64 total = 0;
+  for (i32 i = 0; i < count; i++) {
+    sorted[i] = *(f64 *)array_get(samples->times, i);
+    total += sorted[i];
+  }
+  qsort(sorted, count, sizeof(f64), compare_f64);
+  summary = (BenchSummary){
+    .count = count,
+    .mean = total / count,
+    .min = sorted[0],
+    .p50 = sorted_percentile(sorted, count, 50),
+    .p95 = sorted_percentile(sorted, count, 95),
+    .p99 = sorted_percentile(sorted, count, 99),
+    .max = sorted[count - 1],
+  };
+  free(sorted);
+  return summary;
+}
+
+// Prints the sample count, mean, median, p95, p99 and max of the samples
+void print_bench_samples(BenchSamples *samples) {
+  BenchSummary summary = summarize_bench_samples(samples);
+  if (summary.count == 0) {
+    printf("%-24s no samples\n", samples->name);
+    return;
+  }
+  printf("%-24s n=%-6d mean=%9.3fms p50=%9.3fms p95=%9.3fms p99=%9.3fms max=%9.3fms\n",
+         samples->name, summary.count, summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+// Prints the mean time of the samples as millions of units per second, where a unit is a byte or a pixel of the timed run
+void print_throughput(BenchSamples *samples, i32 unit_count) {
+  BenchSummary summary = summarize_bench_samples(samples);
+  printf("%-24s %8.2f M/s\n", samples->name, unit_count / 1000000.0 / (summary.mean / 1000.0));
+}
+
+void print_bench_csv_header(void) {
+  printf("case,name,count,mean_ms,min_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+}
+
+// Prints the summary of the samples as a CSV row
+void print_bench_csv(BenchSamples *samples, char *case_name) {
+  BenchSummary summary = summarize_bench_samples(samples);
+  printf("%s,%s,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+         case_name, samples->name, summary.count, summary.mean, summary.min, summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+// Prints the summary of the samples as a JSON object, preceded by a comma unless it is the first object in a list
+void print_bench_json(BenchSamples *samples, char *case_name, bool first) {
+  BenchSummary summary = summarize_bench_samples(samples);
+  printf("%s\n  {\"case\": \"%s\", \"name\": \"%s\", \"count\": %d, \"mean_ms\": %.6f, \"min_ms\": %.6f, \"p50_ms\": %.6f, \"p95_ms\": %.6f, \"p99_ms\": %.6f, \"max_ms\": %.6f}",
+         first ? "" : ",", case_name, samples->name, summary.count, summary.mean, summary.min, summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+// Prints the samples in the given bench_format
+void print_bench_result(BenchSamples *samples, char *case_name, u8 format, bool first) {
+  if (format == bench_format.csv) {
+    print_bench_csv(samples, case_name);
+  } else if (format == bench_format.json) {
+    print_bench_json(samples, case_name, first);
+  } else {
+    print_bench_samples(samples);
+  }
+}
+
+#define C9_BENCH_HELPERS
+#endif
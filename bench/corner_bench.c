@@ -0,0 +1,106 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf, snprintf
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/color.c" // RGBA, C9_Gradient
+#include "../include/corner_mask.c" // clear_corner_masks
+#include "../include/draw_shapes.c" // PixelData, draw_filled_rectangle, draw_rectangle_with_border, draw_horizontal_gradient_rectangle_with_border, draw_vertical_gradient_rectangle
+#include "../include/types.c" // i32, u64
+#include "../include/types_common.c" // Border
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Repaints 10k rounded cards with the corner radii of the theme (15 and 25), like a long list of cards being repainted on hover. The cases draw plain cards, cards with a border, and cards with a horizontal or vertical gradient, with the corner masks cached and with the masks cleared before every card (which computes the corners from the superellipse formula every time, like before the cache). A checksum of the target is printed so that the pixels of both can be compared, also with older versions.
+
+*/
+
+#define CARDS 10000
+#define CARD_WIDTH 200
+#define CARD_HEIGHT 80
+#define TARGET_WIDTH 1000
+#define TARGET_HEIGHT 800
+
+typedef enum {
+  FILLED,
+  BORDER,
+  HORIZONTAL_GRADIENT,
+  VERTICAL_GRADIENT,
+} CardKind;
+
+// Returns a checksum of the pixels of the target
+u64 get_pixel_checksum(PixelData target) {
+  u64 checksum = 0;
+  for (i32 i = 0; i < target.width * target.height; i++) {
+    checksum = checksum * 31 + target.pixels[i];
+  }
+  return checksum;
+}
+
+void draw_card(PixelData target, CardKind kind, i32 index) {
+  // Cards are laid out in a grid and alternate between the two radii of the theme
+  i32 columns = TARGET_WIDTH / CARD_WIDTH;
+  i32 rows = TARGET_HEIGHT / CARD_HEIGHT;
+  SDL_Rect card = {
+    .x = (index % columns) * CARD_WIDTH,
+    .y = (index / columns % rows) * CARD_HEIGHT,
+    .w = CARD_WIDTH,
+    .h = CARD_HEIGHT,
+  };
+  i32 corner_radius = index % 2 == 0 ? 15 : 25;
+  Border border = {1, 1, 1, 1};
+  C9_Gradient gradient = {.start_color = 0x78C8FFFF, .end_color = 0xC896FFFF, .start_at = 0.0, .end_at = 1.0};
+  if (kind == FILLED) {
+    draw_filled_rectangle(target, card, corner_radius, 0xF0F0F5FF);
+  } else if (kind == BORDER) {
+    draw_rectangle_with_border(target, card, corner_radius, border, 0xC8C8D2FF, 0xFFFFFFFF);
+  } else if (kind == HORIZONTAL_GRADIENT) {
+    draw_horizontal_gradient_rectangle_with_border(target, card, corner_radius, border, 0xC8C8D2FF, gradient);
+  } else {
+    draw_vertical_gradient_rectangle(target, card, corner_radius, gradient);
+  }
+}
+
+void run_case(Arena *arena, PixelData target, CardKind kind, char *kind_name, bool cached) {
+  for (i32 i = 0; i < target.width * target.height; i++) {
+    target.pixels[i] = 0;
+  }
+  clear_corner_masks();
+  // The samples keep a pointer to their name
+  char *name = arena_fill(arena, 64);
+  snprintf(name, 64, "%s, %s", kind_name, cached ? "cached masks" : "no cache");
+  BenchSamples *samples = new_bench_samples(arena, name);
+  // Time batches of 100 cards, since one card is too short to time on its own
+  for (i32 batch = 0; batch < CARDS / 100; batch++) {
+    u64 start = bench_start();
+    for (i32 i = batch * 100; i < (batch + 1) * 100; i++) {
+      if (!cached) {
+        clear_corner_masks();
+      }
+      draw_card(target, kind, i);
+    }
+    bench_stop(samples, start);
+  }
+  print_bench_samples(samples);
+  printf("%-32s checksum %016llx\n", name, (unsigned long long)get_pixel_checksum(target));
+}
+
+i32 main() {
+  SDL_Init(0);
+  Arena *arena = arena_open(4096);
+  PixelData target = {
+    .pixels = arena_fill(arena, TARGET_WIDTH * TARGET_HEIGHT * sizeof(RGBA)),
+    .width = TARGET_WIDTH,
+    .height = TARGET_HEIGHT,
+  };
+  printf("%d cards of %d x %d per case, times are per 100 cards\n", CARDS, CARD_WIDTH, CARD_HEIGHT);
+  char *kind_names[] = {"filled", "border", "horizontal gradient", "vertical gradient"};
+  for (CardKind kind = FILLED; kind <= VERTICAL_GRADIENT; kind++) {
+    run_case(arena, target, kind, kind_names[kind], false);
+    run_case(arena, target, kind, kind_names[kind], true);
+  }
+
+  clear_corner_masks();
+  arena_close(arena);
+  SDL_Quit();
+  return 0;
+}
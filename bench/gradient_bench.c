@@ -0,0 +1,111 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf, snprintf
+#include <stdlib.h> // abs
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/blue_noise.c" // get_blue_noise_value
+#include "../include/color.c" // RGBA, C9_Gradient, get_dither_spread, get_dithered_gradient_color, red, green, blue, alpha
+#include "../include/draw_shapes.c" // PixelData, draw_horizontal_gradient_rectangle, draw_vertical_gradient_rectangle
+#include "../include/types.c" // i32, u64, f32, f64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples, print_throughput
+
+/*
+
+Fills gradient rectangles of a card, a panel and a full window with draw_horizontal_gradient_rectangle and draw_vertical_gradient_rectangle, and with a float loop that calls get_dithered_gradient_color for every pixel, column by column for horizontal gradients like the drawing code did before gradient tables. The throughput of both is printed in megapixels per second, and the pixels are compared: how many differ from the float loop and by how many color levels at most.
+
+*/
+
+#define ITERATIONS 20
+
+typedef struct {
+  char *name;
+  i32 width;
+  i32 height;
+  C9_Gradient gradient;
+} GradientCase;
+
+// Fills the rectangle like the drawing code before gradient tables, with one float interpolation per pixel
+void fill_float_gradient(PixelData target, C9_Gradient gradient, bool horizontal) {
+  f32 dither_spread = get_dither_spread(gradient);
+  f32 one_percent_width = 1.0 / target.width;
+  f32 one_percent_height = 1.0 / target.height;
+  if (horizontal) {
+    for (i32 x = 0; x < target.width; x++) {
+      f32 percent = x * one_percent_width;
+      for (i32 y = 0; y < target.height; y++) {
+        f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
+        target.pixels[y * target.width + x] = get_dithered_gradient_color(gradient, percent, random_variation);
+      }
+    }
+  } else {
+    for (i32 y = 0; y < target.height; y++) {
+      f32 percent = y * one_percent_height;
+      for (i32 x = 0; x < target.width; x++) {
+        f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
+        target.pixels[y * target.width + x] = get_dithered_gradient_color(gradient, percent, random_variation);
+      }
+    }
+  }
+}
+
+void fill_table_gradient(PixelData target, C9_Gradient gradient, bool horizontal) {
+  SDL_Rect rectangle = {0, 0, target.width, target.height};
+  if (horizontal) {
+    draw_horizontal_gradient_rectangle(target, rectangle, 0, gradient);
+  } else {
+    draw_vertical_gradient_rectangle(target, rectangle, 0, gradient);
+  }
+}
+
+void run_case(Arena *arena, GradientCase gradient_case, bool horizontal) {
+  i32 pixel_count = gradient_case.width * gradient_case.height;
+  PixelData float_target = {arena_fill(arena, pixel_count * sizeof(RGBA)), gradient_case.width, gradient_case.height};
+  PixelData table_target = {arena_fill(arena, pixel_count * sizeof(RGBA)), gradient_case.width, gradient_case.height};
+  // The samples keep a pointer to their name
+  char *float_name = arena_fill(arena, 64);
+  char *table_name = arena_fill(arena, 64);
+  snprintf(float_name, 64, "%s %s, float", gradient_case.name, horizontal ? "horizontal" : "vertical");
+  snprintf(table_name, 64, "%s %s, table", gradient_case.name, horizontal ? "horizontal" : "vertical");
+  BenchSamples *float_samples = new_bench_samples(arena, float_name);
+  BenchSamples *table_samples = new_bench_samples(arena, table_name);
+  for (i32 iteration = 0; iteration < ITERATIONS; iteration++) {
+    u64 start = bench_start();
+    fill_float_gradient(float_target, gradient_case.gradient, horizontal);
+    bench_stop(float_samples, start);
+    start = bench_start();
+    fill_table_gradient(table_target, gradient_case.gradient, horizontal);
+    bench_stop(table_samples, start);
+  }
+  print_throughput(float_samples, pixel_count);
+  print_throughput(table_samples, pixel_count);
+
+  i32 different_pixels = 0;
+  i32 max_difference = 0;
+  for (i32 i = 0; i < pixel_count; i++) {
+    RGBA a = float_target.pixels[i];
+    RGBA b = table_target.pixels[i];
+    if (a == b) continue;
+    different_pixels++;
+    i32 differences[] = {abs(red(a) - red(b)), abs(green(a) - green(b)), abs(blue(a) - blue(b)), abs(alpha(a) - alpha(b))};
+    for (i32 channel = 0; channel < 4; channel++) {
+      if (differences[channel] > max_difference) max_difference = differences[channel];
+    }
+  }
+  printf("%-36s %.2f%% of pixels differ, by at most %d\n", table_name, 100.0 * different_pixels / pixel_count, max_difference);
+}
+
+i32 main(void) {
+  SDL_Init(0);
+  Arena *arena = arena_open(4096);
+  GradientCase cases[] = {
+    {"card", 200, 80, {.start_color = 0x78C8FFFF, .end_color = 0xC896FFFF, .start_at = 0.0, .end_at = 1.0}},
+    {"panel", 400, 600, {.start_color = 0x202838FF, .end_color = 0x303C50FF, .start_at = 0.0, .end_at = 1.0}},
+    {"window", 1280, 800, {.start_color = 0xFF8040FF, .end_color = 0x4080FFFF, .start_at = 0.2, .end_at = 0.8}},
+  };
+  for (i32 i = 0; i < (i32)(sizeof(cases) / sizeof(cases[0])); i++) {
+    run_case(arena, cases[i], true);
+    run_case(arena, cases[i], false);
+  }
+  arena_close(arena);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_CreateWindow, SDL_CreateRenderer, SDL_CreateTexture, SDL_RenderReadPixels
+#include <stdio.h> // printf, snprintf
+#include "../components/menu.c" // set_active_menu_element, reset_menu_elements
+#include "../constants/color_theme.c" // text_color, menu_active_color
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/element_tree.c" // ElementTree, new_element_tree, add_new_element, free_textures
+#include "../include/font.c" // init_fonts, close_fonts
+#include "../include/layout.c" // set_dimensions
+#include "../include/renderer.c" // render_element_tree
+#include "../include/string.c" // to_s8
+#include "../include/text_raster.c" // text_raster_cache, set_text_raster_cache_capacity, clear_text_raster_cache
+#include "../include/types.c" // i32, u32, u64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Repaints a side panel menu where one item at a time is active, like clicking through the menu of the demo. The active case calls set_active_menu_element and reset_menu_elements, which change the background, text color and font variant of two items per frame. The hover case only toggles the background of one item per frame. Both cases run with the text raster cache turned off and on, and a checksum of the last frame is printed so that the pixels of both can be compared. Most of a frame is spent copying element textures, so the text of a menu label and of a paragraph card is also repainted on its own, with draw_multiline_text and with draw_cached_text. Run from the repository root so that the fonts are found. Use SDL_VIDEODRIVER=dummy to run without a display.
+
+*/
+
+#define MENU_ITEMS 30
+#define FRAMES 300
+#define PAINT_ITERATIONS 2000
+#define CARD_WIDTH 400
+#define CARD_HEIGHT 200
+
+char menu_item_text[MENU_ITEMS][32];
+
+// Returns a checksum of the pixels of the render target
+u64 get_target_checksum(SDL_Renderer *renderer, i32 width, i32 height, u32 *pixels) {
+  SDL_RenderReadPixels(renderer, 0, SDL_PIXELFORMAT_RGBA8888, pixels, width * sizeof(u32));
+  u64 checksum = 0;
+  for (i32 i = 0; i < width * height; i++) {
+    checksum = checksum * 31 + pixels[i];
+  }
+  return checksum;
+}
+
+void run_case(Arena *bench_arena, SDL_Renderer *renderer, SDL_Texture *target_texture, bool hover, bool cached, i32 window_width, i32 window_height) {
+  set_text_raster_cache_capacity(cached ? TEXT_RASTER_CACHE_CAPACITY : 0);
+  clear_text_raster_cache();
+  Arena *element_arena = arena_open(4096);
+  ElementTree *tree = new_element_tree(element_arena);
+  tree->target_texture = target_texture;
+  tree->size = (TreeSize){
+    .width = window_width,
+    .height = window_height,
+  };
+  Element *side_panel = add_new_element(tree->arena, tree->root);
+  *side_panel = (Element){
+    .width = 200,
+    .layout_direction = layout_direction.vertical,
+    .padding = (Padding){10, 10, 10, 10},
+    .gutter = 5,
+  };
+  Element *items[MENU_ITEMS];
+  for (i32 i = 0; i < MENU_ITEMS; i++) {
+    items[i] = add_new_element(tree->arena, side_panel);
+    snprintf(menu_item_text[i], 32, "Menu item %d", i + 1);
+    *items[i] = (Element){
+      .background_type = background_type.none,
+      .background.color = menu_active_color,
+      .padding = (Padding){6, 10, 6, 10},
+      .corner_radius = 15,
+      .text = to_s8(menu_item_text[i]),
+      .text_color = text_color,
+    };
+  }
+  set_dimensions(tree);
+  SDL_SetRenderTarget(renderer, tree->target_texture);
+  render_element_tree(renderer, tree);
+
+  // The samples keep a pointer to their name
+  char *name = arena_fill(bench_arena, 64);
+  snprintf(name, 64, "%s, %s", hover ? "hover" : "active", cached ? "text raster cache" : "no cache");
+  BenchSamples *samples = new_bench_samples(bench_arena, name);
+  u64 hits = text_raster_cache.hits;
+  for (i32 frame = 0; frame < FRAMES; frame++) {
+    u64 start = bench_start();
+    Element *item = items[frame % MENU_ITEMS];
+    if (hover) {
+      item->background_type = item->background_type == background_type.none ? background_type.color : background_type.none;
+      item->changed = true;
+    } else {
+      reset_menu_elements(side_panel);
+      set_active_menu_element(item);
+    }
+    render_element_tree(renderer, tree);
+    SDL_RenderPresent(renderer);
+    bench_stop(samples, start);
+  }
+  print_bench_samples(samples);
+  u32 *pixels = arena_fill(bench_arena, window_width * window_height * sizeof(u32));
+  printf("%-24s %llu cache hits, checksum %016llx\n", name, (unsigned long long)(text_raster_cache.hits - hits),
+         (unsigned long long)get_target_checksum(renderer, window_width, window_height, pixels));
+
+  free_textures(tree->root);
+  arena_close(element_arena);
+}
+
+// Repaints the text of an element over its background, directly and from the text raster cache
+void run_paint_case(Arena *bench_arena, char *name, s8 text) {
+  set_text_raster_cache_capacity(TEXT_RASTER_CACHE_CAPACITY);
+  PixelData target = {
+    .pixels = arena_fill(bench_arena, CARD_WIDTH * CARD_HEIGHT * sizeof(RGBA)),
+    .width = CARD_WIDTH,
+    .height = CARD_HEIGHT,
+  };
+  Padding padding = {6, 10, 6, 10};
+  SDL_Rect text_position = {10, 6, CARD_WIDTH - 20, CARD_HEIGHT - 12};
+  for (i32 i = 0; i < CARD_WIDTH * CARD_HEIGHT; i++) {
+    target.pixels[i] = menu_active_color;
+  }
+  // Warm up the glyph cache and the text raster cache
+  draw_multiline_text(target, font_variant.regular, text, text_color, text_position, padding);
+  draw_cached_text(target, font_variant.regular, text, text_color, text_position, padding, true);
+  char *direct_name = arena_fill(bench_arena, 64);
+  char *cached_name = arena_fill(bench_arena, 64);
+  snprintf(direct_name, 64, "%s, direct", name);
+  snprintf(cached_name, 64, "%s, cached", name);
+  BenchSamples *direct_samples = new_bench_samples(bench_arena, direct_name);
+  BenchSamples *cached_samples = new_bench_samples(bench_arena, cached_name);
+  for (i32 i = 0; i < PAINT_ITERATIONS; i++) {
+    u64 start = bench_start();
+    draw_multiline_text(target, font_variant.regular, text, text_color, text_position, padding);
+    bench_stop(direct_samples, start);
+    start = bench_start();
+    draw_cached_text(target, font_variant.regular, text, text_color, text_position, padding, true);
+    bench_stop(cached_samples, start);
+  }
+  print_bench_samples(direct_samples);
+  print_bench_samples(cached_samples);
+}
+
+i32 main() {
+  i32 window_width = 640;
+  i32 window_height = 640;
+
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Window *window = SDL_CreateWindow("Hover bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_HIDDEN);
+  if (!window) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+  if (!renderer) {
+    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  if (init_fonts() == status.ERROR) return -1;
+  SDL_Texture *target_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+  Arena *bench_arena = arena_open(4096);
+
+  run_case(bench_arena, renderer, target_texture, false, false, window_width, window_height);
+  run_case(bench_arena, renderer, target_texture, false, true, window_width, window_height);
+  run_case(bench_arena, renderer, target_texture, true, false, window_width, window_height);
+  run_case(bench_arena, renderer, target_texture, true, true, window_width, window_height);
+  run_paint_case(bench_arena, "menu label", to_s8("Menu item 12"));
+  run_paint_case(bench_arena, "card", to_s8("Repainting a card should only blend the coverage of its text over the new background when the text, the font and the position are the same as the last time it was drawn, which is what happens when the pointer moves over it."));
+
+  arena_close(bench_arena);
+  SDL_DestroyTexture(target_texture);
+  close_fonts();
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
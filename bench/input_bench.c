@@ -0,0 +1,212 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_SetHint, SDL_Quit
+#include <stdio.h> // printf
+#include <string.h> // memcpy, strlen
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/array.c" // array_length, array_get, array_push
+#include "../include/element_tree.c" // Element, new_element, add_new_element, layout_direction
+#include "../include/font.c" // init_fonts, close_fonts
+#include "../include/input.c" // InputData, new_input
+#include "../include/input_actions.c" // handle_text_input, insert_text
+#include "../include/layout.c" // populate_input_text, set_root_element_dimensions
+#include "../include/types.c" // i32, u8, u64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples, summarize_bench_samples
+
+/*
+
+Measures the latency of a keystroke in a multiline input that holds a 100k line document. Every keystroke edits the text, wraps the input lines again (populate_input_text) and runs the layout of the tree, like input_handler does. Keystrokes are timed near the start, in the middle and at the end of the document. The same document is then joined into a single paragraph, where a keystroke in the middle should only wrap the lines around it: the bench fails if the median keystroke wraps more than MAX_REWRAPPED_LINES lines again. Words that move to the next line can move the words of all later lines, so some keystrokes wrap the rest of the paragraph. Run from the repository root so that the fonts are found. The SDL dummy video driver is used, so no display is needed.
+
+*/
+
+#define LINE_COUNT 100000
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 600
+#define ITERATIONS 20
+#define MAX_REWRAPPED_LINES 4
+
+char *line_texts[] = {
+  "A short line",
+  "Typing in a long document should only wrap the lines around the edit, so the time of a keystroke does not grow with the length of the document, and this line is long enough to be wrapped into two rows",
+  "",
+  "Another line with a few more words in it",
+};
+
+typedef struct {
+  char *name;
+  i32 line; // Line where the keystrokes are typed
+  char *text; // Text input sent for each keystroke
+} KeystrokeCase;
+
+// Returns the byte index of the start of a line in the document
+i32 get_line_start(s8 text, i32 line) {
+  i32 index = 0;
+  for (i32 i = 0; i < line && index < text.length; index++) {
+    if (text.data[index] == '\n') i++;
+  }
+  return index;
+}
+
+// Builds the document from a fixed set of lines, joined by the separator
+char *build_document(Arena *arena, char separator) {
+  i32 line_text_count = sizeof(line_texts) / sizeof(line_texts[0]);
+  i32 text_capacity = 1;
+  for (i32 i = 0; i < LINE_COUNT; i++) {
+    text_capacity += strlen(line_texts[i % line_text_count]) + 1;
+  }
+  char *document = arena_fill(arena, text_capacity);
+  i32 document_length = 0;
+  for (i32 i = 0; i < LINE_COUNT; i++) {
+    char *line = line_texts[i % line_text_count];
+    i32 line_length = strlen(line);
+    memcpy(document + document_length, line, line_length);
+    document_length += line_length;
+    if (i < LINE_COUNT - 1) {
+      document[document_length++] = separator;
+    }
+  }
+  document[document_length] = '\0';
+  return document;
+}
+
+// Returns the number of line elements that were changed since the flags were last cleared
+i32 count_changed_lines(Element *input_element, bool clear) {
+  i32 changed_count = 0;
+  for (i32 i = 0; i < array_length(input_element->children); i++) {
+    Element *line_element = array_get(input_element->children, i);
+    if (line_element->changed) {
+      changed_count++;
+    }
+    if (clear) {
+      line_element->changed = false;
+    }
+  }
+  return changed_count;
+}
+
+// Adds the number of rewrapped lines of a keystroke to the samples, which are not times here
+void add_rewrapped_count(BenchSamples *samples, i32 rewrapped_count) {
+  f64 count = rewrapped_count;
+  array_push(samples->times, &count);
+}
+
+// Prints the median and maximum number of rewrapped lines
+void print_rewrapped_counts(BenchSamples *samples) {
+  BenchSummary summary = summarize_bench_samples(samples);
+  printf("%-24s p50=%.0f max=%.0f\n", samples->name, summary.p50, summary.max);
+}
+
+// Types a keystroke and lays out the tree again. Returns the number of lines that were wrapped again.
+i32 time_keystroke(Arena *arena, Element *root, Element *input_element, char *text, BenchSamples *rewrap, BenchSamples *total) {
+  count_changed_lines(input_element, true);
+  u64 total_start = bench_start();
+  handle_text_input(input_element->input, text);
+  input_element->changed = true;
+  u64 start = bench_start();
+  populate_input_text(arena, root);
+  bench_stop(rewrap, start);
+  // Layout marks the lines below a new line as changed too
+  i32 rewrapped_count = count_changed_lines(input_element, false);
+  set_root_element_dimensions(root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  bench_stop(total, total_start);
+  return rewrapped_count;
+}
+
+i32 main(void) {
+  SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *arena = arena_open(1024 * 1024);
+
+  char *document = build_document(arena, '\n');
+  Element *root = new_element(arena);
+  root->layout_direction = layout_direction.vertical;
+  Element *input_element = add_new_element(arena, root);
+  *input_element = (Element){
+    .height = 500,
+    .padding = (Padding){5, 5, 5, 5},
+    .input = new_input(arena),
+  };
+  insert_text(input_element->input, document);
+
+  // The first layout sets the width of the input and the second wraps the lines at that width
+  u64 start = bench_start();
+  set_root_element_dimensions(root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  populate_input_text(arena, root);
+  set_root_element_dimensions(root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  input_element->changed = true;
+  populate_input_text(arena, root);
+  set_root_element_dimensions(root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  printf("%d lines wrapped into %d rows in %.3fms\n", LINE_COUNT, array_length(input_element->input->lines), bench_elapsed(start));
+
+  KeystrokeCase cases[] = {
+    {"type at start", 10, "a"},
+    {"type in middle", LINE_COUNT / 2, "a"},
+    {"type at end", LINE_COUNT - 1, "a"},
+    {"newline in middle", LINE_COUNT / 2 + 1, "\n"},
+    {"backspace in middle", LINE_COUNT / 2 + 5, "BACKSPACE"},
+  };
+  i32 case_count = sizeof(cases) / sizeof(cases[0]);
+  for (i32 case_index = 0; case_index < case_count; case_index++) {
+    KeystrokeCase keystroke = cases[case_index];
+    InputData *input = input_element->input;
+    // Place the caret a few bytes into the line of the case
+    i32 index = get_line_start(input->text, keystroke.line) + 5;
+    input->selection = (Selection){index, index};
+
+    BenchSamples *rewrap = new_bench_samples(arena, "rewrap");
+    BenchSamples *total = new_bench_samples(arena, "keystroke");
+    BenchSamples *rewrapped = new_bench_samples(arena, "rewrapped lines");
+    for (i32 i = 0; i < ITERATIONS; i++) {
+      add_rewrapped_count(rewrapped, time_keystroke(arena, root, input_element, keystroke.text, rewrap, total));
+    }
+    printf("%s (line %d)\n", keystroke.name, keystroke.line);
+    print_rewrapped_counts(rewrapped);
+    print_bench_samples(rewrap);
+    print_bench_samples(total);
+  }
+
+  // The same document as a single paragraph, in an input of its own
+  Element *paragraph_root = new_element(arena);
+  paragraph_root->layout_direction = layout_direction.vertical;
+  Element *paragraph_element = add_new_element(arena, paragraph_root);
+  *paragraph_element = (Element){
+    .height = 500,
+    .padding = (Padding){5, 5, 5, 5},
+    .input = new_input(arena),
+  };
+  insert_text(paragraph_element->input, build_document(arena, ' '));
+  start = bench_start();
+  set_root_element_dimensions(paragraph_root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  populate_input_text(arena, paragraph_root);
+  set_root_element_dimensions(paragraph_root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  paragraph_element->changed = true;
+  populate_input_text(arena, paragraph_root);
+  set_root_element_dimensions(paragraph_root, WINDOW_WIDTH, WINDOW_HEIGHT);
+  InputData *paragraph_input = paragraph_element->input;
+  printf("%d byte paragraph wrapped into %d rows in %.3fms\n", paragraph_input->text.length, array_length(paragraph_input->lines), bench_elapsed(start));
+
+  i32 index = paragraph_input->text.length / 2;
+  paragraph_input->selection = (Selection){index, index};
+  BenchSamples *rewrap = new_bench_samples(arena, "rewrap");
+  BenchSamples *total = new_bench_samples(arena, "keystroke");
+  BenchSamples *rewrapped = new_bench_samples(arena, "rewrapped lines");
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    add_rewrapped_count(rewrapped, time_keystroke(arena, paragraph_root, paragraph_element, "a", rewrap, total));
+  }
+  printf("type in middle of paragraph\n");
+  print_rewrapped_counts(rewrapped);
+  print_bench_samples(rewrap);
+  print_bench_samples(total);
+  // A keystroke can move words down to the end of the paragraph, but most keystrokes should stay on a few lines
+  if (summarize_bench_samples(rewrapped).p50 > MAX_REWRAPPED_LINES) {
+    printf("Expected a median of at most %d rewrapped lines\n", MAX_REWRAPPED_LINES);
+    return -1;
+  }
+
+  arena_close(arena);
+  close_fonts();
+  SDL_Quit();
+  return 0;
+}
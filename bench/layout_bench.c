@@ -0,0 +1,331 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_SetHint, SDL_Quit
+#include <stdbool.h> // bool
+#include <stdio.h> // printf, snprintf
+#include <string.h> // strcmp, strlen, memset
+#include <stdlib.h> // atoi
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/element_tree.c" // Element, new_element, add_new_element, layout_direction, overflow_type
+#include "../include/font.c" // init_fonts, close_fonts, font_variant
+#include "../include/input.c" // new_input
+#include "../include/input_actions.c" // insert_text
+#include "../include/layout.c" // populate_input_text, fill_max_dimensions, layout_virtual_lists, fill_scroll_dimensions, set_positions, set_root_element_dimensions
+#include "../include/string.c" // s8, to_s8
+#include "../include/types.c" // i32, u8, u64
+#include "../include/virtual_list.c" // refresh_virtual_list
+#include "../include/virtual_table.c" // VirtualTable, new_virtual_table, TABLE_HEADER_ROW
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_result
+
+/*
+
+Builds synthetic element trees and times each phase of the layout separately. The phases are the functions that set_root_element_dimensions calls, so the total is the time of populate_input_text and set_root_element_dimensions together. The trees are built once per case and the layout is then run repeatedly on the same tree. In the virtual_table case the rows get wider before every layout, so the layout fills the rows and then sets the maximum dimensions again (see virtual_list_resized). Run from the repository root so that the fonts are found. The SDL dummy video driver is used, so no display is needed.
+
+Usage: layout_bench [--csv | --json] [--iterations N] [--scale N]
+
+--scale multiplies the size of all generated trees.
+
+*/
+
+// Function pointer typedef for building a bench tree
+// The function takes the arena, the root element and the size of the tree
+typedef void (*BuildTree)(Arena *, Element *, i32);
+
+// Function pointer typedef for changing a bench tree before each layout, outside of the timed phases
+typedef void (*PrepareLayout)(Arena *);
+
+typedef struct {
+  char *name;
+  BuildTree build;
+  i32 size;
+  PrepareLayout prepare; // Optional
+} LayoutBenchCase;
+
+char *phase_names[] = {
+  "populate_input_text",
+  "fill_max_dimensions",
+  "layout_virtual_lists",
+  "fill_scroll_dimensions",
+  "set_positions",
+  "total",
+};
+#define PHASE_COUNT 6
+#define TEXT_SLOTS 256 // Must be larger than the number of materialized rows
+
+char *paragraph = "Layout has to wrap this paragraph into lines that fit the width of the card, which means measuring every word and breaking the text where the next word would overflow.";
+
+// A chain of elements that each hold the next one
+void build_deep_chain(Arena *arena, Element *root, i32 size) {
+  Element *parent = root;
+  for (i32 i = 0; i < size; i++) {
+    Element *child = add_new_element(arena, parent);
+    *child = (Element){
+      .padding = (Padding){1, 1, 1, 1},
+      .layout_direction = i % 2 == 0 ? layout_direction.vertical : layout_direction.horizontal,
+    };
+    parent = child;
+  }
+  parent->text = to_s8("Leaf");
+}
+
+// A scrolled list of single line text elements
+void build_wide_list(Arena *arena, Element *root, i32 size) {
+  Element *list = add_new_element(arena, root);
+  *list = (Element){
+    .overflow = overflow_type.scroll_y,
+    .layout_direction = layout_direction.vertical,
+    .padding = (Padding){10, 10, 10, 10},
+    .gutter = 2,
+  };
+  for (i32 i = 0; i < size; i++) {
+    Element *item = add_new_element(arena, list);
+    *item = (Element){
+      .height = 20,
+      .text = to_s8(i % 2 == 0 ? "List item" : "Another list item"),
+    };
+  }
+}
+
+// Rows of cells that each hold a small grid of their own
+void build_nested_grid(Arena *arena, Element *root, i32 size) {
+  Element *grid = add_new_element(arena, root);
+  *grid = (Element){
+    .overflow = overflow_type.scroll,
+    .layout_direction = layout_direction.vertical,
+    .gutter = 4,
+  };
+  for (i32 row_index = 0; row_index < size; row_index++) {
+    Element *row = add_new_element(arena, grid);
+    *row = (Element){.gutter = 4, .height = 60};
+    for (i32 column_index = 0; column_index < 10; column_index++) {
+      Element *cell = add_new_element(arena, row);
+      *cell = (Element){
+        .width = 60,
+        .layout_direction = layout_direction.vertical,
+        .padding = (Padding){2, 2, 2, 2},
+        .gutter = 1,
+      };
+      for (i32 inner_row_index = 0; inner_row_index < 3; inner_row_index++) {
+        Element *inner_row = add_new_element(arena, cell);
+        for (i32 inner_column_index = 0; inner_column_index < 3; inner_column_index++) {
+          add_new_element(arena, inner_row);
+        }
+      }
+    }
+  }
+}
+
+// Cards with a title and a paragraph that has to be wrapped
+void build_text_cards(Arena *arena, Element *root, i32 size) {
+  Element *list = add_new_element(arena, root);
+  *list = (Element){
+    .overflow = overflow_type.scroll_y,
+    .layout_direction = layout_direction.vertical,
+    .padding = (Padding){10, 10, 10, 10},
+    .gutter = 10,
+  };
+  for (i32 i = 0; i < size; i++) {
+    Element *card = add_new_element(arena, list);
+    *card = (Element){
+      .padding = (Padding){10, 10, 10, 10},
+      .layout_direction = layout_direction.vertical,
+      .gutter = 5,
+    };
+    Element *title = add_new_element(arena, card);
+    *title = (Element){
+      .text = to_s8("Card title"),
+      .font_variant = font_variant.large,
+    };
+    Element *text = add_new_element(arena, card);
+    *text = (Element){
+      .text = to_s8(paragraph),
+    };
+  }
+}
+
+// A column major table like the table component
+void build_table(Arena *arena, Element *root, i32 size) {
+  Element *table = add_new_element(arena, root);
+  *table = (Element){
+    .layout_direction = layout_direction.horizontal,
+    .overflow = overflow_type.scroll,
+    .padding = (Padding){10, 10, 10, 10},
+    .gutter = 10,
+  };
+  char *column_texts[] = {"u8", "element_tag", "id or group id", "InputData*", "text input object"};
+  for (i32 column_index = 0; column_index < 5; column_index++) {
+    Element *column = add_new_element(arena, table);
+    column->layout_direction = layout_direction.vertical;
+    for (i32 row_index = 0; row_index < size; row_index++) {
+      Element *cell = add_new_element(arena, column);
+      *cell = (Element){
+        .text = to_s8(column_texts[column_index]),
+        .padding = (Padding){6, 10, 6, 10},
+      };
+    }
+  }
+}
+
+// Multiline inputs with long text
+void build_long_inputs(Arena *arena, Element *root, i32 size) {
+  Element *list = add_new_element(arena, root);
+  *list = (Element){
+    .overflow = overflow_type.scroll_y,
+    .layout_direction = layout_direction.vertical,
+    .gutter = 10,
+  };
+  for (i32 i = 0; i < 4; i++) {
+    Element *input = add_new_element(arena, list);
+    *input = (Element){
+      .height = 300,
+      .padding = (Padding){5, 5, 5, 5},
+      .input = new_input(arena),
+    };
+    for (i32 j = 0; j < size; j++) {
+      insert_text(input->input, paragraph);
+      if (j % 4 == 3) {
+        insert_text(input->input, "\n");
+      }
+    }
+  }
+}
+
+VirtualTable *bench_table = 0;
+char *bench_comment = "needs review"; // Text of the comment column, made longer before every layout
+char cell_text[TEXT_SLOTS][32]; // Id text per visible row slot, so it stays valid while the row is shown
+
+s8 get_bench_cell_text(i32 row, i32 column) {
+  if (row == TABLE_HEADER_ROW) {
+    return to_s8(column == 0 ? "Id" : column == 1 ? "Name" : "Comment");
+  }
+  if (column == 0) {
+    char *text = cell_text[row % TEXT_SLOTS];
+    snprintf(text, 32, "%d", row);
+    return to_s8(text);
+  }
+  return to_s8(column == 1 ? "List item" : bench_comment);
+}
+
+// A virtual table whose comment column widens on every layout
+void build_virtual_table(Arena *arena, Element *root, i32 size) {
+  Element *parent = add_new_element(arena, root);
+  bench_table = new_virtual_table(arena, parent, size, 3, &get_bench_cell_text);
+}
+
+// Makes the comment one character longer and refills the rows, so that the next layout widens the comment column
+void widen_virtual_table(Arena *arena) {
+  i32 length = strlen(bench_comment) + 1;
+  char *comment = arena_fill(arena, length + 1);
+  memset(comment, 'w', length);
+  comment[length] = '\0';
+  bench_comment = comment;
+  refresh_virtual_list(bench_table->list->virtual_list);
+}
+
+// Runs the layout phases of set_root_element_dimensions one by one and times them
+void time_layout(Arena *arena, Element *root, i32 width, i32 height, BenchSamples **phases) {
+  u64 total_start = bench_start();
+  u64 start = bench_start();
+  populate_input_text(arena, root);
+  bench_stop(phases[0], start);
+  start = bench_start();
+  fill_max_dimensions(root, width, height);
+  bench_stop(phases[1], start);
+  start = bench_start();
+  layout_virtual_lists(root, width, height);
+  bench_stop(phases[2], start);
+  start = bench_start();
+  fill_scroll_dimensions(root);
+  bench_stop(phases[3], start);
+  start = bench_start();
+  set_positions(root);
+  bench_stop(phases[4], start);
+  bench_stop(phases[5], total_start);
+}
+
+i32 main(i32 argc, char **argv) {
+  u8 format = bench_format.text;
+  i32 iterations = 20;
+  i32 scale = 1;
+  for (i32 i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      format = bench_format.csv;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      format = bench_format.json;
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+      scale = atoi(argv[++i]);
+    }
+  }
+  if (iterations < 1) iterations = 1;
+  if (scale < 1) scale = 1;
+
+  // Layout does not draw anything, so the dummy driver is enough
+  SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+
+  LayoutBenchCase cases[] = {
+    {"deep_chain", &build_deep_chain, 500 * scale, 0},
+    {"wide_list", &build_wide_list, 10000 * scale, 0},
+    {"nested_grid", &build_nested_grid, 100 * scale, 0},
+    {"text_cards", &build_text_cards, 500 * scale, 0},
+    {"table", &build_table, 1000 * scale, 0},
+    {"long_inputs", &build_long_inputs, 25 * scale, 0},
+    {"virtual_table", &build_virtual_table, 100000 * scale, &widen_virtual_table},
+  };
+  i32 case_count = sizeof(cases) / sizeof(cases[0]);
+  i32 window_width = 800;
+  i32 window_height = 600;
+
+  if (format == bench_format.csv) {
+    print_bench_csv_header();
+  } else if (format == bench_format.json) {
+    printf("[");
+  }
+  bool first = true;
+  for (i32 case_index = 0; case_index < case_count; case_index++) {
+    LayoutBenchCase bench_case = cases[case_index];
+    Arena *arena = arena_open(4096);
+    BenchSamples *phases[PHASE_COUNT];
+    for (i32 i = 0; i < PHASE_COUNT; i++) {
+      phases[i] = new_bench_samples(arena, phase_names[i]);
+    }
+    BenchSamples *build_samples = new_bench_samples(arena, "build");
+
+    u64 start = bench_start();
+    Element *root = new_element(arena);
+    root->layout_direction = layout_direction.vertical;
+    bench_case.build(arena, root, bench_case.size);
+    bench_stop(build_samples, start);
+
+    // The first layout creates the input lines, later runs update them
+    set_root_element_dimensions(root, window_width, window_height);
+    for (i32 i = 0; i < iterations; i++) {
+      if (bench_case.prepare != 0) {
+        bench_case.prepare(arena);
+      }
+      force_input_rerender(root);
+      time_layout(arena, root, window_width, window_height, phases);
+    }
+
+    if (format == bench_format.text) {
+      printf("%s (size %d, %d iterations)\n", bench_case.name, bench_case.size, iterations);
+    }
+    print_bench_result(build_samples, bench_case.name, format, first);
+    first = false;
+    for (i32 i = 0; i < PHASE_COUNT; i++) {
+      print_bench_result(phases[i], bench_case.name, format, first);
+    }
+    arena_close(arena);
+  }
+  if (format == bench_format.json) {
+    printf("\n]\n");
+  }
+
+  close_fonts();
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf
+#include <string.h> // memcpy, strlen
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/font.c" // init_fonts, close_fonts, get_sft, font_variant
+#include "../include/schrift.c" // SFT, SFT_MeasureUTF8
+#include "../include/types.c" // i32, u8, u64, f64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples, print_throughput
+
+/*
+
+Measures text throughput of SFT_MeasureUTF8 in millions of bytes per second. The text_width case measures short lines from start to end, like fill_scroll_width does for labels. The fit_width case measures how much of a long text fits into a width, like split_string_at_width does when wrapping. Run from the repository root so that the fonts are found.
+
+*/
+
+#define TEXT_SIZE (1024 * 1024)
+#define LINE_LENGTH 80
+#define FIT_WIDTH 400
+#define ITERATIONS 10
+
+char *sample_words[] = {
+  "measure", "every", "character", "of", "the", "text", "with", "kerning", "and", "advance", "widths,",
+  "Åsa", "läser", "fönstret", "café", "naïve", "déjà", "vu", "—", "“quoted”", "AVAWAY", "To", "Ty", "1 234,56"
+};
+
+i32 main(void) {
+  SDL_Init(0);
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *arena = arena_open(TEXT_SIZE + 4096);
+  SFT *sft = get_sft(font_variant.regular);
+
+  // Fill the text with words and end each line with a null terminator
+  u8 *text = arena_fill(arena, TEXT_SIZE + 1);
+  i32 word_list_length = sizeof(sample_words) / sizeof(sample_words[0]);
+  i32 text_length = 0;
+  i32 line_start = 0;
+  for (i32 i = 0; text_length < TEXT_SIZE - 32; i++) {
+    char *word = sample_words[(i * 7 + i / 5) % word_list_length];
+    i32 word_length = strlen(word);
+    memcpy(text + text_length, word, word_length);
+    text_length += word_length;
+    if (text_length - line_start > LINE_LENGTH) {
+      text[text_length++] = '\0';
+      line_start = text_length;
+    } else {
+      text[text_length++] = ' ';
+    }
+  }
+  text[text_length] = '\0';
+
+  BenchSamples *text_width = new_bench_samples(arena, "text_width");
+  BenchSamples *fit_width = new_bench_samples(arena, "fit_width");
+  i32 total_width = 0;
+  for (i32 iteration = 0; iteration < ITERATIONS; iteration++) {
+    u64 start = bench_start();
+    i32 index = 0;
+    while (index < text_length) {
+      i32 width = 0;
+      SFT_MeasureUTF8(sft, text + index, 0, &width, 0);
+      total_width += width;
+      index += strlen((char *)text + index) + 1;
+    }
+    bench_stop(text_width, start);
+  }
+
+  // Join the lines into one long text for fitting
+  for (i32 i = 0; i < text_length; i++) {
+    if (text[i] == '\0') {
+      text[i] = ' ';
+    }
+  }
+  i32 fit_bytes = 0;
+  for (i32 iteration = 0; iteration < ITERATIONS; iteration++) {
+    u64 start = bench_start();
+    i32 index = 0;
+    while (index < text_length) {
+      i32 width = 0;
+      i32 count = 0;
+      SFT_MeasureUTF8(sft, text + index, FIT_WIDTH, &width, &count);
+      if (count == 0) break;
+      // Step over count characters, which can be more than one byte each
+      while (count > 0 && index < text_length) {
+        index++;
+        while ((text[index] & 0xC0) == 0x80) {
+          index++;
+        }
+        count--;
+      }
+    }
+    bench_stop(fit_width, start);
+    fit_bytes = index;
+  }
+
+  print_bench_samples(text_width);
+  print_bench_samples(fit_width);
+  print_throughput(text_width, text_length);
+  print_throughput(fit_width, fit_bytes);
+  printf("checksum %d\n", total_width);
+
+  arena_close(arena);
+  close_fonts();
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit, SDL_Rect
+#include <stdio.h> // printf
+#include <string.h> // memcpy, strlen
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/color.c" // RGBA
+#include "../include/draw_shapes.c" // PixelData, draw_text, draw_multiline_text
+#include "../include/font.c" // init_fonts, close_fonts, get_font_height, font_variant
+#include "../include/font_layout.c" // get_text_block_height
+#include "../include/string.c" // s8
+#include "../include/text_run.c" // get_text_width
+#include "../include/types.c" // i32, u64
+#include "../include/types_common.c" // Padding
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Repaints a 500 line label with draw_multiline_text, like the renderer does when a text element has changed. The tall case paints into a target that fits every line, and the viewport case into a 400 px high target where the label is scrolled to the middle, so most lines are outside of it. The long line case paints a 20k character line with draw_text into a 300 px wide field that is scrolled to the middle of the line. The glyph cache is warmed up before timing. Run from the repository root so that the fonts are found.
+
+*/
+
+#define LABEL_LINES 500
+#define LABEL_WIDTH 600
+#define VIEWPORT_HEIGHT 400
+#define LONG_LINE_LENGTH 20000
+#define FIELD_WIDTH 300
+#define ITERATIONS 20
+
+char *label_lines[] = {
+  "Painting a line should only touch the pixels of that line",
+  "so the cost of a repaint grows with the number of lines",
+  "and not with the number of lines times the height of the label.",
+};
+
+// Clears the target to white
+void clear_target(PixelData target) {
+  for (i32 i = 0; i < target.width * target.height; i++) {
+    target.pixels[i] = 0xFFFFFFFF;
+  }
+}
+
+// Returns a checksum of the painted pixels
+u64 get_checksum(PixelData target) {
+  u64 checksum = 0;
+  for (i32 i = 0; i < target.width * target.height; i++) {
+    checksum = checksum * 31 + target.pixels[i];
+  }
+  return checksum;
+}
+
+void run_case(Arena *arena, char *name, s8 text, i32 target_height, i32 scroll_y) {
+  i32 text_height = get_text_block_height(font_variant.regular, text, LABEL_WIDTH);
+  PixelData target = {
+    .pixels = arena_fill(arena, LABEL_WIDTH * target_height * sizeof(RGBA)),
+    .width = LABEL_WIDTH,
+    .height = target_height,
+  };
+  SDL_Rect text_position = {
+    .x = 0,
+    .y = -scroll_y,
+    .w = LABEL_WIDTH,
+    .h = text_height,
+  };
+  // Warm up the glyph cache
+  clear_target(target);
+  draw_multiline_text(target, font_variant.regular, text, 0x000000FF, text_position, (Padding){0, 0, 0, 0});
+  u64 checksum = get_checksum(target);
+  BenchSamples *samples = new_bench_samples(arena, name);
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    clear_target(target);
+    u64 start = bench_start();
+    draw_multiline_text(target, font_variant.regular, text, 0x000000FF, text_position, (Padding){0, 0, 0, 0});
+    bench_stop(samples, start);
+  }
+  print_bench_samples(samples);
+  printf("checksum %016llx\n", (unsigned long long)checksum);
+}
+
+// Paints a long single line scrolled to its middle into a narrow field
+void run_long_line_case(Arena *arena, s8 text) {
+  i32 field_height = get_font_height(font_variant.regular);
+  PixelData target = {
+    .pixels = arena_fill(arena, FIELD_WIDTH * field_height * sizeof(RGBA)),
+    .width = FIELD_WIDTH,
+    .height = field_height,
+  };
+  i32 text_width = get_text_width(font_variant.regular, text);
+  SDL_Rect text_position = {
+    .x = -text_width / 2,
+    .y = 0,
+    .w = text_width,
+    .h = field_height,
+  };
+  clear_target(target);
+  draw_text(target, font_variant.regular, text, 0x000000FF, text_position, (Padding){0, 0, 0, 0});
+  u64 checksum = get_checksum(target);
+  BenchSamples *samples = new_bench_samples(arena, "long line");
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    clear_target(target);
+    u64 start = bench_start();
+    draw_text(target, font_variant.regular, text, 0x000000FF, text_position, (Padding){0, 0, 0, 0});
+    bench_stop(samples, start);
+  }
+  print_bench_samples(samples);
+  printf("checksum %016llx\n", (unsigned long long)checksum);
+}
+
+i32 main(void) {
+  if (SDL_Init(0)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *arena = arena_open(1024 * 1024);
+
+  // Build the label from a fixed set of lines
+  i32 line_count = sizeof(label_lines) / sizeof(label_lines[0]);
+  i32 text_capacity = 1;
+  for (i32 i = 0; i < LABEL_LINES; i++) {
+    text_capacity += strlen(label_lines[i % line_count]) + 1;
+  }
+  u8 *text_data = arena_fill(arena, text_capacity);
+  i32 text_length = 0;
+  for (i32 i = 0; i < LABEL_LINES; i++) {
+    char *line = label_lines[i % line_count];
+    i32 line_length = strlen(line);
+    memcpy(text_data + text_length, line, line_length);
+    text_length += line_length;
+    if (i < LABEL_LINES - 1) {
+      text_data[text_length++] = '\n';
+    }
+  }
+  s8 text = {
+    .data = text_data,
+    .length = text_length,
+  };
+  i32 text_height = get_text_block_height(font_variant.regular, text, LABEL_WIDTH);
+  printf("%d line label, %d px high\n", LABEL_LINES, text_height);
+
+  run_case(arena, "tall", text, text_height, 0);
+  run_case(arena, "viewport", text, VIEWPORT_HEIGHT, text_height / 2);
+
+  // Build a long line from the label text without newlines
+  u8 *line_data = arena_fill(arena, LONG_LINE_LENGTH);
+  for (i32 i = 0; i < LONG_LINE_LENGTH; i++) {
+    u8 byte = text.data[i % text.length];
+    line_data[i] = byte == '\n' ? ' ' : byte;
+  }
+  s8 long_line = {
+    .data = line_data,
+    .length = LONG_LINE_LENGTH,
+  };
+  run_long_line_case(arena, long_line);
+
+  arena_close(arena);
+  close_fonts();
+  SDL_Quit();
+  return 0;
+}
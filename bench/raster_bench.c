@@ -0,0 +1,181 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf
+#include <stdlib.h> // abs
+#include <string.h> // memcpy, memset
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/font.c" // init_fonts, close_fonts, get_sft, font_variant
+#include "../include/schrift.c" // SFT, SFT_Glyph, SFT_GMetrics, SFT_Image, SFT_DOUBLE_CELLS, sft_lookup, sft_gmetrics, sft_render
+#include "../include/types.c" // i32, i64, u8, u64, f64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples, summarize_bench_samples
+
+/*
+
+Rasterizes the printable Latin-1 characters of the regular and bold fonts at several sizes with sft_render, like the glyph cache does on a miss. Every pass is timed with double precision cells and no outline cache (the libschrift rasterizer), with float cells and no outline cache, and with float cells and the outline cache, and the throughput is printed in glyphs per second. The bitmaps are then compared with the libschrift ones, and the bench fails if any pixel differs by more than one.
+
+The zoom case renders the regular font at a new size in every pass, like a zoom or resize that misses the glyph cache. The outlines have been decoded at another size before, so with the outline cache only the flattening is done again. Run from the repository root so that the fonts are found.
+
+*/
+
+#define FIRST_CODE_POINT 32
+#define LAST_CODE_POINT 255
+#define ITERATIONS 20
+#define MAX_GLYPHS 8192
+#define ZOOM_FIRST_SIZE 16
+#define ZOOM_PIXELS (256 * 256)
+#define LIBSCHRIFT_FLAGS (SFT_DOUBLE_CELLS | SFT_NO_OUTLINE_CACHE)
+
+f64 sizes[] = {13, 15, 19, 32, 64};
+
+typedef struct {
+  SFT sft;
+  SFT_Glyph glyph;
+  SFT_Image image;
+} RasterGlyph;
+
+// Rasterizes every glyph once with the given flags
+void rasterize_glyphs(RasterGlyph *glyphs, i32 glyph_count, i32 flags) {
+  for (i32 i = 0; i < glyph_count; i++) {
+    RasterGlyph *glyph = &glyphs[i];
+    glyph->sft.flags = flags;
+    memset(glyph->image.pixels, 0, glyph->image.width * glyph->image.height);
+    sft_render(&glyph->sft, glyph->glyph, glyph->image);
+  }
+}
+
+// Times passes over all glyphs and prints the throughput
+void time_rasterizer(Arena *arena, char *name, RasterGlyph *glyphs, i32 glyph_count, i32 flags) {
+  rasterize_glyphs(glyphs, glyph_count, flags);
+  BenchSamples *samples = new_bench_samples(arena, name);
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    u64 start = bench_start();
+    rasterize_glyphs(glyphs, glyph_count, flags);
+    bench_stop(samples, start);
+  }
+  print_bench_samples(samples);
+  BenchSummary summary = summarize_bench_samples(samples);
+  printf("%-24s %8.0f glyphs/s\n", samples->name, glyph_count / (summary.mean / 1000.0));
+}
+
+// Renders every Latin-1 glyph of the font once at a size into a scratch image
+void rasterize_size(SFT sft, f64 size, i32 flags, u8 *pixels) {
+  sft.xScale = size;
+  sft.yScale = size;
+  sft.flags = flags;
+  for (SFT_UChar code_point = FIRST_CODE_POINT; code_point <= LAST_CODE_POINT; code_point++) {
+    SFT_Glyph glyph;
+    SFT_GMetrics metrics;
+    if (sft_lookup(&sft, code_point, &glyph) < 0 || glyph == 0) continue;
+    if (sft_gmetrics(&sft, glyph, &metrics) < 0) continue;
+    if (metrics.minWidth <= 0 || metrics.minHeight <= 0 || metrics.minWidth * metrics.minHeight > ZOOM_PIXELS) continue;
+    SFT_Image image = {
+      .pixels = pixels,
+      .width = metrics.minWidth,
+      .height = metrics.minHeight,
+    };
+    memset(pixels, 0, metrics.minWidth * metrics.minHeight);
+    sft_render(&sft, glyph, image);
+  }
+}
+
+// Times one pass per size, each at a size that has not been rendered before
+void time_zoom(Arena *arena, char *name, SFT sft, i32 flags, u8 *pixels) {
+  BenchSamples *samples = new_bench_samples(arena, name);
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    u64 start = bench_start();
+    rasterize_size(sft, ZOOM_FIRST_SIZE + i, flags, pixels);
+    bench_stop(samples, start);
+  }
+  print_bench_samples(samples);
+}
+
+// Renders every glyph with the flags and prints how much the bitmaps differ from libschrift. Returns the largest difference.
+i32 compare_rasterizer(Arena *arena, char *name, RasterGlyph *glyphs, i32 glyph_count, i32 flags) {
+  i32 max_difference = 0;
+  i64 different_pixels = 0;
+  i64 pixel_count = 0;
+  for (i32 i = 0; i < glyph_count; i++) {
+    RasterGlyph *glyph = &glyphs[i];
+    i32 size = glyph->image.width * glyph->image.height;
+    u8 *pixels = arena_fill(arena, size);
+    glyph->sft.flags = flags;
+    memset(glyph->image.pixels, 0, size);
+    sft_render(&glyph->sft, glyph->glyph, glyph->image);
+    memcpy(pixels, glyph->image.pixels, size);
+    glyph->sft.flags = LIBSCHRIFT_FLAGS;
+    memset(glyph->image.pixels, 0, size);
+    sft_render(&glyph->sft, glyph->glyph, glyph->image);
+    u8 *libschrift_pixels = glyph->image.pixels;
+    for (i32 p = 0; p < size; p++) {
+      i32 difference = abs(pixels[p] - libschrift_pixels[p]);
+      if (difference > 0) different_pixels++;
+      if (difference > max_difference) max_difference = difference;
+    }
+    pixel_count += size;
+  }
+  printf("%-24s max difference %d, %lld of %lld pixels differ\n", name, max_difference, (long long)different_pixels, (long long)pixel_count);
+  return max_difference;
+}
+
+i32 main(void) {
+  if (SDL_Init(0)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *arena = arena_open(1024 * 1024);
+
+  // Decode the outlines at a size outside of the zoom first, like the text that was drawn before zooming
+  u8 *zoom_pixels = arena_fill(arena, ZOOM_PIXELS);
+  SFT zoom_sft = *get_sft(font_variant.regular);
+  rasterize_size(zoom_sft, ZOOM_FIRST_SIZE - 1, 0, zoom_pixels);
+  time_zoom(arena, "zoom", zoom_sft, SFT_NO_OUTLINE_CACHE, zoom_pixels);
+  time_zoom(arena, "zoom, outline cache", zoom_sft, 0, zoom_pixels);
+
+  // Collect the glyphs of every font and size with a bitmap of their own
+  u8 variants[] = {font_variant.regular, font_variant.bold};
+  i32 variant_count = sizeof(variants) / sizeof(variants[0]);
+  i32 size_count = sizeof(sizes) / sizeof(sizes[0]);
+  RasterGlyph *glyphs = arena_fill(arena, MAX_GLYPHS * sizeof(RasterGlyph));
+  i32 glyph_count = 0;
+  i64 pixel_count = 0;
+  for (i32 v = 0; v < variant_count; v++) {
+    for (i32 s = 0; s < size_count; s++) {
+      SFT sft = *get_sft(variants[v]);
+      sft.xScale = sizes[s];
+      sft.yScale = sizes[s];
+      for (SFT_UChar code_point = FIRST_CODE_POINT; code_point <= LAST_CODE_POINT; code_point++) {
+        SFT_Glyph glyph;
+        SFT_GMetrics metrics;
+        if (sft_lookup(&sft, code_point, &glyph) < 0 || glyph == 0) continue;
+        if (sft_gmetrics(&sft, glyph, &metrics) < 0) continue;
+        if (metrics.minWidth <= 0 || metrics.minHeight <= 0) continue;
+        if (glyph_count == MAX_GLYPHS) break;
+        i32 size = metrics.minWidth * metrics.minHeight;
+        glyphs[glyph_count++] = (RasterGlyph){
+          .sft = sft,
+          .glyph = glyph,
+          .image = {
+            .pixels = arena_fill(arena, size),
+            .width = metrics.minWidth,
+            .height = metrics.minHeight,
+          },
+        };
+        pixel_count += size;
+      }
+    }
+  }
+  printf("%d glyphs, %lld pixels\n", glyph_count, (long long)pixel_count);
+
+  time_rasterizer(arena, "double cells", glyphs, glyph_count, LIBSCHRIFT_FLAGS);
+  time_rasterizer(arena, "float cells", glyphs, glyph_count, SFT_NO_OUTLINE_CACHE);
+  time_rasterizer(arena, "outline cache", glyphs, glyph_count, 0);
+
+  i32 max_difference = compare_rasterizer(arena, "float cells", glyphs, glyph_count, SFT_NO_OUTLINE_CACHE);
+  i32 cache_difference = compare_rasterizer(arena, "outline cache", glyphs, glyph_count, 0);
+  if (cache_difference > max_difference) max_difference = cache_difference;
+
+  arena_close(arena);
+  close_fonts();
+  SDL_Quit();
+  return max_difference > 1 ? -1 : 0;
+}
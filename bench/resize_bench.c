@@ -0,0 +1,180 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_CreateWindow, SDL_CreateRenderer, SDL_CreateTexture, SDL_WaitEventTimeout, SDL_GetPerformanceFrequency
+#include <stdio.h> // printf, snprintf
+#include "../constants/color_theme.c" // text_cursor_color, selection_color, scrollbar_color (used by the renderer)
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/element_tree.c" // ElementTree, new_element_tree, add_new_element, free_textures
+#include "../include/font.c" // init_fonts, close_fonts
+#include "../include/layout.c" // set_dimensions
+#include "../include/renderer.c" // render_element_tree
+#include "../include/string.c" // s8
+#include "../include/text_worker.c" // init_text_worker, close_text_worker, apply_text_layouts, get_pending_text_layouts, text_worker
+#include "../include/types.c" // i32, u32, u64, f64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Resizes a window that shows a document of about 512 KB in one scrolled label, with paragraphs of mixed lengths and words of mixed widths, like dragging the edge of the window, and times the first frame and every resized frame on the main thread (layout and drawing). The first case lays the document out on the main thread and the second case on the text worker, where a frame uses the estimated height and the last wrapped lines until the worker is done. After the resize, the second case waits for the worker and prints how many frames and how long it took until the exact layout was applied, and how far the estimated height was from it. Run from the repository root so that the fonts are found. Use SDL_VIDEODRIVER=dummy to run without a display.
+
+*/
+
+#define DOCUMENT_SIZE (512 * 1024)
+#define RESIZE_FRAMES 40
+
+// Words of different widths. The estimate uses the average advance of the start of the text, so sections that use
+// narrower or wider words than the start, and long words that are moved to a line of their own, make it less exact.
+char *narrow_words[] = {"i", "if", "it", "fill", "lift", "little", "till", "jilt", "filial", "I"};
+char *average_words[] = {"the", "text", "worker", "wraps", "document", "layout", "estimate", "window", "resize", "line"};
+char *wide_words[] = {"WM", "MOW", "MEMO", "MAXIMUM", "mammoth", "WOMBAT", "OVERVIEW", "HEADING", "momentum", "MW"};
+char *long_words[] = {
+  "https://example.com/documents/resize/estimate/of/the/height/of/a/wrapped/text",
+  "internationalization_and_localization_of_user_interfaces",
+};
+#define WORD_LIST_LENGTH 10
+
+// Returns the next number of a linear congruential generator, so that both cases get the same document
+u32 next_random(u32 *state) {
+  *state = *state * 1664525 + 1013904223;
+  return *state >> 8;
+}
+
+// Returns the number of words of a paragraph: empty lines, short lines, medium paragraphs and a few long ones
+i32 get_paragraph_word_count(u32 *state) {
+  i32 kind = next_random(state) % 10;
+  if (kind < 2) return 0;
+  if (kind < 6) return 1 + next_random(state) % 8;
+  if (kind < 9) return 20 + next_random(state) % 40;
+  return 200 + next_random(state) % 400;
+}
+
+// Builds a document of about DOCUMENT_SIZE bytes with paragraphs of mixed lengths. Every 40 paragraphs the document
+// switches between mostly narrow, average and wide words. The marker makes the documents of the two cases differ, so both
+// start uncached.
+s8 new_document(Arena *arena, char marker) {
+  i32 capacity = DOCUMENT_SIZE + 64 * 1024;
+  u8 *data = arena_fill(arena, capacity);
+  i32 length = 0;
+  u32 state = 1;
+  for (i32 p = 0; length < DOCUMENT_SIZE; p++) {
+    char **section_words = (p / 40) % 3 == 0 ? average_words : (p / 40) % 3 == 1 ? narrow_words : wide_words;
+    data[length++] = marker;
+    i32 word_count = get_paragraph_word_count(&state);
+    for (i32 w = 0; w < word_count && length < capacity - 128; w++) {
+      i32 pick = next_random(&state) % 100;
+      char *word = pick < 70 ? section_words[next_random(&state) % WORD_LIST_LENGTH]
+                 : pick < 99 ? average_words[next_random(&state) % WORD_LIST_LENGTH]
+                 : long_words[next_random(&state) % 2];
+      if (w > 0) data[length++] = ' ';
+      for (i32 i = 0; word[i] != 0; i++) {
+        data[length++] = word[i];
+      }
+    }
+    data[length++] = '\n';
+  }
+  return (s8){.data = data, .length = length};
+}
+
+// Lays out and draws the tree at a window width
+void draw_frame(SDL_Renderer *renderer, ElementTree *tree, i32 width) {
+  tree->size.width = width;
+  set_dimensions(tree);
+  SDL_SetRenderTarget(renderer, tree->target_texture);
+  render_element_tree(renderer, tree);
+  SDL_RenderPresent(renderer);
+}
+
+void run_case(Arena *bench_arena, SDL_Renderer *renderer, SDL_Texture *target_texture, char *name, char marker, i32 window_width, i32 window_height) {
+  Arena *element_arena = arena_open(4096);
+  ElementTree *tree = new_element_tree(element_arena);
+  tree->target_texture = target_texture;
+  tree->size = (TreeSize){
+    .width = window_width,
+    .height = window_height,
+  };
+  Element *document = add_new_element(tree->arena, tree->root);
+  *document = (Element){
+    .text = new_document(bench_arena, marker),
+    .overflow = overflow_type.scroll_y,
+    .padding = (Padding){10, 10, 10, 10},
+  };
+  printf("%s: %d KB document\n", name, document->text.length / 1024);
+
+  // The samples keep a pointer to their name
+  char *first_name = arena_fill(bench_arena, 64);
+  char *resize_name = arena_fill(bench_arena, 64);
+  snprintf(first_name, 64, "%s, first frame", name);
+  snprintf(resize_name, 64, "%s, resize", name);
+  BenchSamples *first_samples = new_bench_samples(bench_arena, first_name);
+  u64 first_start = bench_start();
+  draw_frame(renderer, tree, window_width);
+  bench_stop(first_samples, first_start);
+  BenchSamples *resize_samples = new_bench_samples(bench_arena, resize_name);
+  i32 width = window_width;
+  for (i32 frame = 0; frame < RESIZE_FRAMES; frame++) {
+    // Shrink the window and grow it back
+    width += frame < RESIZE_FRAMES / 2 ? -8 : 8;
+    u64 start = bench_start();
+    draw_frame(renderer, tree, width);
+    bench_stop(resize_samples, start);
+  }
+  print_bench_samples(first_samples);
+  print_bench_samples(resize_samples);
+
+  if (text_worker.thread != 0) {
+    i32 estimated_height = document->layout.scroll_height;
+    // Wait for the worker like handle_events does and apply each layout that is done
+    i32 frames = 0;
+    u64 start = bench_start();
+    while (get_pending_text_layouts() > 0) {
+      SDL_Event event;
+      if (SDL_WaitEventTimeout(&event, 100) && event.type == TEXT_WORKER_EVENT && apply_text_layouts(tree)) {
+        draw_frame(renderer, tree, width);
+        frames++;
+      }
+    }
+    f64 wait_time = (f64)(bench_start() - start) * 1000 / SDL_GetPerformanceFrequency();
+    i32 exact_height = document->layout.scroll_height;
+    printf("%s: exact layout after %.1f ms and %d frames, %u layouts applied\n", name, wait_time, frames, text_worker.completed);
+    printf("%s: estimated height %d, exact height %d, off by %d (%.1f%%)\n", name, estimated_height, exact_height, estimated_height - exact_height, 100.0 * (estimated_height - exact_height) / exact_height);
+  } else {
+    printf("%s: height %d\n", name, document->layout.scroll_height);
+  }
+  free_textures(tree->root);
+  arena_close(element_arena);
+}
+
+i32 main() {
+  i32 window_width = 640;
+  i32 window_height = 480;
+
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Window *window = SDL_CreateWindow("Resize bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_HIDDEN);
+  if (!window) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+  if (!renderer) {
+    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+  SDL_Texture *target_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+  Arena *bench_arena = arena_open(4096);
+
+  run_case(bench_arena, renderer, target_texture, "main thread", 'A', window_width, window_height);
+  if (init_text_worker()) {
+    run_case(bench_arena, renderer, target_texture, "text worker", 'B', window_width, window_height);
+    close_text_worker();
+  }
+
+  arena_close(bench_arena);
+  SDL_DestroyTexture(target_texture);
+  close_fonts();
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_CreateWindow, SDL_CreateRenderer, SDL_CreateTexture
+#include <stdio.h> // printf, snprintf
+#include "../constants/color_theme.c" // text_cursor_color, selection_color, scrollbar_color (used by the renderer)
+#include "../include/arena.c" // Arena, arena_open, arena_close
+#include "../include/element_tree.c" // ElementTree, new_element_tree, add_new_element, free_textures
+#include "../include/font.c" // init_fonts, close_fonts
+#include "../include/layout.c" // set_dimensions, scroll_y, set_y, get_clickable_element_at
+#include "../include/renderer.c" // render_element_tree
+#include "../include/string.c" // to_s8
+#include "../include/types.c" // i32, u64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Scrolls a container with 100 000 children in trackpad sized steps and measures the time spent handling each scroll event, finding the element under the pointer on click, and drawing each frame. Run from the repository root so that the fonts are found. Use SDL_VIDEODRIVER=dummy to run without a display.
+
+The "re-place" samples time set_y on the whole tree, which is what every scroll event cost before children were positioned relative to their parent.
+
+*/
+
+#define CHILD_COUNT 100000
+
+char child_text[CHILD_COUNT][16];
+
+i32 main() {
+  i32 window_width = 640;
+  i32 window_height = 640;
+  i32 scroll_steps = 1000;
+
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Window *window = SDL_CreateWindow("Scroll bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_HIDDEN);
+  if (!window) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+  if (!renderer) {
+    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+
+  Arena *bench_arena = arena_open(4096);
+  Arena *element_arena = arena_open(4096);
+  ElementTree *tree = new_element_tree(element_arena);
+  tree->target_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+  tree->size = (TreeSize){
+    .width = window_width,
+    .height = window_height,
+  };
+
+  BenchSamples *layout_samples = new_bench_samples(bench_arena, "initial layout");
+  BenchSamples *scroll_samples = new_bench_samples(bench_arena, "scroll event");
+  BenchSamples *click_samples = new_bench_samples(bench_arena, "click hit test");
+  BenchSamples *replace_samples = new_bench_samples(bench_arena, "re-place (set_y)");
+  BenchSamples *frame_samples = new_bench_samples(bench_arena, "scroll frame");
+
+  Element *container = add_new_element(tree->arena, tree->root);
+  *container = (Element){
+    .overflow = overflow_type.scroll_y,
+    .layout_direction = layout_direction.vertical,
+    .padding = (Padding){10, 10, 10, 10},
+    .gutter = 2,
+  };
+  for (i32 i = 0; i < CHILD_COUNT; i++) {
+    Element *child = add_new_element(tree->arena, container);
+    snprintf(child_text[i], 16, "Row %d", i);
+    *child = (Element){
+      .height = 20,
+      .text = to_s8(child_text[i]),
+    };
+  }
+
+  u64 start = bench_start();
+  set_dimensions(tree);
+  bench_stop(layout_samples, start);
+
+  SDL_SetRenderTarget(renderer, tree->target_texture);
+  render_element_tree(renderer, tree);
+  SDL_RenderPresent(renderer);
+
+  printf("Scroll container with %d children, window %d x %d\n", CHILD_COUNT, window_width, window_height);
+
+  i32 pointer_x = window_width / 2;
+  i32 pointer_y = window_height / 2;
+  for (i32 i = 0; i < scroll_steps; i++) {
+    i32 delta = i < scroll_steps / 2 ? -43 : 43;
+    u64 frame_start = bench_start();
+    scroll_y(tree->root, pointer_x, pointer_y, delta);
+    bench_stop(scroll_samples, frame_start);
+    render_element_tree(renderer, tree);
+    SDL_RenderPresent(renderer);
+    bench_stop(frame_samples, frame_start);
+
+    u64 click_start = bench_start();
+    get_clickable_element_at(tree->root, pointer_x, pointer_y);
+    bench_stop(click_samples, click_start);
+
+    u64 replace_start = bench_start();
+    set_y(tree->root, 0);
+    bench_stop(replace_samples, replace_start);
+  }
+
+  print_bench_samples(layout_samples);
+  print_bench_samples(scroll_samples);
+  print_bench_samples(click_samples);
+  print_bench_samples(replace_samples);
+  print_bench_samples(frame_samples);
+
+  free_textures(tree->root);
+  SDL_DestroyTexture(tree->target_texture);
+  arena_close(element_arena);
+  arena_close(bench_arena);
+  close_fonts();
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
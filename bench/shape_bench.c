@@ -0,0 +1,104 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf
+#include <string.h> // memcpy, strlen
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/font.c" // init_fonts, close_fonts, get_sft, font_variant
+#include "../include/schrift.c" // SFT, SFT_Glyph, SFT_ShapeUTF8, SFT_MeasureUTF8
+#include "../include/types.c" // i32, u8, u64, f64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples, print_throughput
+
+/*
+
+Shapes and measures UI strings with SFT_ShapeUTF8 and SFT_MeasureUTF8 and prints the throughput in millions of bytes per second. The English case is short ASCII labels like the ones of menus, buttons and tables. The Latin-1 case is Swedish, French and German labels, where most characters are ASCII and some are two byte sequences. The CJK case mixes Chinese and Japanese with ASCII, so most characters are three byte sequences that are looked up in the cmap of the font. A checksum of the glyph ids and widths is printed so that results can be compared between versions. Run from the repository root so that the fonts are found.
+
+*/
+
+#define TEXT_SIZE (1024 * 1024)
+#define ITERATIONS 20
+
+char *english_labels[] = {
+  "File", "Edit", "View", "Open recent", "Save as...", "Export to PDF", "Preferences", "Search results",
+  "Name", "Date modified", "Size", "Kind", "3 items selected", "Cancel", "OK", "Apply changes",
+};
+
+char *latin_labels[] = {
+  "Öppna fil", "Spara som…", "Inställningar", "Sök i mappen", "Fönster", "Ändrad", "Storlek", "Avbryt",
+  "Préférences", "Aperçu", "Déplacer", "Größe", "Schließen", "Übersicht", "Café", "Ça va",
+};
+
+char *cjk_labels[] = {
+  "文件", "编辑", "视图", "打开最近的文件", "另存为...", "导出为 PDF", "设置", "搜索结果",
+  "ファイル", "編集", "表示", "最近使ったファイル", "名前", "変更日", "サイズ 12 KB", "キャンセル",
+};
+
+// Fills the text with labels, each followed by a null terminator. Returns the length.
+i32 fill_labels(u8 *text, char **labels, i32 label_count) {
+  i32 length = 0;
+  for (i32 i = 0; length < TEXT_SIZE - 64; i++) {
+    char *label = labels[(i * 7 + i / 3) % label_count];
+    i32 label_length = strlen(label);
+    memcpy(text + length, label, label_length);
+    length += label_length;
+    text[length++] = '\0';
+  }
+  return length;
+}
+
+void run_case(Arena *arena, SFT *sft, char *shape_name, char *measure_name, char **labels, i32 label_count) {
+  u8 *text = arena_fill(arena, TEXT_SIZE);
+  i32 text_length = fill_labels(text, labels, label_count);
+  // Room for the longest label
+  SFT_Glyph glyphs[256];
+  f64 pens[256];
+  f64 ends[256];
+  i32 offsets[256];
+  u64 checksum = 0;
+
+  BenchSamples *shape_samples = new_bench_samples(arena, shape_name);
+  for (i32 iteration = 0; iteration < ITERATIONS; iteration++) {
+    checksum = 0;
+    u64 start = bench_start();
+    i32 index = 0;
+    while (index < text_length) {
+      i32 length = strlen((char *)text + index);
+      i32 count = SFT_ShapeUTF8(sft, text + index, length, glyphs, pens, ends, offsets);
+      checksum = checksum * 31 + glyphs[count - 1] + (u64)(ends[count - 1] * 64);
+      index += length + 1;
+    }
+    bench_stop(shape_samples, start);
+  }
+
+  BenchSamples *measure_samples = new_bench_samples(arena, measure_name);
+  for (i32 iteration = 0; iteration < ITERATIONS; iteration++) {
+    u64 start = bench_start();
+    i32 index = 0;
+    while (index < text_length) {
+      i32 width = 0;
+      SFT_MeasureUTF8(sft, text + index, 0, &width, 0);
+      checksum = checksum * 31 + width;
+      index += strlen((char *)text + index) + 1;
+    }
+    bench_stop(measure_samples, start);
+  }
+  print_bench_samples(shape_samples);
+  print_bench_samples(measure_samples);
+  print_throughput(shape_samples, text_length);
+  print_throughput(measure_samples, text_length);
+  printf("%-24s %016llx\n", "checksum", (unsigned long long)checksum);
+}
+
+i32 main(void) {
+  SDL_Init(0);
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *arena = arena_open(4 * TEXT_SIZE);
+  SFT *sft = get_sft(font_variant.regular);
+
+  run_case(arena, sft, "english shape", "english measure", english_labels, sizeof(english_labels) / sizeof(english_labels[0]));
+  run_case(arena, sft, "latin-1 shape", "latin-1 measure", latin_labels, sizeof(latin_labels) / sizeof(latin_labels[0]));
+  run_case(arena, sft, "cjk shape", "cjk measure", cjk_labels, sizeof(cjk_labels) / sizeof(cjk_labels[0]));
+
+  arena_close(arena);
+  close_fonts();
+  SDL_Quit();
+  return 0;
+}
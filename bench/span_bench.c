@@ -0,0 +1,171 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf
+#include <string.h> // memcmp, memcpy
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/color.c" // RGBA, blend_alpha, blend_colors
+#include "../include/pixel_span.c" // fill_span, copy_span, blend_mask_span, composite_span
+#include "../include/types.c" // i32, u8, u32, u64, f64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_throughput
+
+/*
+
+Runs each pixel span kernel over the rows of a 1920 x 1080 target and prints the throughput in megapixels per second, next to a scalar loop that writes one pixel at a time with the functions of color.c. The masks look like text (mostly empty with some fully and partly covered pixels), and the pixels mix opaque, translucent, transparent and empty ones. Before timing, the output of every kernel is compared with its scalar loop on the same random rows. Compile with -mavx2 to use the AVX2 kernels instead of SSE2.
+
+*/
+
+#define SPAN_WIDTH 1920
+#define SPAN_ROWS 1080
+#define ITERATIONS 20
+
+u32 random_state = 1;
+
+u32 next_random(void) {
+  // xorshift32
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+// Returns a pixel that is empty, transparent, translucent or opaque
+RGBA random_pixel(void) {
+  u32 value = next_random();
+  switch (value % 8) {
+    case 0: return 0;
+    case 1: return value & 0xFFFFFF00;
+    case 2: return value;
+    default: return value | 0xFF;
+  }
+}
+
+// Returns a coverage that is mostly empty, like the space between glyphs
+u8 random_coverage(void) {
+  u32 value = next_random();
+  switch (value % 8) {
+    case 0: return 255;
+    case 1: return value >> 24;
+    default: return 0;
+  }
+}
+
+void fill_span_scalar(RGBA *span, i32 count, RGBA color) {
+  for (i32 x = 0; x < count; x++) {
+    span[x] = color;
+  }
+}
+
+void copy_span_scalar(RGBA *target, RGBA *source, i32 count) {
+  for (i32 x = 0; x < count; x++) {
+    target[x] = source[x];
+  }
+}
+
+void blend_mask_span_scalar(RGBA *span, u8 *mask, i32 count, RGBA color) {
+  for (i32 x = 0; x < count; x++) {
+    if (mask[x] > 0) {
+      span[x] = blend_alpha(span[x], color, mask[x]);
+    }
+  }
+}
+
+void composite_span_scalar(RGBA *target, RGBA *source, i32 count) {
+  for (i32 x = 0; x < count; x++) {
+    target[x] = blend_colors(source[x], target[x]);
+  }
+}
+
+typedef enum {
+  FILL,
+  COPY,
+  BLEND_MASK,
+  COMPOSITE,
+} Kernel;
+
+// Runs a kernel over every row of the target
+void run_kernel(Kernel kernel, bool scalar, RGBA *target, RGBA *source, u8 *mask, i32 width, i32 rows) {
+  RGBA color = 0x3C78DCFF;
+  for (i32 y = 0; y < rows; y++) {
+    RGBA *target_row = target + y * width;
+    RGBA *source_row = source + y * width;
+    u8 *mask_row = mask + y * width;
+    if (kernel == FILL) {
+      scalar ? fill_span_scalar(target_row, width, color) : fill_span(target_row, width, color);
+    } else if (kernel == COPY) {
+      scalar ? copy_span_scalar(target_row, source_row, width) : copy_span(target_row, source_row, width);
+    } else if (kernel == BLEND_MASK) {
+      scalar ? blend_mask_span_scalar(target_row, mask_row, width, color) : blend_mask_span(target_row, mask_row, width, color);
+    } else {
+      scalar ? composite_span_scalar(target_row, source_row, width) : composite_span(target_row, source_row, width);
+    }
+  }
+}
+
+// Runs the kernel and its scalar loop on the same rows, with widths that leave a scalar tail, and returns true if the pixels are the same
+bool check_kernel(Kernel kernel, RGBA *pixels, RGBA *source, u8 *mask, RGBA *scalar_target, RGBA *span_target) {
+  i32 width = 131;
+  i32 rows = 512;
+  memcpy(scalar_target, pixels, width * rows * sizeof(RGBA));
+  memcpy(span_target, pixels, width * rows * sizeof(RGBA));
+  run_kernel(kernel, true, scalar_target, source, mask, width, rows);
+  run_kernel(kernel, false, span_target, source, mask, width, rows);
+  return memcmp(scalar_target, span_target, width * rows * sizeof(RGBA)) == 0;
+}
+
+void run_case(Arena *arena, Kernel kernel, char *scalar_name, char *span_name, RGBA *pixels, RGBA *source, u8 *mask, RGBA *target) {
+  BenchSamples *scalar_samples = new_bench_samples(arena, scalar_name);
+  BenchSamples *span_samples = new_bench_samples(arena, span_name);
+  for (i32 iteration = 0; iteration < ITERATIONS; iteration++) {
+    // Blending changes the target, so every run starts from the same pixels
+    memcpy(target, pixels, SPAN_WIDTH * SPAN_ROWS * sizeof(RGBA));
+    u64 start = bench_start();
+    run_kernel(kernel, true, target, source, mask, SPAN_WIDTH, SPAN_ROWS);
+    bench_stop(scalar_samples, start);
+    memcpy(target, pixels, SPAN_WIDTH * SPAN_ROWS * sizeof(RGBA));
+    start = bench_start();
+    run_kernel(kernel, false, target, source, mask, SPAN_WIDTH, SPAN_ROWS);
+    bench_stop(span_samples, start);
+  }
+  print_throughput(scalar_samples, SPAN_WIDTH * SPAN_ROWS);
+  print_throughput(span_samples, SPAN_WIDTH * SPAN_ROWS);
+}
+
+i32 main(void) {
+  SDL_Init(0);
+#if defined(__AVX2__)
+  printf("AVX2 kernels\n");
+#elif defined(__SSE2__)
+  printf("SSE2 kernels\n");
+#elif defined(__ARM_NEON)
+  printf("NEON kernels\n");
+#else
+  printf("Scalar kernels\n");
+#endif
+  i32 pixel_count = SPAN_WIDTH * SPAN_ROWS;
+  Arena *arena = arena_open(4096);
+  RGBA *pixels = arena_fill(arena, pixel_count * sizeof(RGBA));
+  RGBA *source = arena_fill(arena, pixel_count * sizeof(RGBA));
+  RGBA *target = arena_fill(arena, pixel_count * sizeof(RGBA));
+  RGBA *check_target = arena_fill(arena, pixel_count * sizeof(RGBA));
+  u8 *mask = arena_fill(arena, pixel_count);
+  for (i32 i = 0; i < pixel_count; i++) {
+    pixels[i] = random_pixel();
+    source[i] = random_pixel();
+    mask[i] = random_coverage();
+  }
+
+  char *kernel_names[] = {"fill", "copy", "blend mask", "composite"};
+  for (Kernel kernel = FILL; kernel <= COMPOSITE; kernel++) {
+    if (!check_kernel(kernel, pixels, source, mask, target, check_target)) {
+      printf("%s: the span kernel gives other pixels than the scalar loop\n", kernel_names[kernel]);
+      return -1;
+    }
+  }
+  run_case(arena, FILL, "fill, scalar", "fill_span", pixels, source, mask, target);
+  run_case(arena, COPY, "copy, scalar", "copy_span", pixels, source, mask, target);
+  run_case(arena, BLEND_MASK, "blend mask, scalar", "blend_mask_span", pixels, source, mask, target);
+  run_case(arena, COMPOSITE, "composite, scalar", "composite_span", pixels, source, mask, target);
+
+  arena_close(arena);
+  SDL_Quit();
+  return 0;
+}
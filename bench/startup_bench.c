@@ -0,0 +1,183 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_CreateWindow, SDL_CreateRenderer, SDL_CreateTexture
+#include <stdbool.h> // bool
+#include <stdio.h> // printf
+#include "../constants/color_theme.c" // text_cursor_color, selection_color, scrollbar_color (used by the renderer)
+#include "../include/arena.c" // Arena, arena_open, arena_close
+#include "../include/baked_fonts.c" // load_baked_fonts, close_baked_fonts, get_baked_font
+#include "../include/element_tree.c" // ElementTree, new_element_tree, add_new_element, free_textures
+#include "../include/font.c" // init_fonts, close_fonts, add_font_variant, get_sft, get_font_height, font_variant, font_files, font_variants
+#include "../include/layout.c" // set_dimensions
+#include "../include/renderer.c" // render_element_tree
+#include "../include/schrift.c" // SFT_Font, SFT_BakedFont, sft_glyph_cache, sft_glyph_cache_clear, sft_loadfile_baked, sft_freefont
+#include "../include/status.c" // status
+#include "../include/string.c" // to_s8
+#include "../include/text_raster.c" // text_raster_cache
+#include "../include/text_run.c" // text_run_cache
+#include "../include/types.c" // i32, u64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Times the first frame of a window of labels in all four default font variants: loading the fonts, the layout and drawing the frame, like an app does at startup. Between runs the fonts are closed and the glyph cache, the text runs and the text rasters are cleared, so every run starts cold (apart from the operating system file cache). The first case loads the fonts from their files, and the second case maps a baked fonts file first, which is written with tools/bake_fonts.c:
+
+```
+./bake_fonts fonts.baked
+./startup_bench fonts.baked
+```
+
+The bench fails if close_fonts leaves text runs or text rasters in their caches, or if a variant of a missing font file does not fall back to the regular variant. With a baked fonts file, the bench also checks that the baked data of a font is rejected if it was baked from another build of the font file, and fails if it is used. Run from the repository root so that the fonts are found. Use SDL_VIDEODRIVER=dummy to run without a display.
+
+*/
+
+#define ITERATIONS 50
+#define LABEL_COUNT 24
+
+char *label_lines[] = {
+  "The quick brown fox jumps over the lazy dog.",
+  "Sphinx of black quartz, judge my vow! 0123456789",
+  "Fünf Äpfel kosten 3,50 € — ça coûte très cher.",
+  "{[(<Brackets>)]} & @symbols #$%^*+=|\\/~`'\"?",
+};
+
+
+// Loads the fonts, lays out a tree of labels and draws the first frame
+void draw_first_frame(SDL_Renderer *renderer, SDL_Texture *target_texture, char *baked_fonts_file, i32 window_width, i32 window_height) {
+  if (baked_fonts_file != 0) {
+    load_baked_fonts(baked_fonts_file);
+  }
+  init_fonts();
+  Arena *element_arena = arena_open(4096);
+  ElementTree *tree = new_element_tree(element_arena);
+  tree->target_texture = target_texture;
+  tree->size = (TreeSize){
+    .width = window_width,
+    .height = window_height,
+  };
+  tree->root->layout_direction = layout_direction.vertical;
+  u8 variants[] = {font_variant.regular, font_variant.bold, font_variant.small, font_variant.large};
+  i32 line_count = sizeof(label_lines) / sizeof(label_lines[0]);
+  for (i32 i = 0; i < LABEL_COUNT; i++) {
+    Element *label = add_new_element(tree->arena, tree->root);
+    *label = (Element){
+      .text = to_s8(label_lines[i % line_count]),
+      .font_variant = variants[i / line_count % 4],
+      .padding = (Padding){2, 10, 2, 10},
+    };
+  }
+  set_dimensions(tree);
+  SDL_SetRenderTarget(renderer, tree->target_texture);
+  render_element_tree(renderer, tree);
+  SDL_RenderPresent(renderer);
+  free_textures(tree->root);
+  arena_close(element_arena);
+}
+
+// Closes the fonts, which frees the text runs and text rasters, and clears the glyph cache. Returns false if a text run or
+// text raster is left in its cache.
+bool reset_fonts(void) {
+  close_fonts();
+  close_baked_fonts();
+  sft_glyph_cache_clear();
+  return text_run_cache.cached_count == 0 && text_raster_cache.bytes == 0;
+}
+
+// Registers a variant of a font file that does not exist and looks it up twice. Returns false if it does not fall back
+// to the regular variant or the file is not marked as failed, so that it would be loaded again on every lookup.
+bool check_missing_font(void) {
+  init_fonts();
+  u8 missing = add_font_variant("missing-font.ttf", 15);
+  SFT *regular = get_sft(font_variant.regular);
+  bool valid = missing != font_variant.regular && get_sft(missing) == regular && get_sft(missing) == regular &&
+               get_font_height(missing) == get_font_height(font_variant.regular) && font_variants[missing].failed &&
+               font_files[font_variants[missing].file].failed;
+  close_fonts();
+  return valid;
+}
+
+bool run_case(Arena *bench_arena, SDL_Renderer *renderer, SDL_Texture *target_texture, char *name, char *baked_fonts_file, i32 window_width, i32 window_height) {
+  BenchSamples *samples = new_bench_samples(bench_arena, name);
+  unsigned long misses = 0;
+  bool closed = true;
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    u64 start = bench_start();
+    draw_first_frame(renderer, target_texture, baked_fonts_file, window_width, window_height);
+    bench_stop(samples, start);
+    // Every miss is a glyph that was rasterized for the first frame
+    misses = sft_glyph_cache.misses;
+    closed = reset_fonts() && closed;
+  }
+  print_bench_samples(samples);
+  printf("%-24s %lu glyphs rasterized\n", name, misses);
+  if (!closed) {
+    printf("close_fonts left text runs or text rasters in their caches\n");
+  }
+  return closed;
+}
+
+// Loads the first font file with its baked data and with a copy of it that has another file hash, as if another build of
+// the font had been baked. Returns false if the copy is used or the matching baked data is not.
+bool check_mismatched_baked_font(char *baked_fonts_file) {
+  if (load_baked_fonts(baked_fonts_file) == status.ERROR) return false;
+  char *file_name = font_files[0].file_name;
+  const SFT_BakedFont *baked = get_baked_font(file_name);
+  if (baked == 0) {
+    close_baked_fonts();
+    return false;
+  }
+  SFT_BakedFont mismatched = *baked;
+  mismatched.fileHash ^= 1;
+  SFT_Font *matched_font = sft_loadfile_baked(file_name, baked);
+  SFT_Font *mismatched_font = sft_loadfile_baked(file_name, &mismatched);
+  bool valid = matched_font != 0 && matched_font->baked == baked && mismatched_font != 0 && mismatched_font->baked == 0;
+  sft_freefont(matched_font);
+  sft_freefont(mismatched_font);
+  close_baked_fonts();
+  return valid;
+}
+
+i32 main(i32 argc, char **argv) {
+  i32 window_width = 640;
+  i32 window_height = 640;
+
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Window *window = SDL_CreateWindow("Startup bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_HIDDEN);
+  if (!window) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+  if (!renderer) {
+    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Texture *target_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+  Arena *bench_arena = arena_open(4096);
+
+  if (!run_case(bench_arena, renderer, target_texture, "font files", 0, window_width, window_height)) return -1;
+  if (argc > 1) {
+    if (!run_case(bench_arena, renderer, target_texture, "baked fonts", argv[1], window_width, window_height)) return -1;
+    if (!check_mismatched_baked_font(argv[1])) {
+      printf("Baked data of %s was not checked by the file hash\n", font_files[0].file_name);
+      return -1;
+    }
+    printf("Baked data of another build of %s is rejected\n", font_files[0].file_name);
+  } else {
+    printf("Pass a baked fonts file to time the first frame with it\n");
+  }
+
+  if (!check_missing_font()) {
+    printf("A variant of a missing font file did not fall back to the regular variant\n");
+    return -1;
+  }
+  printf("A variant of a missing font file falls back to the regular variant\n");
+
+  arena_close(bench_arena);
+  SDL_DestroyTexture(target_texture);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
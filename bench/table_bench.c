@@ -0,0 +1,133 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_CreateWindow, SDL_CreateRenderer, SDL_CreateTexture
+#include <stdio.h> // printf, snprintf
+#include "../constants/color_theme.c" // text_cursor_color, selection_color, scrollbar_color (used by the renderer)
+#include "../include/arena.c" // Arena, arena_open, arena_close
+#include "../include/element_tree.c" // ElementTree, new_element_tree, add_new_element, free_textures
+#include "../include/font.c" // close_fonts
+#include "../include/layout.c" // set_dimensions, scroll_y, set_y
+#include "../include/renderer.c" // render_element_tree
+#include "../include/string.c" // s8, to_s8
+#include "../include/types.c" // i32, u64, f64
+#include "../include/virtual_list.c" // virtual_list_resized
+#include "../include/virtual_table.c" // VirtualTable, new_virtual_table
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Opens a 1 000 000 x 10 virtual table and scrolls through it. Run from the repository root so that the fonts are found. Use SDL_VIDEODRIVER=dummy to run without a display.
+
+*/
+
+#define TABLE_ROWS 1000000
+#define TABLE_COLUMNS 10
+#define TEXT_SLOTS 256 // Must be larger than the number of materialized rows
+
+char *column_titles[TABLE_COLUMNS] = {
+  "Id", "Name", "Type", "Size", "Owner", "Group", "Created", "Modified", "Status", "Comment"
+};
+
+// Cell text is kept per visible row slot, so it stays valid while the row is shown
+char cell_text[TEXT_SLOTS][TABLE_COLUMNS][32];
+
+s8 get_cell_text(i32 row, i32 column) {
+  if (row == TABLE_HEADER_ROW) {
+    return to_s8(column_titles[column]);
+  }
+  char *text = cell_text[row % TEXT_SLOTS][column];
+  if (column == 0) {
+    snprintf(text, 32, "%d", row);
+  } else if (column == 1) {
+    snprintf(text, 32, "item_%d.txt", row * 7919 % 100003);
+  } else if (column == 9) {
+    snprintf(text, 32, "%s", row % 3 == 0 ? "needs review" : "ok");
+  } else {
+    snprintf(text, 32, "%d-%d", column, row % (column * 97));
+  }
+  return to_s8(text);
+}
+
+i32 main() {
+  i32 window_width = 1024;
+  i32 window_height = 768;
+  i32 scroll_steps = 2000;
+
+  if (SDL_Init(SDL_INIT_VIDEO)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Window *window = SDL_CreateWindow("Table bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_HIDDEN);
+  if (!window) {
+    printf("SDL_CreateWindow: %s\n", SDL_GetError());
+    return -1;
+  }
+  SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
+  if (!renderer) {
+    printf("SDL_CreateRenderer: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+
+  Arena *bench_arena = arena_open(4096);
+  Arena *element_arena = arena_open(4096);
+  ElementTree *tree = new_element_tree(element_arena);
+  tree->target_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, window_width, window_height);
+  tree->size = (TreeSize){
+    .width = window_width,
+    .height = window_height,
+  };
+
+  BenchSamples *open_samples = new_bench_samples(bench_arena, "open (create+layout)");
+  BenchSamples *first_render_samples = new_bench_samples(bench_arena, "first render");
+  BenchSamples *scroll_samples = new_bench_samples(bench_arena, "scroll layout");
+  BenchSamples *frame_samples = new_bench_samples(bench_arena, "scroll frame");
+
+  printf("Table %d x %d, window %d x %d\n", TABLE_ROWS, TABLE_COLUMNS, window_width, window_height);
+
+  u64 start = bench_start();
+  Element *table_element = add_new_element(tree->arena, tree->root);
+  VirtualTable *table = new_virtual_table(tree->arena, table_element, TABLE_ROWS, TABLE_COLUMNS, &get_cell_text);
+  set_dimensions(tree);
+  bench_stop(open_samples, start);
+
+  start = bench_start();
+  SDL_SetRenderTarget(renderer, tree->target_texture);
+  render_element_tree(renderer, tree);
+  SDL_RenderPresent(renderer);
+  bench_stop(first_render_samples, start);
+
+  // Scroll down in trackpad sized steps, then jump to the end and back
+  i32 pointer_x = window_width / 2;
+  i32 pointer_y = window_height / 2;
+  for (i32 i = 0; i < scroll_steps; i++) {
+    i32 delta = i == scroll_steps / 2 ? -2000000000 : (i % 2 == 0 ? -37 : -53);
+    if (i == scroll_steps - 1) {
+      delta = 2000000000;
+    }
+    u64 frame_start = bench_start();
+    scroll_y(tree->root, pointer_x, pointer_y, delta);
+    // Like handle_events, lay out again when rows have widened a column
+    if (virtual_list_resized) {
+      set_dimensions(tree);
+    }
+    bench_stop(scroll_samples, frame_start);
+    render_element_tree(renderer, tree);
+    SDL_RenderPresent(renderer);
+    bench_stop(frame_samples, frame_start);
+  }
+
+  print_bench_samples(open_samples);
+  print_bench_samples(first_render_samples);
+  print_bench_samples(scroll_samples);
+  print_bench_samples(frame_samples);
+  printf("Materialized rows: %d, element arena: %d bytes\n", table->list->virtual_list->pool_size, arena_size(element_arena));
+
+  free_textures(tree->root);
+  SDL_DestroyTexture(tree->target_texture);
+  arena_close(element_arena);
+  arena_close(bench_arena);
+  close_fonts();
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <SDL2/SDL.h> // SDL_Init, SDL_Quit
+#include <stdio.h> // printf
+#include <string.h> // memcpy, memset, strlen
+#include "../include/arena.c" // Arena, arena_open, arena_close, arena_fill
+#include "../include/array.c" // Array, array_get, array_length
+#include "../include/font.c" // init_fonts, close_fonts, get_sft, get_font_height, font_variant
+#include "../include/font_layout.c" // Line, split_string_at_width
+#include "../include/schrift.c" // SFT, SFT_Image, SFT_RenderUTF8, sft_glyph_cache, sft_glyph_cache_clear, sft_glyph_cache_set_capacity
+#include "../include/string.c" // s8, string_from_substring
+#include "../include/types.c" // i32, u8, u64
+#include "bench_helpers.c" // BenchSamples, new_bench_samples, bench_start, bench_stop, print_bench_samples
+
+/*
+
+Rasterizes a 5 000 word paragraph line by line, like the renderer does when a text element is redrawn. The uncached runs rasterize every glyph like before the glyph cache, the cold runs clear the glyph cache before every repaint and the warm runs reuse it. Run from the repository root so that the fonts are found.
+
+*/
+
+#define WORD_COUNT 5000
+#define PARAGRAPH_WIDTH 600
+#define ITERATIONS 20
+
+char *words[] = {
+  "the", "glyph", "cache", "keeps", "rendered", "characters", "so", "that", "painting",
+  "a", "long", "paragraph", "again", "only", "copies", "pixels", "instead", "of", "rasterizing",
+  "every", "outline", "from", "scratch", "Quick", "brown", "fox", "jumps", "over", "lazy", "dog,"
+};
+
+// Rasterizes every line of the paragraph into a line buffer
+void repaint_paragraph(SFT *sft, Arena *arena, s8 text, Array *lines, SFT_Image image) {
+  for (i32 i = 0; i < array_length(lines); i++) {
+    Line *line = array_get(lines, i);
+    i32 line_length = line->end_index - line->start_index;
+    if (line_length > 0) {
+      s8 line_text = string_from_substring(arena, text.data, line->start_index, line_length);
+      memset(image.pixels, 0, image.width * image.height);
+      SFT_RenderUTF8(sft, line_text.data, image);
+    }
+  }
+}
+
+i32 main(void) {
+  if (SDL_Init(0)) {
+    printf("SDL_Init: %s\n", SDL_GetError());
+    return -1;
+  }
+  if (init_fonts() == status.ERROR) return -1;
+  Arena *arena = arena_open(1024 * 1024);
+
+  // Build the paragraph from a fixed word list
+  i32 word_list_length = sizeof(words) / sizeof(words[0]);
+  i32 text_capacity = WORD_COUNT * 12;
+  u8 *text_data = arena_fill(arena, text_capacity);
+  i32 text_length = 0;
+  for (i32 i = 0; i < WORD_COUNT; i++) {
+    char *word = words[(i * 7 + i / 3) % word_list_length];
+    i32 word_length = strlen(word);
+    memcpy(text_data + text_length, word, word_length);
+    text_length += word_length;
+    text_data[text_length++] = ' ';
+  }
+  text_data[text_length] = '\0';
+  s8 text = {.data = text_data, .length = text_length};
+
+  SFT *sft = get_sft(font_variant.regular);
+  Array *lines = split_string_at_width(arena, font_variant.regular, text, PARAGRAPH_WIDTH);
+  SFT_Image image = {
+    .width = PARAGRAPH_WIDTH,
+    .height = get_font_height(font_variant.regular),
+    .pixels = arena_fill(arena, PARAGRAPH_WIDTH * get_font_height(font_variant.regular)),
+  };
+  printf("%d words in %d lines\n", WORD_COUNT, array_length(lines));
+
+  BenchSamples *uncached = new_bench_samples(arena, "repaint uncached");
+  BenchSamples *cold = new_bench_samples(arena, "repaint cold");
+  BenchSamples *warm = new_bench_samples(arena, "repaint warm");
+  sft_glyph_cache_set_capacity(0);
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    Arena *line_arena = arena_open(4096);
+    u64 start = bench_start();
+    repaint_paragraph(sft, line_arena, text, lines, image);
+    bench_stop(uncached, start);
+    arena_close(line_arena);
+  }
+  sft_glyph_cache_set_capacity(GLYPH_CACHE_DEFAULT_CAPACITY);
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    sft_glyph_cache_clear();
+    Arena *line_arena = arena_open(4096);
+    u64 start = bench_start();
+    repaint_paragraph(sft, line_arena, text, lines, image);
+    bench_stop(cold, start);
+    arena_close(line_arena);
+  }
+  for (i32 i = 0; i < ITERATIONS; i++) {
+    Arena *line_arena = arena_open(4096);
+    u64 start = bench_start();
+    repaint_paragraph(sft, line_arena, text, lines, image);
+    bench_stop(warm, start);
+    arena_close(line_arena);
+  }
+  print_bench_samples(uncached);
+  print_bench_samples(cold);
+  print_bench_samples(warm);
+  printf("glyph cache: %lu hits, %lu misses, %lu evictions, %zu bytes\n",
+         sft_glyph_cache.hits, sft_glyph_cache.misses, sft_glyph_cache.evictions, sft_glyph_cache.size);
+
+  arena_close(arena);
+  close_fonts();
+  SDL_Quit();
+  return 0;
+}
@@ -14,6 +14,7 @@ Dynamic array implementation that has the following functions:
  - array_pop: removes the last element from the array
  - array_get: returns the element at the given index
  - array_set: sets the element at the given index
+ - array_move: moves a range of elements to another index, like memmove
  - array_length: returns the used size of the array
  - array_last: returns the last index of the array
 
@@ -144,6 +145,19 @@ static void *index_get(IndexGetParams params) {
   }
 }
 
+// Get the index node of the item at the given index
+static IndexNode *index_node_get(IndexGetParams params) {
+  if (params.indexNode == 0 || params.index == 0) {
+    return params.indexNode;
+  }
+  IndexGetParams next_params = {
+    .indexNode = params.indexNode->children[params.index % params.index_width],
+    .index = params.index / params.index_width,
+    .index_width = params.index_width
+  };
+  return index_node_get(next_params);
+}
+
 // Create a new array width a given item size and index width and return a pointer to it
 // Item size is the size of each item in the array
 // Index width is the number of children each node can have.
@@ -241,6 +255,37 @@ void array_set(Array *array, i32 index, void *data) {
   memcpy(item, data, array->item_size);
 }
 
+// Move count items starting at from so that they start at to instead
+// The ranges can overlap and both have to be within the length of the array
+// The items are moved in the index and not copied, so pointers to items follow them. The items that are overwritten
+// take the slots that the moved items leave, in the same order.
+void array_move(Array *array, i32 from, i32 to, i32 count) {
+  if (count <= 0 || from == to) return;
+  if (from < 0 || to < 0 || from + count > array->length || to + count > array->length) return;
+  // Rotate the slots from the first to the last index of both ranges, following cycles so that every item moves once
+  i32 first = from < to ? from : to;
+  i32 length = (from < to ? to : from) + count - first;
+  i32 shift = (to - from + length) % length;
+  i32 cycle_count = length;
+  for (i32 rest = shift; rest != 0;) {
+    i32 next = cycle_count % rest;
+    cycle_count = rest;
+    rest = next;
+  }
+  for (i32 start = 0; start < cycle_count; start++) {
+    IndexNode *node = index_node_get((IndexGetParams){array->index, first + start, array->index_width});
+    void *start_item = node->item;
+    i32 source = (start - shift + length) % length;
+    while (source != start) {
+      IndexNode *source_node = index_node_get((IndexGetParams){array->index, first + source, array->index_width});
+      node->item = source_node->item;
+      node = source_node;
+      source = (source - shift + length) % length;
+    }
+    node->item = start_item;
+  }
+}
+
 // Return the used size of the array
 i32 array_length(Array *array) {
   return array->length;
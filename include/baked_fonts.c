@@ -0,0 +1,191 @@
+#ifndef C9_BAKED_FONTS
+
+#include <fcntl.h> // open
+#include <stdbool.h> // bool
+#include <stdio.h> // printf
+#include <string.h> // memset, strcmp
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close
+#include "arena.c" // Arena, arena_open, arena_fill, arena_close
+#include "schrift.c" // SFT_BakedFont, SFT_BakedSize, SFT_BakedGlyph, GLYPH_CACHE_SUBPIXELS, COMMON_GLYPH_COUNT
+#include "status.c" // status
+#include "types.c" // i32, u32, u64, f64
+
+/*
+
+Baked fonts are glyph bitmaps, metrics and kerning that are rendered ahead of time by `tools/bake_fonts.c` and stored in one binary file. The file is mapped at startup with load_baked_fonts, before the fonts are loaded. A font file that has baked data then uses the baked lookup tables (glyph ids of the common code points, advance widths and kerning pairs) instead of building them from the font tables, and its baked glyphs are drawn straight from the mapped file instead of being rasterized on the first frame. Glyphs, sizes and fonts that were not baked are rendered from the font file as before.
+
+The baked data of a font is only used if the font file has the same size, glyph count and hash (sft_font_hash) as the file it was baked from, so another build of the same font is loaded from its file. The file is written in the byte order of the machine that baked it and is rejected if the magic number does not match.
+
+```c
+load_baked_fonts("fonts.baked"); // Before init_fonts
+init_fonts();
+```
+
+*/
+
+#define BAKED_FONTS_MAGIC 0x42463943 // "C9FB" in little endian
+#define BAKED_FONTS_VERSION 2
+#define BAKED_FONTS_MAX_FILES 8
+#define BAKED_FONT_NAME_LENGTH 64
+
+// The file starts with a header followed by one font record per font file. All offsets are from the start of the file.
+typedef struct {
+  u32 magic;
+  u32 version;
+  u32 font_count;
+  u32 reserved;
+} BakedFontsHeader;
+
+typedef struct {
+  char file_name[BAKED_FONT_NAME_LENGTH];
+  u32 file_size; // Size of the font file
+  u32 glyph_count; // Number of glyphs in the font
+  u32 kerning_slots; // Number of slots in the kerning map, 0 if the font has no kerning
+  u32 size_count;
+  u64 file_hash; // sft_font_hash of the font file
+  u64 common_glyphs; // COMMON_GLYPH_COUNT u16 glyph ids
+  u64 advances; // glyph_count u16 advance widths
+  u64 kerning_keys; // kerning_slots u32 keys
+  u64 kerning_values; // kerning_slots i16 values
+  u64 sizes; // size_count size records
+} BakedFontRecord;
+
+typedef struct {
+  f64 x_scale;
+  f64 y_scale;
+  u32 glyph_count; // Number of baked bitmaps
+  u32 pixel_bytes;
+  u64 glyph_index; // glyph_count of the font times GLYPH_CACHE_SUBPIXELS u32 indexes plus one, 0 if not baked
+  u64 glyphs; // glyph_count SFT_BakedGlyph
+  u64 pixels; // pixel_bytes of bitmaps
+} BakedSizeRecord;
+
+typedef struct {
+  const u8 *memory; // Mapped file
+  u64 size;
+  Arena *arena; // Holds the baked fonts and sizes
+  i32 font_count;
+  char *file_names[BAKED_FONTS_MAX_FILES]; // Point into the mapped file
+  SFT_BakedFont fonts[BAKED_FONTS_MAX_FILES];
+} BakedFonts;
+
+BakedFonts baked_fonts = {0};
+
+// Returns true if length bytes at offset are inside the mapped file
+static bool is_baked_range(u64 offset, u64 length) {
+  return offset <= baked_fonts.size && length <= baked_fonts.size - offset && offset % 8 == 0;
+}
+
+// Unmaps the baked fonts. Fonts that use them have to be closed first.
+void close_baked_fonts(void) {
+  if (baked_fonts.memory != 0) {
+    munmap((void *)baked_fonts.memory, baked_fonts.size);
+  }
+  if (baked_fonts.arena != 0) {
+    arena_close(baked_fonts.arena);
+  }
+  memset(&baked_fonts, 0, sizeof(baked_fonts));
+}
+
+// Maps a baked fonts file and checks every record. Fonts loaded after this use the baked data of their file.
+i32 load_baked_fonts(char *file_name) {
+  if (baked_fonts.memory != 0) return status.OK;
+  i32 file = open(file_name, O_RDONLY);
+  if (file < 0) {
+    printf("Failed to open baked fonts %s\n", file_name);
+    return status.ERROR;
+  }
+  struct stat info;
+  if (fstat(file, &info) < 0 || info.st_size < (off_t)sizeof(BakedFontsHeader)) {
+    close(file);
+    return status.ERROR;
+  }
+  void *memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (memory == MAP_FAILED) return status.ERROR;
+  baked_fonts.memory = memory;
+  baked_fonts.size = (u64)info.st_size;
+
+  const BakedFontsHeader *header = memory;
+  if (header->magic != BAKED_FONTS_MAGIC || header->version != BAKED_FONTS_VERSION ||
+      header->font_count > BAKED_FONTS_MAX_FILES ||
+      !is_baked_range(sizeof(BakedFontsHeader), header->font_count * sizeof(BakedFontRecord))) {
+    printf("Invalid baked fonts %s\n", file_name);
+    close_baked_fonts();
+    return status.ERROR;
+  }
+  baked_fonts.arena = arena_open(4096);
+  const BakedFontRecord *records = (const BakedFontRecord *)(baked_fonts.memory + sizeof(BakedFontsHeader));
+  for (u32 i = 0; i < header->font_count; i++) {
+    const BakedFontRecord *record = &records[i];
+    u64 glyph_count = record->glyph_count;
+    if (record->file_name[BAKED_FONT_NAME_LENGTH - 1] != 0 || glyph_count > 0xFFFF ||
+        (record->kerning_slots & (record->kerning_slots - 1)) != 0 ||
+        !is_baked_range(record->common_glyphs, COMMON_GLYPH_COUNT * sizeof(u16)) ||
+        !is_baked_range(record->advances, glyph_count * sizeof(u16)) ||
+        !is_baked_range(record->kerning_keys, record->kerning_slots * sizeof(u32)) ||
+        !is_baked_range(record->kerning_values, record->kerning_slots * sizeof(i16)) ||
+        !is_baked_range(record->sizes, record->size_count * sizeof(BakedSizeRecord))) {
+      continue;
+    }
+    SFT_BakedSize *sizes = arena_fill(baked_fonts.arena, (record->size_count + 1) * sizeof(SFT_BakedSize));
+    i32 size_count = 0;
+    const BakedSizeRecord *size_records = (const BakedSizeRecord *)(baked_fonts.memory + record->sizes);
+    for (u32 s = 0; s < record->size_count; s++) {
+      const BakedSizeRecord *size = &size_records[s];
+      if (!is_baked_range(size->glyph_index, glyph_count * GLYPH_CACHE_SUBPIXELS * sizeof(u32)) ||
+          !is_baked_range(size->glyphs, size->glyph_count * sizeof(SFT_BakedGlyph)) ||
+          !is_baked_range(size->pixels, size->pixel_bytes)) {
+        continue;
+      }
+      // Every index and bitmap has to be inside the size, so that drawing needs no checks
+      const u32 *glyph_index = (const u32 *)(baked_fonts.memory + size->glyph_index);
+      const SFT_BakedGlyph *glyphs = (const SFT_BakedGlyph *)(baked_fonts.memory + size->glyphs);
+      bool valid = true;
+      for (u64 g = 0; g < glyph_count * GLYPH_CACHE_SUBPIXELS && valid; g++) {
+        valid = glyph_index[g] <= size->glyph_count;
+      }
+      for (u32 g = 0; g < size->glyph_count && valid; g++) {
+        valid = (u64)glyphs[g].pixels + (u64)glyphs[g].width * glyphs[g].height <= size->pixel_bytes;
+      }
+      if (!valid) continue;
+      sizes[size_count++] = (SFT_BakedSize){
+        .xScale = size->x_scale,
+        .yScale = size->y_scale,
+        .glyphIndex = glyph_index,
+        .glyphs = glyphs,
+        .pixels = baked_fonts.memory + size->pixels,
+      };
+    }
+    i32 font = baked_fonts.font_count++;
+    baked_fonts.file_names[font] = (char *)record->file_name;
+    baked_fonts.fonts[font] = (SFT_BakedFont){
+      .fileSize = record->file_size,
+      .fileHash = record->file_hash,
+      .numGlyphs = (uint_least16_t)glyph_count,
+      .commonGlyphs = (const uint16_t *)(baked_fonts.memory + record->common_glyphs),
+      .advances = (const uint16_t *)(baked_fonts.memory + record->advances),
+      .kernKeys = (const uint32_t *)(baked_fonts.memory + record->kerning_keys),
+      .kernValues = (const int16_t *)(baked_fonts.memory + record->kerning_values),
+      .kernMask = record->kerning_slots > 0 ? record->kerning_slots - 1 : 0,
+      .numSizes = size_count,
+      .sizes = sizes,
+    };
+  }
+  return status.OK;
+}
+
+// Returns the baked data of a font file, or 0 if the file was not baked
+const SFT_BakedFont *get_baked_font(char *file_name) {
+  for (i32 i = 0; i < baked_fonts.font_count; i++) {
+    if (strcmp(baked_fonts.file_names[i], file_name) == 0) {
+      return &baked_fonts.fonts[i];
+    }
+  }
+  return 0;
+}
+
+#define C9_BAKED_FONTS
+#endif
@@ -3,12 +3,10 @@
 #include "blue_noise_texture_u8.c"
 #include "types.c" // f32, i32
 
-// Function to get a blue noise value from the texture
+// Function to get a blue noise value from the texture (see dither.c for integer offsets)
 f32 get_blue_noise_value(i32 x, i32 y) {
-  // Ensure coordinates are within bounds
-  x = x % 32;
-  y = y % 32;
-  return 1.0 * blue_noise_texture_u8[x][y] / 255;
+  // Wrap the coordinates to the texture, also when they are negative
+  return blue_noise_texture_u8[x & 31][y & 31] / 255.0;
 }
 
 #define C9_BLUE_NOISE
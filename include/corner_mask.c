@@ -0,0 +1,91 @@
+#ifndef C9_CORNER_MASK
+
+#include <math.h> // pow
+#include <stdlib.h> // malloc, free
+#include "font.c" // on_close_fonts
+#include "types.c" // f32, i32, u8
+
+/*
+
+A corner mask holds the coverage of one quadrant of a superellipse corner, so that rounded rectangles do not evaluate x^4 + y^4 for every corner pixel each time they are drawn. Rows and columns are distances from the center of the corner. Each row starts with a solid part that is drawn as is, followed by an antialiased part that is blended and then the uncovered rest. An antialiased pixel can have a coverage of 0 and is still drawn, so the extent of each row is kept besides the coverage.
+
+Masks are built the first time a radius is drawn and kept for radii below CORNER_MASK_CACHE_RADII. Borders use the mask of the outer radius and the mask of the inner radius, so a theme with a few radii only ever builds a few masks. Larger corners get a mask that is freed after drawing. The cached masks are freed by close_fonts, with the other caches of drawing.
+
+*/
+
+#define CORNER_MASK_CACHE_RADII 256
+
+typedef struct {
+  i32 radius;
+  i32 *solid; // Fully covered pixels at the start of each row
+  i32 *extent; // Drawn pixels at the start of each row
+  u8 *coverage; // radius * radius coverage values, row by row
+} CornerMask;
+
+CornerMask *corner_masks[CORNER_MASK_CACHE_RADII];
+
+static CornerMask *new_corner_mask(i32 radius) {
+  CornerMask *mask = malloc(sizeof(CornerMask) + 2 * radius * sizeof(i32) + radius * radius);
+  if (mask == 0) return 0;
+  mask->radius = radius;
+  mask->solid = (i32 *)(mask + 1);
+  mask->extent = mask->solid + radius;
+  mask->coverage = (u8 *)(mask->extent + radius);
+
+  // Set thresholds for antialiasing and boundary detection
+  f32 antialiasing_threshold = pow(radius - 1, 4);
+  f32 boundary_squared = pow(radius, 4);
+  for (i32 y = 0; y < radius; y++) {
+    u8 *row = mask->coverage + y * radius;
+    mask->solid[y] = 0;
+    mask->extent[y] = 0;
+    for (i32 x = 0; x < radius; x++) {
+      f32 distance_squared = pow(x, 4) + pow(y, 4);
+      row[x] = 0;
+      // Check if the point is within the solid part of the corner
+      if (distance_squared <= antialiasing_threshold) {
+        row[x] = 255;
+        mask->solid[y] = x + 1;
+        mask->extent[y] = x + 1;
+      }
+      // Apply antialiasing for points near the edge of the corner
+      else if (distance_squared <= boundary_squared) {
+        f32 opacity = (boundary_squared - distance_squared) / (boundary_squared - antialiasing_threshold);
+        if (opacity < 0.0) opacity = 0.0;
+        if (opacity > 1.0) opacity = 1.0;
+        row[x] = (u8)(opacity * 255);
+        mask->extent[y] = x + 1;
+      }
+    }
+  }
+  return mask;
+}
+
+// Frees every cached mask
+void clear_corner_masks(void) {
+  for (i32 radius = 0; radius < CORNER_MASK_CACHE_RADII; radius++) {
+    free(corner_masks[radius]);
+    corner_masks[radius] = 0;
+  }
+}
+
+// Returns the mask of a corner radius, building it if it is not cached. Call release_corner_mask when done.
+CornerMask *get_corner_mask(i32 radius) {
+  if (radius <= 0) return 0;
+  if (radius >= CORNER_MASK_CACHE_RADII) return new_corner_mask(radius);
+  if (corner_masks[radius] == 0) {
+    corner_masks[radius] = new_corner_mask(radius);
+    on_close_fonts(&clear_corner_masks);
+  }
+  return corner_masks[radius];
+}
+
+// Frees a mask that is too large to be cached
+void release_corner_mask(CornerMask *mask) {
+  if (mask != 0 && mask->radius >= CORNER_MASK_CACHE_RADII) {
+    free(mask);
+  }
+}
+
+#define C9_CORNER_MASK
+#endif
@@ -0,0 +1,47 @@
+#ifndef C9_DITHER
+
+#include "blue_noise_texture_u8.c" // blue_noise_texture_u8
+#include "types.c" // i32, f32
+
+/*
+
+A dither tile is the 32 x 32 blue noise texture scaled to integer offsets, like the offsets that a gradient adds to its positions. The texture is indexed [x][y], while the tile is stored row by row, so that a row of pixels reads its offsets in order. The noise repeats every 32 pixels, so x & 31 and y & 31 pick the offset of a pixel.
+
+Every row ends with a copy of its first DITHER_ROW_PADDING offsets, so that a vector of offsets can be loaded from any column of a row without wrapping.
+
+```c
+DitherTile tile;
+set_dither_tile(&tile, 1.5, 1000);
+i32 *offsets = get_dither_row(&tile, y);
+i32 offset = offsets[x & DITHER_TILE_MASK];
+```
+
+*/
+
+#define DITHER_TILE_SIZE 32 // Size of the blue noise texture
+#define DITHER_TILE_MASK (DITHER_TILE_SIZE - 1)
+#define DITHER_ROW_PADDING 8
+
+typedef struct {
+  i32 offsets[DITHER_TILE_SIZE][DITHER_TILE_SIZE + DITHER_ROW_PADDING]; // offsets[y][x]
+} DitherTile;
+
+// Fills the tile with the noise of each pixel (0 to 255) times scale, clamped to -limit and limit
+void set_dither_tile(DitherTile *tile, f32 scale, i32 limit) {
+  for (i32 y = 0; y < DITHER_TILE_SIZE; y++) {
+    for (i32 x = 0; x < DITHER_TILE_SIZE + DITHER_ROW_PADDING; x++) {
+      f32 offset = blue_noise_texture_u8[x & DITHER_TILE_MASK][y] * scale;
+      if (offset < -limit) offset = -limit;
+      if (offset > limit) offset = limit;
+      tile->offsets[y][x] = (i32)offset;
+    }
+  }
+}
+
+// Returns the offsets of row y, indexed by x & DITHER_TILE_MASK
+static inline i32 *get_dither_row(DitherTile *tile, i32 y) {
+  return tile->offsets[y & DITHER_TILE_MASK];
+}
+
+#define C9_DITHER
+#endif
@@ -2,10 +2,20 @@
 
 #include <SDL2/SDL.h>
 #include <stdbool.h> // bool
-#include "color.c" // RGBA, get_dithered_gradient_color, C9_Gradient, red, green, blue, alpha
-#include "font_layout.c" // split_string_at_width, get_text_line_height
+#include <string.h> // memcpy, memset
+#include "color.c" // RGBA, C9_Gradient, red, green, blue, alpha
+#include "corner_mask.c" // CornerMask, get_corner_mask, release_corner_mask
+#include "dither.c" // get_dither_row, DITHER_TILE_SIZE, DITHER_TILE_MASK
+#include "font.c" // get_sft
+#include "font_layout.c" // get_text_line_height
+#include "gradient.c" // GradientTable, GradientAxis, get_gradient_table, get_gradient_axis, get_gradient_pixel, fill_horizontal_gradient_span, fill_vertical_gradient_span
+#include "pixel_span.c" // fill_span, copy_span, blend_mask_span
+#include "schrift.c" // SFT, SFT_Image, SFT_RenderShaped
 #include "stb_image.c" // stbi_load
-#include "types.c" // u8, f32, i32
+#include "string.c" // s8
+#include "text_run.c" // TextRun, get_text_run_index, get_text_run_index_at_x
+#include "text_worker.c" // get_text_run_async, get_shaped_text_run_async, wrap_text_run_async
+#include "types.c" // u8, f32, f64, i32
 #include "types_common.c" // Border, Padding
 
 // Locked texture as pixel data
@@ -15,21 +25,29 @@ typedef struct {
   i32 height;
 } PixelData;
 
+// Coverage of rasterized text, kept so that the text can be blended again without rasterizing it (see text_raster.c)
+typedef struct {
+  u8 *pixels; // rect.w * rect.h coverage values
+  SDL_Rect rect; // Part of the target the coverage covers
+} TextCoverage;
+
 void draw_image(PixelData target, char *image_url, SDL_Rect image_position) {
   i32 width = 0;
   i32 height = 0;
   i32 components = 0;
   u8 *data = stbi_load(image_url, &width, &height, &components, 4);
   if (data != 0) {
-    for (i32 x = 0; x < width; x++) {
-      if (x < image_position.w) {
-        for (i32 y = 0; y < height; y++) {
-          if (y < image_position.h) {
-            RGBA image_pixel = RGBA_from_u8(data[(y * width + x) * 4 + 0], data[(y * width + x) * 4 + 1], data[(y * width + x) * 4 + 2], data[(y * width + x) * 4 + 3]);
-            target.pixels[(image_position.y + y) * target.width + image_position.x + x] = image_pixel;
-          }
-        }
+    // Clip the image to its position once instead of checking every pixel
+    i32 visible_width = width < image_position.w ? width : image_position.w;
+    i32 visible_height = height < image_position.h ? height : image_position.h;
+    for (i32 y = 0; y < visible_height; y++) {
+      // Convert the row to RGBA in place and copy it to the target, replacing the pixels under the image
+      u8 *image_row = data + y * width * 4;
+      RGBA *image_pixels = (RGBA *)image_row;
+      for (i32 x = 0; x < visible_width; x++) {
+        image_pixels[x] = RGBA_from_u8(image_row[x * 4 + 0], image_row[x * 4 + 1], image_row[x * 4 + 2], image_row[x * 4 + 3]);
       }
+      copy_span(target.pixels + (image_position.y + y) * target.width + image_position.x, image_pixels, visible_width);
     }
     stbi_image_free(data);
   }
@@ -59,68 +77,147 @@ void renderer_draw_image(SDL_Renderer *renderer, char *image_url, SDL_Rect image
   }
 }
 
-void draw_text(PixelData target, SFT *sft, u8 *text, RGBA color, SDL_Rect text_position, Padding padding) {
-  // Check if text has any content
-  if (text[0] != '\0') {
-    Arena *temp_arena = arena_open(256);
-
-    i32 pixel_count = text_position.w * text_position.h;
-    u8 *pixels = arena_fill(temp_arena, pixel_count * sizeof(u8));
-    // arena_fill does not zero allocated memory
-    for (i32 i = 0; i < pixel_count; i++) {
-      pixels[i] = 0;
-    }
-
-    SFT_Image image = {
-      .width = text_position.w,
-      .height = text_position.h,
-      .pixels = pixels,
-    };
-    if (SFT_RenderUTF8(sft, text, image) < 0) {
-      printf("Failed to render text\n");
-      return;
-    }
-    // Loop over text pixels
-    for (i32 x = 0; x < image.width; x++) {
-      // Check if we're inside the target bounds
-      if (text_position.x + x < target.width - padding.right &&
-          text_position.x + x >= padding.left) {
-        for (i32 y = 0; y < image.height; y++) {
-          if (text_position.y + y < target.height) {
-            i32 pixel_index = (text_position.y + y) * target.width + text_position.x + x;
-            // Get the pixel from the text surface
-            u8 text_alpha = pixels[y * image.width + x];
-            if (text_alpha > 0) {
-              RGBA target_pixel = target.pixels[pixel_index];
-              RGBA blended_pixel = blend_alpha(target_pixel, color, text_alpha);
-              target.pixels[pixel_index] = blended_pixel;
-            }
-          }
-        }
-      }
+// Draws count characters of a shaped run, starting at the character first, as a single line of line_height pixels
+// Only the part of the line that is inside the target and the padding is rasterized, into a buffer of that size
+// With coverage, the rasterized pixels are written to the coverage instead of being blended into the target
+static void draw_text_run(PixelData target, TextCoverage *coverage, SFT *sft, TextRun *run, i32 first, i32 count, i32 line_height, RGBA color, SDL_Rect text_position, Padding padding) {
+  // Find the visible part of the line
+  i32 left = text_position.x > padding.left ? text_position.x : padding.left;
+  i32 right = text_position.x + text_position.w;
+  if (right > target.width - padding.right) {
+    right = target.width - padding.right;
+  }
+  i32 top = text_position.y > 0 ? text_position.y : 0;
+  i32 bottom = text_position.y + (text_position.h < line_height ? text_position.h : line_height);
+  if (bottom > target.height) {
+    bottom = target.height;
+  }
+  if (count <= 0 || left >= right || top >= bottom) return;
+
+  // Only rasterize the characters that reach into the visible part, with a margin of one em for glyphs that are wider than their advance
+  f64 visible_x = run->pens[first] - text_position.x;
+  f64 margin = sft->xScale;
+  i32 visible_first = get_text_run_index_at_x(run, visible_x + left - margin);
+  i32 visible_end = get_text_run_index_at_x(run, visible_x + right + margin) + 1;
+  if (visible_first < first) {
+    visible_first = first;
+  }
+  if (visible_end > first + count) {
+    visible_end = first + count;
+  }
+  if (visible_first >= visible_end) return;
+
+  Arena *temp_arena = arena_open(256);
+  i32 pixel_count = (right - left) * (bottom - top);
+  u8 *pixels = arena_fill(temp_arena, pixel_count * sizeof(u8));
+  // arena_fill does not zero allocated memory
+  memset(pixels, 0, pixel_count);
+
+  SFT_Image image = {
+    .width = right - left,
+    .height = bottom - top,
+    .pixels = pixels,
+  };
+  // Move the first character of the line to the left edge of the text and the text to the visible part
+  if (SFT_RenderShaped(sft, run->glyphs + visible_first, run->pens + visible_first, visible_end - visible_first, text_position.x - left - run->pens[first], text_position.y - top, image) < 0) {
+    printf("Failed to render text\n");
+    arena_close(temp_arena);
+    return;
+  }
+  if (coverage != 0) {
+    for (i32 y = 0; y < image.height; y++) {
+      u8 *coverage_row = coverage->pixels + (top + y - coverage->rect.y) * coverage->rect.w + left - coverage->rect.x;
+      memcpy(coverage_row, pixels + y * image.width, image.width);
     }
     arena_close(temp_arena);
+    return;
+  }
+  // Blend the text pixels into the target
+  for (i32 y = 0; y < image.height; y++) {
+    blend_mask_span(target.pixels + (top + y) * target.width + left, pixels + y * image.width, image.width, color);
   }
+  arena_close(temp_arena);
 }
 
-void draw_multiline_text(PixelData target, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, Padding padding) {
+// Draws a single line of text
+static void paint_text(PixelData target, TextCoverage *coverage, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, Padding padding) {
   // Check if text has any content
-  if (text.data != 0 && text.data[0] != '\0') {
+  if (text.data != 0 && text.length > 0) {
     SFT *sft = get_sft(font_variant);
+    // Large texts are not drawn until the text worker has shaped them
+    TextRun *run = get_shaped_text_run_async(font_variant, text);
+    if (sft == 0 || run == 0) return;
+    draw_text_run(target, coverage, sft, run, 0, run->glyph_count, text_position.h, color, text_position, padding);
+  }
+}
+
+// Draws text wrapped to the width of text_position, using the same shaped run for all lines
+static void paint_multiline_text(PixelData target, TextCoverage *coverage, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, Padding padding) {
+  // Check if text has any content
+  if (text.data != 0 && text.length > 0) {
+    SFT *sft = get_sft(font_variant);
+    // Large texts are drawn with their last layout until the text worker has wrapped them at this width
+    TextRun *run = get_text_run_async(font_variant, text, text_position.w);
+    if (sft == 0 || run == 0) return;
     i32 line_height = get_text_line_height(font_variant);
-    Arena *temp_arena = arena_open(256);
-    Array *indexes = split_string_at_width(temp_arena, font_variant, text, text_position.w);
-    for (i32 i = 0; i < array_length(indexes); i++) {
-      Line *line = array_get(indexes, i);
-      i32 line_length = line->end_index - line->start_index;
-      if (line_length > 0) {
-        // Trims and adds null terminator
-        s8 trimmed_line = string_from_substring(temp_arena, text.data, line->start_index, line_length);
-        draw_text(target, sft, trimmed_line.data, color, text_position, padding);
-      }
+    Array *lines = wrap_text_run_async(run, text_position.w);
+    if (lines == 0) return;
+    i32 text_bottom = text_position.y + text_position.h;
+    // Skip the lines above the target
+    i32 first_line = text_position.y < 0 ? -text_position.y / line_height : 0;
+    text_position.y += first_line * line_height;
+    for (i32 i = first_line; i < array_length(lines); i++) {
+      // Stop at the first line below the target
+      if (text_position.y >= target.height) break;
+      Line *line = array_get(lines, i);
+      i32 first = get_text_run_index(run, line->start_index);
+      i32 end = get_text_run_index(run, line->end_index);
+      text_position.h = text_bottom - text_position.y;
+      draw_text_run(target, coverage, sft, run, first, end - first, line_height, color, text_position, padding);
       text_position.y += line_height;
     }
-    arena_close(temp_arena);
+  }
+}
+
+// Draws a single line of text
+void draw_text(PixelData target, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, Padding padding) {
+  paint_text(target, 0, font_variant, text, color, text_position, padding);
+}
+
+// Draws text wrapped to the width of text_position
+void draw_multiline_text(PixelData target, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, Padding padding) {
+  paint_multiline_text(target, 0, font_variant, text, color, text_position, padding);
+}
+
+// Returns the part of the target that text drawn at text_position can cover: inside the target, the side padding and the text
+SDL_Rect get_text_area(PixelData target, SDL_Rect text_position, Padding padding) {
+  i32 left = text_position.x > padding.left ? text_position.x : padding.left;
+  i32 right = text_position.x + text_position.w;
+  if (right > target.width - padding.right) {
+    right = target.width - padding.right;
+  }
+  i32 top = text_position.y > 0 ? text_position.y : 0;
+  i32 bottom = text_position.y + text_position.h;
+  if (bottom > target.height) {
+    bottom = target.height;
+  }
+  if (left >= right || top >= bottom) return (SDL_Rect){0};
+  return (SDL_Rect){left, top, right - left, bottom - top};
+}
+
+// Rasterizes text like draw_text or draw_multiline_text, into a zeroed coverage of the text area instead of the target
+void rasterize_text(PixelData target, TextCoverage *coverage, u8 font_variant, s8 text, SDL_Rect text_position, Padding padding, bool multiline) {
+  if (multiline) {
+    paint_multiline_text(target, coverage, font_variant, text, 0, text_position, padding);
+  } else {
+    paint_text(target, coverage, font_variant, text, 0, text_position, padding);
+  }
+}
+
+// Blends rasterized text into the target with a color, which gives the same pixels as drawing the text
+void blend_text_coverage(PixelData target, TextCoverage coverage, RGBA color) {
+  for (i32 y = 0; y < coverage.rect.h; y++) {
+    blend_mask_span(target.pixels + (coverage.rect.y + y) * target.width + coverage.rect.x, coverage.pixels + y * coverage.rect.w, coverage.rect.w, color);
   }
 }
 
@@ -140,6 +237,17 @@ void renderer_fill_rectangle(SDL_Renderer *renderer, SDL_Rect rectangle, RGBA co
   SDL_RenderFillRect(renderer, &rectangle);
 }
 
+// Fills the part of a rectangle that is inside the target
+static void fill_clipped_rectangle(PixelData target, SDL_Rect rectangle, RGBA color) {
+  i32 left = rectangle.x > 0 ? rectangle.x : 0;
+  i32 right = rectangle.x + rectangle.w < target.width ? rectangle.x + rectangle.w : target.width;
+  i32 top = rectangle.y > 0 ? rectangle.y : 0;
+  i32 bottom = rectangle.y + rectangle.h < target.height ? rectangle.y + rectangle.h : target.height;
+  for (i32 y = top; y < bottom; y++) {
+    fill_span(target.pixels + y * target.width + left, right - left, color);
+  }
+}
+
 // Draws a filled rectangle with optional superellipse corners
 void draw_filled_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radius, RGBA background_color) {
   if (corner_radius > 0) {
@@ -155,11 +263,7 @@ void draw_filled_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radi
       .w = rectangle.w - 2 * corner_radius,
       .h = corner_radius
     };
-    for (i32 y = 0; y < top_rect.h; y++) {
-      for (i32 x = 0; x < top_rect.w; x++) {
-        target.pixels[(top_rect.y + y) * target.width + top_rect.x + x] = background_color;
-      }
-    }
+    fill_clipped_rectangle(target, top_rect, background_color);
 
     // Fill the area between the bottom corners
     SDL_Rect bottom_rect = {
@@ -168,11 +272,7 @@ void draw_filled_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radi
       .w = rectangle.w - 2 * corner_radius,
       .h = corner_radius
     };
-    for (i32 y = 0; y < bottom_rect.h; y++) {
-      for (i32 x = 0; x < bottom_rect.w; x++) {
-        target.pixels[(bottom_rect.y + y) * target.width + bottom_rect.x + x] = background_color;
-      }
-    }
+    fill_clipped_rectangle(target, bottom_rect, background_color);
 
     // Center points for the corners
     i32 left_center_x = rectangle.x + corner_radius - 1;
@@ -180,52 +280,33 @@ void draw_filled_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radi
     i32 top_center_y = rectangle.y + corner_radius - 1;
     i32 bottom_center_y = rectangle.y + rectangle.h - corner_radius;
 
-    // Set thresholds for antialiasing and boundary detection
-    f32 antialiasing_threshold = pow(corner_radius - 1, 4);
-    f32 boundary_squared = pow(corner_radius, 4);
-    bool inside_shape = false;
-
-    RGBA draw_color = background_color;
-    // Calculate points for one quadrant and mirror it the other quadrants
-    for (i32 x = 0; x < corner_radius; x++) {
+    // Draw one quadrant from the corner mask and mirror it to the other quadrants
+    CornerMask *mask = get_corner_mask(corner_radius);
+    if (mask != 0) {
       for (i32 y = 0; y < corner_radius; y++) {
-        f32 distance_squared = pow(x, 4) + pow(y, 4);
-        inside_shape = false;
-        // Check if the point is within the solid part of the corner
-        if (distance_squared <= antialiasing_threshold) {
-          draw_color = background_color;
-          inside_shape = true;
-        }
-        // Apply antialiasing for points near the edge of the corner
-        else if (distance_squared <= boundary_squared) {
-          f32 opacity = 1.0;
-          if (distance_squared > antialiasing_threshold) {
-            // Calculate opacity for antialiasing effect
-            opacity = (boundary_squared - distance_squared) / (boundary_squared - antialiasing_threshold);
-            // Clamp opacity between 0 and 1
-            opacity = clamp(opacity, 0.0, 1.0);
-          }
-          draw_color = set_alpha(background_color, (u8)(opacity * 255));
-
+        RGBA *top_left = target.pixels + (top_center_y - y) * target.width + left_center_x;
+        RGBA *top_right = target.pixels + (top_center_y - y) * target.width + right_center_x;
+        RGBA *bottom_left = target.pixels + (bottom_center_y + y) * target.width + left_center_x;
+        RGBA *bottom_right = target.pixels + (bottom_center_y + y) * target.width + right_center_x;
+        u8 *coverage = mask->coverage + y * corner_radius;
+        i32 solid = mask->solid[y];
+        i32 extent = mask->extent[y];
+        fill_span(top_left - solid + 1, solid, background_color);
+        fill_span(top_right, solid, background_color);
+        for (i32 x = solid; x < extent; x++) {
+          RGBA draw_color = set_alpha(background_color, coverage[x]);
           // Blend inside of border with border color
-          RGBA target_pixel = target.pixels[(top_center_y - y) * target.width + left_center_x - x];
-          if (target_pixel != 0) {
-            draw_color = blend_colors(draw_color, target_pixel);
+          if (top_left[-x] != 0) {
+            draw_color = blend_colors(draw_color, top_left[-x]);
           }
-          inside_shape = true;
-        }
-        // Draw the corner points in all four quadrants if inside the shape
-        if (inside_shape == true) {
-          // Top left quadrant
-          target.pixels[(top_center_y - y) * target.width + left_center_x - x] = draw_color;
-          // Top right quadrant
-          target.pixels[(top_center_y - y) * target.width + right_center_x + x] = draw_color;
-          // Bottom right quadrant
-          target.pixels[(bottom_center_y + y) * target.width + right_center_x + x] = draw_color;
-          // Bottom left quadrant
-          target.pixels[(bottom_center_y + y) * target.width + left_center_x - x] = draw_color;
+          top_left[-x] = draw_color;
+          top_right[x] = draw_color;
         }
+        // The bottom corners are the top corners upside down
+        copy_span(bottom_left - extent + 1, top_left - extent + 1, extent);
+        copy_span(bottom_right, top_right, extent);
       }
+      release_corner_mask(mask);
     }
   }
 
@@ -236,23 +317,34 @@ void draw_filled_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radi
     .w = rectangle.w,
     .h = rectangle.h - 2 * corner_radius
   };
-  if (center_rect.w > 0 && center_rect.h > 0) {
-    for (i32 y = 0; y < center_rect.h; y++) {
-      if (center_rect.y + y < target.height) {
-        for (i32 x = 0; x < center_rect.w; x++) {
-          if (center_rect.x + x < target.width) {
-            target.pixels[(center_rect.y + y) * target.width + center_rect.x + x] = background_color;
-          }
-        }
-      }
+  fill_clipped_rectangle(target, center_rect, background_color);
+}
+
+// Returns the first column of a row of a gradient rectangle. The rows of the corners are only filled between the corners.
+static i32 get_gradient_row_first(SDL_Rect rectangle, i32 corner_radius, i32 y) {
+  return y < corner_radius || y >= rectangle.h - corner_radius ? corner_radius : 0;
+}
+
+// Fills the rows of a gradient rectangle in memory order, leaving out the corners
+static void fill_gradient_rows(PixelData target, SDL_Rect rectangle, i32 corner_radius, GradientTable *table, GradientAxis axis, bool horizontal) {
+  for (i32 y = 0; y < rectangle.h; y++) {
+    i32 first = get_gradient_row_first(rectangle, corner_radius, y);
+    RGBA *span = target.pixels + (rectangle.y + y) * target.width + rectangle.x + first;
+    // A row of a horizontal gradient is the same as the row a dither tile above it, if that row was filled as far
+    if (horizontal && y >= DITHER_TILE_SIZE && get_gradient_row_first(rectangle, corner_radius, y - DITHER_TILE_SIZE) <= first) {
+      copy_span(span, span - DITHER_TILE_SIZE * target.width, rectangle.w - 2 * first);
+    } else if (horizontal) {
+      fill_horizontal_gradient_span(span, table, axis, first, rectangle.w - 2 * first, y);
+    } else {
+      fill_vertical_gradient_span(span, table, axis, first, rectangle.w - 2 * first, y);
     }
   }
 }
 
 // Draws a gradient rectangle with optional superellipse corners
 void draw_horizontal_gradient_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radius, C9_Gradient gradient) {
-  f32 dither_spread = get_dither_spread(gradient);
-  f32 one_percent_width = 1.0 / rectangle.w; // avoid division in loops
+  GradientTable *table = get_gradient_table(gradient);
+  GradientAxis axis = get_gradient_axis(gradient, rectangle.w);
 
   if (corner_radius > 0) {
     // Cap corner radius to half of the rectangle width or height
@@ -260,116 +352,54 @@ void draw_horizontal_gradient_rectangle(PixelData target, SDL_Rect rectangle, i3
       corner_radius = rectangle.w < rectangle.h ? rectangle.w / 2 : rectangle.h / 2;
     }
 
-    // Fill the area between the left corners
-    for (i32 x = 0; x < corner_radius; x++) {
-      f32 percent = x * one_percent_width;
-      i32 render_x = rectangle.x + x;
-      for (i32 y = corner_radius; y <= rectangle.h - corner_radius; y++) {
-        f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-        RGBA color = get_dithered_gradient_color(gradient, percent, random_variation);
-        target.pixels[(rectangle.y + y) * target.width + render_x] = color;
-      }
-    }
-
-    // Fill the area between the right corners
-    for (i32 x = rectangle.w - corner_radius; x < rectangle.w; x++) {
-      f32 percent = x * one_percent_width;
-      i32 render_x = rectangle.x + x;
-      for (i32 y = corner_radius; y < rectangle.h - corner_radius; y++) {
-        f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-        RGBA color = get_dithered_gradient_color(gradient, percent, random_variation);
-        target.pixels[(rectangle.y + y) * target.width + render_x] = color;
-      }
-    }
-
     // Center points for the corners
     i32 left_center_x = rectangle.x + corner_radius - 1;
     i32 right_center_x = rectangle.x + rectangle.w - corner_radius;
     i32 top_center_y = rectangle.y + corner_radius - 1;
     i32 bottom_center_y = rectangle.y + rectangle.h - corner_radius;
 
-    // Set thresholds for antialiasing and boundary detection
-    f32 antialiasing_threshold = pow(corner_radius - 1, 4);
-    f32 boundary_squared = pow(corner_radius, 4);
-    f32 inverse_difference = 1 / (boundary_squared - antialiasing_threshold);
-    bool inside_shape = false;
-    f32 opacity = 1.0;
-    f32 percent = 0.0; // Gradient position
-    RGBA color = 0; // Current drawing color
-    RGBA blend_color = 0; // Color to blend with
-
-    // Calculate points for one quadrant and mirror it the other quadrants
-    for (i32 x = 0; x < corner_radius; x++) {
+    // Draw one quadrant from the corner mask and mirror it to the other quadrants
+    CornerMask *mask = get_corner_mask(corner_radius);
+    if (mask != 0) {
       for (i32 y = 0; y < corner_radius; y++) {
-        f32 distance_squared = pow(x, 4) + pow(y, 4);
-        blend_color = 0;
-        inside_shape = false;
-        // Check if the point is within the solid part of the corner
-        if (distance_squared <= antialiasing_threshold) {
-          opacity = 1.0;
-          inside_shape = true;
-        }
-        // Apply antialiasing for points near the edge of the corner
-        else if (distance_squared <= boundary_squared) {
-          if (distance_squared > antialiasing_threshold) {
-            // Calculate opacity for antialiasing effect
-            opacity = (boundary_squared - distance_squared) * inverse_difference;
-            // Clamp opacity between 0 and 1
-            opacity = clamp(opacity, 0.0, 1.0);
-            blend_color = target.pixels[(top_center_y - y) * target.width + left_center_x - x];
-          }
-          inside_shape = true;
-        }
-        // Draw the corner points in all four quadrants if inside the shape
-        if (inside_shape == true) {
-          f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-
-          // Calculate gradient position for left corners
-          percent = (corner_radius - x - 1) * one_percent_width;
-          color = get_dithered_gradient_color(gradient, percent, random_variation);
-          color = set_alpha(color, (u8)(opacity * 255));
+        RGBA *top_left = target.pixels + (top_center_y - y) * target.width + left_center_x;
+        RGBA *top_right = target.pixels + (top_center_y - y) * target.width + right_center_x;
+        RGBA *bottom_left = target.pixels + (bottom_center_y + y) * target.width + left_center_x;
+        RGBA *bottom_right = target.pixels + (bottom_center_y + y) * target.width + right_center_x;
+        u8 *coverage = mask->coverage + y * corner_radius;
+        for (i32 x = 0; x < mask->extent[y]; x++) {
+          // Antialiased points are blended with the color under the top left quadrant
+          RGBA blend_color = x < mask->solid[y] ? 0 : top_left[-x];
+          i32 dither_offset = get_dither_row(&table->dither, y)[x & DITHER_TILE_MASK];
+
+          // Gradient color of the left corners
+          RGBA color = set_alpha(get_gradient_pixel(table, axis, corner_radius - x - 1, dither_offset), coverage[x]);
           if (blend_color != 0) {
             color = blend_colors(color, blend_color);
           }
+          top_left[-x] = color;
+          bottom_left[-x] = color;
 
-          // Top left quadrant
-          target.pixels[(top_center_y - y) * target.width + left_center_x - x] = color;
-          // Bottom left quadrant
-          target.pixels[(bottom_center_y + y) * target.width + left_center_x - x] = color;
-
-          // Calculate gradient position for right corners
-          percent = (rectangle.w - corner_radius + x) * one_percent_width;
-          color = get_dithered_gradient_color(gradient, percent, random_variation);
-          color = set_alpha(color, (u8)(opacity * 255));
+          // Gradient color of the right corners
+          color = set_alpha(get_gradient_pixel(table, axis, rectangle.w - corner_radius + x, dither_offset), coverage[x]);
           if (blend_color != 0) {
             color = blend_colors(color, blend_color);
           }
-
-          // Top right quadrant
-          target.pixels[(top_center_y - y) * target.width + right_center_x + x] = color;
-          // Bottom right quadrant
-          target.pixels[(bottom_center_y + y) * target.width + right_center_x + x] = color;
+          top_right[x] = color;
+          bottom_right[x] = color;
         }
       }
+      release_corner_mask(mask);
     }
   }
 
-  // Fill the center area
-  for (i32 x = corner_radius; x < rectangle.w - corner_radius; x++) {
-    f32 percent = x * one_percent_width;
-    i32 render_x = rectangle.x + x;
-    for (i32 y = 0; y < rectangle.h; y++) {
-      f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-      RGBA color = get_dithered_gradient_color(gradient, percent, random_variation);
-      target.pixels[(rectangle.y + y) * target.width + render_x] = color;
-    }
-  }
+  fill_gradient_rows(target, rectangle, corner_radius, table, axis, true);
 }
 
 // Draws a gradient rectangle with optional superellipse corners
 void draw_vertical_gradient_rectangle(PixelData target, SDL_Rect rectangle, i32 corner_radius, C9_Gradient gradient) {
-  f32 dither_spread = get_dither_spread(gradient);
-  f32 one_percent_height = 1.0 / rectangle.h; // avoid division in loops
+  GradientTable *table = get_gradient_table(gradient);
+  GradientAxis axis = get_gradient_axis(gradient, rectangle.h);
 
   if (corner_radius > 0) {
     // Cap corner radius to half of the rectangle width or height
@@ -377,110 +407,48 @@ void draw_vertical_gradient_rectangle(PixelData target, SDL_Rect rectangle, i32
       corner_radius = rectangle.w < rectangle.h ? rectangle.w / 2 : rectangle.h / 2;
     }
 
-    // Fill the area between the top corners
-    for (i32 y = 0; y < corner_radius; y++) {
-      f32 percent = y * one_percent_height;
-      i32 render_y = rectangle.y + y;
-      for (i32 x = corner_radius; x < rectangle.w - corner_radius; x++) {
-        f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-        RGBA color = get_dithered_gradient_color(gradient, percent, random_variation);
-        target.pixels[render_y * target.width + rectangle.x + x] = color;
-      }
-    }
-
-    // Fill the area between the bottom corners
-    for (i32 y = rectangle.h - corner_radius; y < rectangle.h; y++) {
-      f32 percent = y * one_percent_height;
-      i32 render_y = rectangle.y + y;
-      for (i32 x = corner_radius; x < rectangle.w - corner_radius; x++) {
-        f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-        RGBA color = get_dithered_gradient_color(gradient, percent, random_variation);
-        target.pixels[render_y * target.width + rectangle.x + x] = color;
-      }
-    }
-
     // Center points for the corners
     i32 left_center_x = rectangle.x + corner_radius - 1;
     i32 right_center_x = rectangle.x + rectangle.w - corner_radius;
     i32 top_center_y = rectangle.y + corner_radius - 1;
     i32 bottom_center_y = rectangle.y + rectangle.h - corner_radius;
 
-    // Set thresholds for antialiasing and boundary detection
-    f32 antialiasing_threshold = pow(corner_radius - 1, 4);
-    f32 boundary_squared = pow(corner_radius, 4);
-    f32 inverse_difference = 1 / (boundary_squared - antialiasing_threshold);
-    bool inside_shape = false;
-    f32 opacity = 1.0;
-    f32 percent = 0.0; // Gradient position
-    RGBA color = 0; // Current drawing color
-    RGBA blend_color = 0; // Color to blend with
-
-    // Calculate points for one quadrant and mirror it the other quadrants
-    for (i32 x = 0; x < corner_radius; x++) {
+    // Draw one quadrant from the corner mask and mirror it to the other quadrants
+    CornerMask *mask = get_corner_mask(corner_radius);
+    if (mask != 0) {
       for (i32 y = 0; y < corner_radius; y++) {
-        f32 distance_squared = pow(x, 4) + pow(y, 4);
-        blend_color = 0;
-        inside_shape = false;
-        // Check if the point is within the solid part of the corner
-        if (distance_squared <= antialiasing_threshold) {
-          opacity = 1.0;
-          inside_shape = true;
-        }
-        // Apply antialiasing for points near the edge of the corner
-        else if (distance_squared <= boundary_squared) {
-          if (distance_squared > antialiasing_threshold) {
-            // Calculate opacity for antialiasing effect
-            opacity = (boundary_squared - distance_squared) * inverse_difference;
-            // Clamp opacity between 0 and 1
-            opacity = clamp(opacity, 0.0, 1.0);
-            blend_color = target.pixels[(top_center_y - y) * target.width + left_center_x - x];
-          }
-          inside_shape = true;
-        }
-        // Draw the corner points in all four quadrants if inside the shape
-        if (inside_shape == true) {
-          f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-
-          // Calculate gradient position for top corners
-          percent = (corner_radius - y - 1) * one_percent_height;
-          color = get_dithered_gradient_color(gradient, percent, random_variation);
-          color = set_alpha(color, (u8)(opacity * 255));
+        RGBA *top_left = target.pixels + (top_center_y - y) * target.width + left_center_x;
+        RGBA *top_right = target.pixels + (top_center_y - y) * target.width + right_center_x;
+        RGBA *bottom_left = target.pixels + (bottom_center_y + y) * target.width + left_center_x;
+        RGBA *bottom_right = target.pixels + (bottom_center_y + y) * target.width + right_center_x;
+        u8 *coverage = mask->coverage + y * corner_radius;
+        for (i32 x = 0; x < mask->extent[y]; x++) {
+          // Antialiased points are blended with the color under the top left quadrant
+          RGBA blend_color = x < mask->solid[y] ? 0 : top_left[-x];
+          i32 dither_offset = get_dither_row(&table->dither, y)[x & DITHER_TILE_MASK];
+
+          // Gradient color of the top corners
+          RGBA color = set_alpha(get_gradient_pixel(table, axis, corner_radius - y - 1, dither_offset), coverage[x]);
           if (blend_color != 0) {
             color = blend_colors(color, blend_color);
           }
+          top_left[-x] = color;
+          top_right[x] = color;
 
-          // Top left quadrant
-          target.pixels[(top_center_y - y) * target.width + left_center_x - x] = color;
-          // Top right quadrant
-          target.pixels[(top_center_y - y) * target.width + right_center_x + x] = color;
-
-          // Calculate gradient position for bottom corners
-          percent = (rectangle.h - corner_radius + y) * one_percent_height;
-          color = get_dithered_gradient_color(gradient, percent, random_variation);
-          color = set_alpha(color, (u8)(opacity * 255));
+          // Gradient color of the bottom corners
+          color = set_alpha(get_gradient_pixel(table, axis, rectangle.h - corner_radius + y, dither_offset), coverage[x]);
           if (blend_color != 0) {
             color = blend_colors(color, blend_color);
           }
-
-          // Bottom right quadrant
-          target.pixels[(bottom_center_y + y) * target.width + right_center_x + x] = color;
-          // Bottom left quadrant
-          target.pixels[(bottom_center_y + y) * target.width + left_center_x - x] = color;
+          bottom_right[x] = color;
+          bottom_left[-x] = color;
         }
       }
+      release_corner_mask(mask);
     }
   }
 
-  // Fill the center area
-  for (i32 y = corner_radius; y < rectangle.h - corner_radius; y++) {
-    f32 percent = y * one_percent_height;
-    i32 render_y = rectangle.y + y;
-    for (i32 x = 0; x < rectangle.w; x++) {
-      f32 random_variation = get_blue_noise_value(x, y) * dither_spread;
-      RGBA color = get_dithered_gradient_color(gradient, percent, random_variation);
-      target.pixels[render_y * target.width + rectangle.x + x] = color;
-    }
-  }
+  fill_gradient_rows(target, rectangle, corner_radius, table, axis, false);
 }
 
 bool has_border(Border border) {
@@ -70,20 +70,26 @@ const TextAlign text_align = {
 struct ElementTree;
 typedef struct ElementTree ElementTree;
 
+// Forward declaration of VirtualList (defined in virtual_list.c)
+struct VirtualList;
+typedef struct VirtualList VirtualList;
+
 // Function pointer typedef for on_click and on_blur
 // The function takes a pointer to the ElementTree and a void pointer to optional event data
 typedef void (*OnEvent)(ElementTree *, void *);
 
 // Maximum SDL texture size is 16384x16384, so i16 is enough for the width and height
+// The position is relative to the parent and does not include the parent scroll, so scrolling does not move the children
+// Positions and scroll sizes use i32 as the children of a scrolled element can be much taller than a texture
 typedef struct {
-  i16 x;
-  i16 y;
+  i32 x; // Horizontal position relative to the parent
+  i32 y; // Vertical position relative to the parent
   i16 max_width; // Flexible width
   i16 max_height; // Flexible height
-  i16 scroll_width; // Width of children
-  i16 scroll_height; // Height of children
-  i16 scroll_x; // current horizontal scroll
-  i16 scroll_y; // current vertical scroll
+  i32 scroll_width; // Width of children
+  i32 scroll_height; // Height of children
+  i32 scroll_x; // current horizontal scroll
+  i32 scroll_y; // current vertical scroll
 } LayoutProps;
 
 const LayoutProps empty_layout_props = {
@@ -102,6 +108,9 @@ typedef struct {
   SDL_Texture *texture;
   i32 width;
   i32 height;
+  i32 x; // Absolute position where the element was last drawn
+  i32 y;
+  bool stale; // The element was last drawn from the glyph atlas, so the texture holds an older version of it
 } RenderProps;
 
 typedef struct {
@@ -144,6 +153,7 @@ typedef struct Element {
   Padding padding;
   Border border;
   InputData *input;
+  VirtualList *virtual_list; // Materializes only the visible children
   Array *children; // Flexible array of child elements of type Element
   OnEvent on_click; // Function pointer
   OnEvent on_blur; // Function pointer
@@ -174,6 +184,7 @@ Element empty_element = {
   .text_align = 0,
   .font_variant = 0,
   .input = 0,
+  .virtual_list = 0,
   .text_color = 0x000000FF,
   .on_click = 0,
   .on_blur = 0,
@@ -198,6 +209,8 @@ Element empty_element = {
     .texture = 0,
     .width = 0,
     .height = 0,
+    .x = 0,
+    .y = 0,
   },
   .changed = true,
 };
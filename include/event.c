@@ -6,8 +6,10 @@
 #include "element_tree.c" // ElementTree, Element
 #include "input_actions.c" // select_word, set_selection_start_index, set_selection_end_index
 #include "layout.c" // fill_scroll_width, get_clickable_element_at
+#include "text_worker.c" // TEXT_WORKER_EVENT, apply_text_layouts
 #include "types.c" // i32
 #include "types_common.c" // Position
+#include "virtual_list.c" // virtual_list_resized
 
 void rerender_element(ElementTree *tree, Element *element) {
   element->changed = true;
@@ -127,6 +129,11 @@ bool handle_events(ElementTree *tree, SDL_Window *window, SDL_Renderer *renderer
           populate_inputs(tree);
           tree->rerender = true;
         }
+      } else if (event.type == TEXT_WORKER_EVENT) {
+        // Lay out again with the sizes of the large texts that the text worker is done with
+        if (apply_text_layouts(tree)) {
+          set_dimensions(tree);
+        }
       } else if (event.type == SDL_KEYDOWN) {
         SDL_Keymod mod = SDL_GetModState();
         // Get key press content
@@ -274,8 +281,8 @@ bool handle_events(ElementTree *tree, SDL_Window *window, SDL_Renderer *renderer
       // Scroll left or right
       if (scroll_distance_x != 0 && absolute(scroll_distance_x) > absolute(scroll_distance_y)) {
         i32 remaining_scroll = scroll_x(scroll_layer, mouse_x, mouse_y, scroll_distance_x);
+        // Children are positioned relative to their parent, so only the scroll offset has changed
         if (remaining_scroll != scroll_distance_x) {
-          set_x(scroll_layer, 0);
           tree->rerender = true;
         }
       }
@@ -283,9 +290,12 @@ bool handle_events(ElementTree *tree, SDL_Window *window, SDL_Renderer *renderer
       else if (scroll_distance_y != 0) {
         i32 remaining_scroll = scroll_y(scroll_layer, mouse_x, mouse_y, scroll_distance_y);
         if (remaining_scroll != scroll_distance_y) {
-          set_y(scroll_layer, 0);
           tree->rerender = true;
         }
+        // Rows that scrolled into view can widen a virtual list
+        if (virtual_list_resized) {
+          set_dimensions(tree);
+        }
       }
     }
   }
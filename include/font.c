@@ -1,31 +1,61 @@
 #ifndef C9_FONT
 
+#include <math.h> // ceil
 #include <stdbool.h> // bool
-#include "schrift.c" // SFT, sft_loadfile, sft_freefont
+#include <stdio.h> // printf
+#include <string.h> // strcmp
+#include "baked_fonts.c" // get_baked_font
+#include "schrift.c" // SFT, SFT_Font, SFT_LMetrics, sft_loadfile_baked, sft_freefont, sft_lmetrics, sft_scratch_free
 #include "status.c" // status
-#include "types.c" // i32, u8
+#include "types.c" // i32, u8, f64
 
-bool font_initialized = false;
+/*
 
-SFT inter_regular = {
-  .xScale = 15,
-  .yScale = 15,
-};
+The font registry maps every font file once and shares the loaded SFT_Font between all variants (sizes) that use the file. A variant is registered with add_font_variant and gets a u8 id that is used as the font_variant of elements. Nothing is loaded when a variant is registered. The font file is mapped and the line height is computed from the font metrics the first time the variant is used by get_sft or get_font_height, so an app can register many sizes and only pay for the ones that are drawn. A file that fails to load is reported once and not tried again, and its variants use the regular variant instead.
 
-SFT inter_bold = {
-  .xScale = 15,
-  .yScale = 15,
-};
+close_fonts frees the caches of shaped and drawn text too. Those caches cannot be included here, as they include font.c, so they register themselves with on_close_fonts when their first entry is added.
+
+If baked fonts have been loaded with load_baked_fonts (see baked_fonts.c), a font file uses its baked lookup tables and glyph bitmaps when it is mapped.
+
+The four default variants are registered from the start and available in the font_variant struct.
+
+```c
+u8 heading = add_font_variant("InterDisplay-Medium-Tiny.ttf", 28);
+element->font_variant = heading;
+```
+
+*/
+
+#define MAX_FONT_FILES 8
+#define MAX_FONT_VARIANTS 32
+#define MAX_FONT_CACHES 8
+
+typedef struct {
+  char *file_name;
+  SFT_Font *font; // Mapped on first use
+  bool failed; // The file could not be loaded and is not tried again
+} FontFile;
+
+typedef struct {
+  u8 file; // Index of the font file
+  SFT sft; // The font of sft is set on first use
+  i32 line_height; // Computed on first use
+  bool failed; // The variant could not be loaded and is not tried again
+} FontVariant;
 
-SFT inter_small = {
-  .xScale = 13,
-  .yScale = 13,
+FontFile font_files[MAX_FONT_FILES] = {
+  {.file_name = "InterDisplay-Regular-Tiny.ttf"},
+  {.file_name = "InterDisplay-Medium-Tiny.ttf"},
 };
+u8 font_file_count = 2;
 
-SFT inter_large = {
-  .xScale = 19,
-  .yScale = 19,
+FontVariant font_variants[MAX_FONT_VARIANTS] = {
+  {.file = 0, .sft = {.xScale = 15, .yScale = 15}},
+  {.file = 1, .sft = {.xScale = 15, .yScale = 15}},
+  {.file = 1, .sft = {.xScale = 13, .yScale = 13}},
+  {.file = 0, .sft = {.xScale = 19, .yScale = 19}},
 };
+u8 font_variant_count = 4;
 
 typedef struct {
   u8 regular;
@@ -41,83 +71,138 @@ FontVariants font_variant = {
   .large = 3,
 };
 
-i32 init_fonts(void) {
-  if (inter_regular.font == 0) {
-    inter_regular.font = sft_loadfile("InterDisplay-Regular-Tiny.ttf");
-    if (inter_regular.font == NULL) {
-      printf("inter_regular STF failed\n");
-      return status.ERROR;
+// Function pointer typedef for freeing a cache that holds text shaped or drawn with the loaded fonts
+typedef void (*OnCloseFonts)(void);
+
+OnCloseFonts font_caches[MAX_FONT_CACHES];
+u8 font_cache_count = 0;
+
+// Registers a function that close_fonts calls to free a cache. Registering the same function again does nothing.
+void on_close_fonts(OnCloseFonts clear_cache) {
+  for (i32 i = 0; i < font_cache_count; i++) {
+    if (font_caches[i] == clear_cache) return;
+  }
+  if (font_cache_count == MAX_FONT_CACHES) {
+    printf("Too many font caches\n");
+    return;
+  }
+  font_caches[font_cache_count++] = clear_cache;
+}
+
+// Returns the index of the font file, adding it to the registry if needed
+static i32 get_font_file_index(char *file_name) {
+  for (i32 i = 0; i < font_file_count; i++) {
+    if (strcmp(font_files[i].file_name, file_name) == 0) {
+      return i;
     }
   }
-  if (inter_bold.font == 0) {
-    inter_bold.font = sft_loadfile("InterDisplay-Medium-Tiny.ttf");
-    if (inter_bold.font == NULL) {
-      printf("inter_bold STF failed\n");
-      return status.ERROR;
+  if (font_file_count == MAX_FONT_FILES) return -1;
+  font_files[font_file_count] = (FontFile){.file_name = file_name};
+  return font_file_count++;
+}
+
+// Registers a font file and size and returns the id of the variant. The same id is returned if the variant is already registered.
+// The file name is not copied and has to stay valid. Returns font_variant.regular if the registry is full.
+u8 add_font_variant(char *file_name, f64 size) {
+  i32 file = get_font_file_index(file_name);
+  if (file < 0) {
+    printf("Too many font files\n");
+    return font_variant.regular;
+  }
+  for (u8 i = 0; i < font_variant_count; i++) {
+    if (font_variants[i].file == file && font_variants[i].sft.yScale == size) {
+      return i;
     }
   }
-  if (inter_small.font == 0) {
-    inter_small.font = sft_loadfile("InterDisplay-Medium-Tiny.ttf");
-    if (inter_small.font == NULL) {
-      printf("inter_small STF failed\n");
+  if (font_variant_count == MAX_FONT_VARIANTS) {
+    printf("Too many font variants\n");
+    return font_variant.regular;
+  }
+  font_variants[font_variant_count] = (FontVariant){
+    .file = file,
+    .sft = {.xScale = size, .yScale = size},
+  };
+  return font_variant_count++;
+}
+
+// Maps the font file of the variant and computes its line height if it is used for the first time
+// A failure is recorded, so that it is only reported once and the file is not mapped again on every lookup
+static i32 load_font_variant(FontVariant *variant) {
+  if (variant->sft.font != 0) return status.OK;
+  if (variant->failed) return status.ERROR;
+  FontFile *file = &font_files[variant->file];
+  if (file->font == 0) {
+    if (file->failed) {
+      variant->failed = true;
       return status.ERROR;
     }
-  }
-  if (inter_large.font == 0) {
-    inter_large.font = sft_loadfile("InterDisplay-Regular-Tiny.ttf");
-    if (inter_large.font == NULL) {
-      printf("inter_large STF failed\n");
+    // Use the baked tables and glyphs of the file if load_baked_fonts has mapped them
+    file->font = sft_loadfile_baked(file->file_name, get_baked_font(file->file_name));
+    if (file->font == NULL) {
+      printf("Failed to load font %s\n", file->file_name);
+      file->failed = true;
+      variant->failed = true;
       return status.ERROR;
     }
   }
+  variant->sft.font = file->font;
+  SFT_LMetrics metrics;
+  if (sft_lmetrics(&variant->sft, &metrics) < 0) {
+    printf("Failed to read the metrics of font %s\n", file->file_name);
+    variant->sft.font = 0;
+    variant->failed = true;
+    return status.ERROR;
+  }
+  variant->line_height = (i32)ceil(metrics.ascender - metrics.descender + metrics.lineGap);
   return status.OK;
 }
 
-SFT *get_sft(u8 variant) {
-  if (font_initialized == false) {
-    if (init_fonts() == status.OK) {
-      font_initialized = true;
-    } else {
-      return 0; // null pointer
-    }
-  }
-  if (variant == font_variant.regular) {
-    return &inter_regular;
+// Loads the regular variant so that a missing font file is reported at startup. Other variants are loaded on first use.
+i32 init_fonts(void) {
+  return load_font_variant(&font_variants[font_variant.regular]);
+}
+
+// Returns the loaded variant, or the regular variant if the variant is not registered or failed to load.
+// Returns 0 if the regular variant failed to load too.
+static FontVariant *get_loaded_font_variant(u8 variant) {
+  if (variant < font_variant_count && load_font_variant(&font_variants[variant]) == status.OK) {
+    return &font_variants[variant];
   }
-  if (variant == font_variant.bold) {
-    return &inter_bold;
-  } else if (variant == font_variant.small) {
-    return &inter_small;
-  } else if (variant == font_variant.large) {
-    return &inter_large;
-  } else {
-    return &inter_regular;
+  if (load_font_variant(&font_variants[font_variant.regular]) == status.OK) {
+    return &font_variants[font_variant.regular];
   }
+  return 0; // null pointer
+}
+
+SFT *get_sft(u8 variant) {
+  FontVariant *loaded = get_loaded_font_variant(variant);
+  if (loaded == 0) return 0; // null pointer
+  return &loaded->sft;
 }
 
 i32 get_font_height(u8 variant) {
-  if (variant == font_variant.regular) {
-    return 19;
-  }
-  if (variant == font_variant.bold) {
-    return 19;
-  } else if (variant == font_variant.small) {
-    return 16;
-  } else if (variant == font_variant.large) {
-    return 23;
-  } else {
-    return 19;
-  }
+  FontVariant *loaded = get_loaded_font_variant(variant);
+  if (loaded == 0) return 0;
+  return loaded->line_height;
 }
 
+// Frees the registered caches and every mapped font file once, unloads all variants and frees the scratch memory of the
+// rasterizer. Fonts that failed to load are tried again after this.
 void close_fonts(void) {
-  if (font_initialized == true) {
-    sft_freefont(inter_regular.font);
-    sft_freefont(inter_bold.font);
-    sft_freefont(inter_small.font);
-    sft_freefont(inter_large.font);
+  for (i32 i = 0; i < font_cache_count; i++) {
+    font_caches[i]();
+  }
+  for (i32 i = 0; i < font_file_count; i++) {
+    sft_freefont(font_files[i].font);
+    font_files[i].font = 0;
+    font_files[i].failed = false;
+  }
+  for (i32 i = 0; i < font_variant_count; i++) {
+    font_variants[i].sft.font = 0;
+    font_variants[i].failed = false;
   }
+  sft_scratch_free();
 }
 
 #define C9_FONT
-#endif
\ No newline at end of file
+#endif
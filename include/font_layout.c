@@ -1,14 +1,16 @@
 #ifndef C9_FONT_LAYOUT
 
+#include <math.h> // ceil
 #include <stdbool.h> // bool
-#include "arena.c" // Arena
-#include "array.c" // Array
+#include "arena.c" // Arena, arena_open
+#include "array.c" // Array, array_create_width, array_push, array_get, array_clear
 #include "element_tree.c" // Element
+#include "input.c" // InputData, has_line_advances, get_input_line, find_input_line
 #include "font.c" // get_sft, get_font_height
-#include "schrift.c" // SFT, SFT_MeasureUTF8, SFT_text_width
 #include "status.c" // status
 #include "string.c" // s8
-#include "types.c" // i32, u8
+#include "text_run.c" // TextRun, get_text_run, get_text_width, get_text_run_index, get_text_run_fit, get_text_run_prefix_width, update_text_run_size
+#include "types.c" // i32, u8, f32, f64
 #include "types_common.c" // Position, Line
 
 // Check if a string contains a newline character
@@ -26,195 +28,275 @@ bool has_continuation_byte(u8 byte) {
   return (byte & 0b11000000) == 0b10000000;
 }
 
-// Splits a string into lines based on a maximum width. Returns an array of indexes.
-Array *split_string_at_width(Arena *arena, u8 font_variant, s8 text, i32 max_width) {
-  SFT *sft = get_sft(font_variant);
-  Array *lines = array_create_width(arena, sizeof(s8), 4);
+// Adds the characters from first to end (exclusive) as a line, ending at end_index in bytes
+static void push_wrapped_line(Array *lines, TextRun *run, i32 first, i32 end, i32 end_index) {
+  Line line = {
+    .start_index = run->offsets[first],
+    .end_index = end_index,
+    .width = end > first ? (i32)ceil(run->ends[end - 1] - run->pens[first]) : 0,
+  };
+  array_push(lines, &line);
+}
+
+// Wraps a shaped run into lines in a single pass over its characters and returns the lines with their widths.
+// Lines break at newlines (which are not part of the line), after the last space that fits or, if a word is wider
+// than max_width, before the first character that does not fit. Spaces never break a line, so they can hang outside
+// max_width. A max_width of 0 keeps the whole text on one line. The lines are cached on the run until it is wrapped
+// at another width, so they should not be kept between frames.
+Array *wrap_text_run(TextRun *run, i32 max_width) {
+  if (run->lines != 0 && run->wrap_width == max_width) return run->lines;
+  if (run->wrap_arena == 0) {
+    run->wrap_arena = arena_open(sizeof(Line) * 16 + 256);
+    run->lines = array_create_width(run->wrap_arena, sizeof(Line), 4);
+  }
+  Array *lines = run->lines;
+  array_clear(lines);
+  run->wrap_width = max_width;
+  s8 text = run->text;
 
   // The text has no width limit
   if (max_width == 0 || text.length <= 0) {
     Line line = {
       .start_index = 0,
       .end_index = text.length,
+      .width = run->width,
     };
     array_push(lines, &line);
+    update_text_run_size(run);
     return lines;
   }
 
-  // Loop through the text
-  i32 start_index = 0;
-  while (start_index < text.length) {
-    Line line = {
-      .start_index = start_index,
-    };
-
-    i32 sft_character_count = 0;
-    i32 sft_character_width = 0;
-    SFT_MeasureUTF8(sft, text.data + start_index, max_width, &sft_character_width, &sft_character_count);
-
-    // Step through the characters to break at the last space
-    i32 last_space = -1;
-    i32 newline_position = -1;
-    i32 read_index = start_index;
-    while (sft_character_count > 0 && read_index < text.length) {
-      if (text.data[read_index] == '\n') {
-        newline_position = read_index;
-        sft_character_count = 0; // Break the loop
-      } else if (text.data[read_index] == ' ') {
-        last_space = read_index;
-      }
-      // Step index by full utf-8 characters
-      read_index += 1;
-      while (read_index < text.length &&
-             has_continuation_byte(text.data[read_index])) {
-        read_index += 1;
-      }
-      sft_character_count -= 1;
-    }
-    // Break at the first newline
-    if (newline_position != -1) {
-      line.end_index = newline_position;
-      array_push(lines, &line);
-      start_index = newline_position + 1;
+  i32 first = 0; // First character of the current line
+  i32 last_space = -1; // Last space on the current line
+  for (i32 i = 0; i < run->glyph_count; i++) {
+    u8 byte = text.data[run->offsets[i]];
+    // Break at newlines
+    if (byte == '\n') {
+      push_wrapped_line(lines, run, first, i, run->offsets[i]);
+      first = i + 1;
+      last_space = -1;
+      continue;
     }
-    // Break at the last space if we are not at string end
-    else if (last_space != -1 && read_index < text.length) {
-      line.end_index = last_space + 1; // Include the space
-      array_push(lines, &line);
-      start_index = last_space + 1;
+    if (byte == ' ') {
+      last_space = i;
+      continue;
     }
-    // No space found, break at the last character
-    else {
-      line.end_index = read_index;
-      array_push(lines, &line);
-      start_index = read_index;
+    // Break when the character does not fit, keeping at least one character on each line
+    while (i > first && run->ends[i] - run->pens[first] >= max_width) {
+      if (last_space >= first) {
+        // Break after the last space
+        push_wrapped_line(lines, run, first, last_space + 1, run->offsets[last_space + 1]);
+        first = last_space + 1;
+        last_space = -1;
+      } else {
+        // No space found, break before the character
+        push_wrapped_line(lines, run, first, i, run->offsets[i]);
+        first = i;
+      }
     }
   }
+  if (first < run->glyph_count) {
+    push_wrapped_line(lines, run, first, run->glyph_count, text.length);
+  }
   // If the last character is a newline, add an empty line
-  if (text.data[text.length - 1] == '\n') {
+  else if (text.data[text.length - 1] == '\n') {
     Line empty_line = {
       .start_index = text.length,
       .end_index = text.length,
     };
     array_push(lines, &empty_line);
   }
+  update_text_run_size(run);
   return lines;
 }
 
-const i32 line_spacing = 2;
-
-// Returns the height of a single text line
-i32 get_text_line_height(u8 font_variant) {
-  return get_font_height(font_variant) + line_spacing;
+// Splits a string into lines based on a maximum width. Returns an array of lines in the arena.
+Array *split_string_at_width(Arena *arena, u8 font_variant, s8 text, i32 max_width) {
+  Array *lines = array_create_width(arena, sizeof(Line), 4);
+  TextRun *run = get_text_run(font_variant, text);
+  if (run == 0) {
+    Line line = {
+      .start_index = 0,
+      .end_index = text.length,
+    };
+    array_push(lines, &line);
+    return lines;
+  }
+  // Copy the lines from the run, as the run cache can evict them
+  Array *wrapped_lines = wrap_text_run(run, max_width);
+  for (i32 i = 0; i < array_length(wrapped_lines); i++) {
+    array_push(lines, array_get(wrapped_lines, i));
+  }
+  return lines;
 }
 
-// Returns the height of a text block based on a maximum width
-i32 get_text_block_height(u8 font_variant, s8 text, i32 max_width) {
-  i32 font_height = get_font_height(font_variant);
-  // The text has no width limit
-  if (max_width == 0 || text.length <= 0) {
-    return font_height;
+// Sets the advance of every byte of the wrapped line from the shaped run of its paragraph
+static void set_line_advances(f32 *advances, TextRun *run, Line *line) {
+  i32 first = get_text_run_index(run, line->start_index);
+  i32 end = get_text_run_index(run, line->end_index);
+  f64 line_x = first < run->glyph_count ? run->pens[first] : 0;
+  for (i32 i = first; i < end; i++) {
+    f32 advance = (f32)(run->ends[i] - line_x);
+    for (i32 byte_index = run->offsets[i]; byte_index < run->offsets[i + 1]; byte_index++) {
+      advances[byte_index] = advance;
+    }
   }
+}
 
-  // Loop through the text
-  SFT *font = get_sft(font_variant);
-  i32 start_index = 0;
-  i32 rows = 0;
-  while (start_index < text.length) {
-    i32 character_count = 0;
-    i32 character_width = 0;
-    SFT_MeasureUTF8(font, &text.data[start_index], max_width, &character_width, &character_count);
-
-    // Step through the characters to break at the last space
-    i32 last_space = -1;
-    i32 newline_position = -1;
-    i32 read_index = start_index;
-    for (i32 i = 0; i < character_count; i++) {
-      if (text.data[read_index] == '\n') {
-        newline_position = read_index;
-        i = character_count; // Break the loop
-      } else if (text.data[read_index] == ' ') {
-        last_space = read_index;
-      }
-      // Step index by full utf-8 characters
-      read_index += 1;
-      while (has_continuation_byte(text.data[read_index])) {
-        read_index += 1;
-      }
+// Wraps the paragraphs (text between newlines) of a text, from the paragraph that starts at start_index to the paragraph
+// that contains end_index, and pushes the lines to lines with indexes into the whole text. Every paragraph is shaped as
+// its own run, so only the wrapped paragraphs are measured. Returns the index where the next paragraph starts.
+// A max_width of 0 keeps all text from start_index on one line, newlines included, like wrap_text_run.
+// If advances is set, it gets the advance of every byte in the wrapped paragraphs (see InputData).
+i32 wrap_paragraphs(Array *lines, f32 *advances, u8 font_variant, s8 text, i32 start_index, i32 end_index, i32 max_width) {
+  i32 paragraph_start = start_index;
+  while (true) {
+    i32 paragraph_end = paragraph_start;
+    // Single line inputs can get newlines from pasted text
+    if (max_width == 0) {
+      paragraph_end = text.length;
     }
-    // Break at the first newline
-    if (newline_position != -1) {
-      start_index = newline_position + 1;
+    while (paragraph_end < text.length && text.data[paragraph_end] != '\n') {
+      paragraph_end++;
     }
-    // Break at the last space if we are not at string end
-    else if (last_space != -1 && read_index < text.length) {
-      start_index = last_space + 1;
+    s8 paragraph = {
+      .data = text.data + paragraph_start,
+      .length = paragraph_end - paragraph_start,
+    };
+    TextRun *run = get_text_run(font_variant, paragraph);
+    if (run == 0) {
+      Line line = {
+        .start_index = paragraph_start,
+        .end_index = paragraph_end,
+      };
+      array_push(lines, &line);
+    } else {
+      Array *paragraph_lines = wrap_text_run(run, max_width);
+      for (i32 i = 0; i < array_length(paragraph_lines); i++) {
+        Line line = *(Line *)array_get(paragraph_lines, i);
+        if (advances != 0) {
+          set_line_advances(advances + paragraph_start, run, &line);
+        }
+        line.start_index += paragraph_start;
+        line.end_index += paragraph_start;
+        array_push(lines, &line);
+      }
     }
-    // No space found, break at the last character
-    else {
-      start_index = read_index;
+    // The newline is not part of any line
+    if (advances != 0 && paragraph_end < text.length) {
+      advances[paragraph_end] = 0;
     }
-    rows += 1;
+    // The next paragraph starts after the newline
+    paragraph_start = paragraph_end + 1;
+    if (paragraph_end >= end_index || paragraph_end >= text.length) break;
   }
-  // If the last character is a newline add one extra row
-  if (text.data[text.length - 1] == '\n') {
-    rows += 1;
-  }
-  return font_height * rows + line_spacing * (rows - 1);
+  return paragraph_start;
 }
 
-i32 get_next_character_width(SFT *font, u8 *text, i32 next_character_position) {
-  i32 character_index = 0;
-  // Step over previous characters to find the start of the character
-  for (i32 i = 0; i < next_character_position; i++) {
-    character_index++;
-    while (has_continuation_byte(text[character_index])) {
-      character_index++;
+// Bytes shaped at a time by wrap_paragraph_window when the window is not given by an edit
+#define WRAP_WINDOW_LENGTH 4096
+
+// Wraps the paragraph from start_index, which has to be the start of a line, like wrap_paragraphs, but only shapes the
+// text up to window_end or the end of the paragraph. Pushes the lines that end inside the window and returns the index
+// where the next line starts: the start of the line that reaches past the window (start_index if no line ends inside
+// it, so the window has to grow), or the start of the next paragraph. The width of a line is measured from its own
+// first character, so shaping from the start of a line gives the same breaks as shaping the whole paragraph.
+i32 wrap_paragraph_window(Array *lines, f32 *advances, u8 font_variant, s8 text, i32 start_index, i32 window_end, i32 max_width) {
+  if (window_end > text.length) {
+    window_end = text.length;
+  }
+  i32 paragraph_end = start_index;
+  while (paragraph_end < window_end && text.data[paragraph_end] != '\n') {
+    paragraph_end++;
+  }
+  bool complete = paragraph_end == text.length || text.data[paragraph_end] == '\n';
+  // Do not cut a character in two
+  while (!complete && paragraph_end > start_index && has_continuation_byte(text.data[paragraph_end])) {
+    paragraph_end--;
+  }
+  s8 paragraph = {
+    .data = text.data + start_index,
+    .length = paragraph_end - start_index,
+  };
+  TextRun *run = get_text_run(font_variant, paragraph);
+  if (run == 0) {
+    // Without a font the paragraph is a single line, as in wrap_paragraphs
+    while (paragraph_end < text.length && text.data[paragraph_end] != '\n') {
+      paragraph_end++;
+    }
+    Line line = {
+      .start_index = start_index,
+      .end_index = paragraph_end,
+    };
+    array_push(lines, &line);
+    return paragraph_end + 1;
+  }
+  Array *window_lines = wrap_text_run(run, max_width);
+  // The last line of a window that ends inside the paragraph can get more characters
+  i32 line_count = array_length(window_lines);
+  i32 complete_count = complete ? line_count : line_count - 1;
+  for (i32 i = 0; i < complete_count; i++) {
+    Line line = *(Line *)array_get(window_lines, i);
+    if (advances != 0) {
+      set_line_advances(advances + start_index, run, &line);
     }
+    line.start_index += start_index;
+    line.end_index += start_index;
+    array_push(lines, &line);
+  }
+  if (!complete) {
+    return start_index + ((Line *)array_get(window_lines, line_count - 1))->start_index;
   }
-  // Step over the next character and store its length
-  i32 character_length = 1;
-  while (has_continuation_byte(text[character_index + character_length])) {
-    character_length++;
+  if (advances != 0 && paragraph_end < text.length) {
+    advances[paragraph_end] = 0;
   }
+  return paragraph_end + 1;
+}
+
+const i32 line_spacing = 2;
 
-  // Temporarily null-terminate the next byte to measure the character
-  i32 next_byte_index = character_index + character_length;
-  u8 next_byte_backup = text[next_byte_index];
-  text[next_byte_index] = '\0';
-  i32 character_width = 0;
-  SFT_text_width(font, &text[character_index], &character_width);
-  // Restore the next byte
-  text[next_byte_index] = next_byte_backup;
+// Returns the height of a single text line
+i32 get_text_line_height(u8 font_variant) {
+  return get_font_height(font_variant) + line_spacing;
+}
+
+// Returns the height of a number of text lines
+i32 get_text_lines_height(u8 font_variant, i32 line_count) {
+  if (line_count < 1) {
+    line_count = 1;
+  }
+  return get_font_height(font_variant) * line_count + line_spacing * (line_count - 1);
+}
 
-  return character_width;
+// Returns the height of a text block based on a maximum width
+i32 get_text_block_height(u8 font_variant, s8 text, i32 max_width) {
+  // The text has no width limit
+  if (max_width == 0 || text.length <= 0) {
+    return get_font_height(font_variant);
+  }
+  TextRun *run = get_text_run(font_variant, text);
+  if (run == 0) return get_font_height(font_variant);
+  return get_text_lines_height(font_variant, array_length(wrap_text_run(run, max_width)));
 }
 
+// Returns the character index in the text that is closest to the x position
 i32 index_from_x(u8 font_variant, s8 *text, i32 position) {
-  SFT *font = get_sft(font_variant);
   // Make sure the position and text is valid
   if (position <= 0 || text->length == 0) return 0;
+  TextRun *run = get_text_run(font_variant, *text);
+  if (run == 0) return 0;
 
-  i32 character_index = 0;
-  i32 character_width = 0; // Width of characters in pixels
-  i32 character_count = 0; // How many characters fit in the width
-  SFT_MeasureUTF8(font, text->data, position, &character_width, &character_count);
-
+  // How many characters fit in the width
+  i32 character_count = get_text_run_fit(run, 0, position);
+  i32 character_width = (i32)ceil(get_text_run_x(run, character_count));
   // Check if position is closer to the next character
-  i32 next_character_width = get_next_character_width(font, text->data, character_count);
-  if (position - character_width > next_character_width / 2) {
-    character_count += 1;
-  }
-  // Step by character to find the character index
-  for (i32 i = 0; i < character_count; i++) {
-    character_index += 1;
-    while (has_continuation_byte(text->data[character_index])) {
-      character_index += 1;
+  if (character_count < run->glyph_count) {
+    i32 next_character_width = (i32)ceil(run->ends[character_count] - run->pens[character_count]);
+    if (position - character_width > next_character_width / 2) {
+      character_count += 1;
     }
   }
-  if (character_index > text->length) {
-    character_index = text->length;
-  }
+  i32 character_index = run->offsets[character_count];
   // If the last character is a newline, step back one character
   if (character_index > 0 && text->data[character_index - 1] == '\n') {
     character_index -= 1;
@@ -227,7 +309,74 @@ i32 index_from_x(u8 font_variant, s8 *text, i32 position) {
   return character_index;
 }
 
-// Binary search to find the child element at coordinate y
+// Returns the width of the line text before a character index, rounded up
+i32 get_line_prefix_width(u8 font_variant, InputData *input, Line *line, i32 index) {
+  if (index > line->end_index) {
+    index = line->end_index;
+  }
+  if (index <= line->start_index) return 0;
+  if (has_line_advances(input)) {
+    // All bytes of the character before the index have its advance
+    return (i32)ceil(input->advances[index - 1]);
+  }
+  s8 line_text = {
+    .data = input->text.data + line->start_index,
+    .length = line->end_index - line->start_index,
+  };
+  TextRun *run = get_text_run(font_variant, line_text);
+  if (run == 0) return 0;
+  return get_text_run_prefix_width(run, index - line->start_index);
+}
+
+// Returns the character index in the input text that is closest to the x position on a line
+i32 index_from_line_x(u8 font_variant, InputData *input, Line *line, i32 position) {
+  s8 text = input->text;
+  if (!has_line_advances(input)) {
+    s8 line_text = {
+      .data = text.data + line->start_index,
+      .length = line->end_index - line->start_index,
+    };
+    return line->start_index + index_from_x(font_variant, &line_text, position);
+  }
+  // Make sure the position and line is valid
+  if (position <= 0 || line->end_index == line->start_index) return line->start_index;
+
+  // Binary search for the first byte of a character that does not fit in the width
+  f32 *advances = input->advances;
+  i32 low = line->start_index;
+  i32 high = line->end_index;
+  while (low < high) {
+    i32 mid = (low + high) / 2;
+    if (advances[mid] < position) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  i32 character_index = low;
+  while (character_index > line->start_index && has_continuation_byte(text.data[character_index])) {
+    character_index--;
+  }
+  // Check if position is closer to the next character
+  if (character_index < line->end_index) {
+    f32 character_x = character_index > line->start_index ? advances[character_index - 1] : 0;
+    i32 character_width = (i32)ceil(character_x);
+    i32 next_character_width = (i32)ceil(advances[character_index] - character_x);
+    if (position - character_width > next_character_width / 2) {
+      character_index++;
+      while (character_index < line->end_index && has_continuation_byte(text.data[character_index])) {
+        character_index++;
+      }
+    }
+  }
+  // If the character is the last character and it's a space, step back one character
+  if (character_index == line->end_index && text.data[character_index - 1] == ' ') {
+    character_index -= 1;
+  }
+  return character_index;
+}
+
+// Binary search to find the child element at coordinate y relative to the parent
 i32 get_child_order_at(Element *parent, i32 y) {
   if (parent->children == 0) return -1;
   i32 number_of_children = array_length(parent->children);
@@ -253,92 +402,58 @@ i32 get_child_order_at(Element *parent, i32 y) {
 }
 
 // Returns a character index from a global position
+// The element position is taken from where it was last drawn
 i32 index_from_position(Position cursor, Element *element) {
   // Relative position
   Position position = {
-    .x = cursor.x - element->layout.x - element->padding.left - element->layout.scroll_x,
-    .y = cursor.y - element->layout.y - element->padding.top - element->layout.scroll_y,
+    .x = cursor.x - element->render.x - element->padding.left - element->layout.scroll_x,
+    .y = cursor.y - element->render.y - element->padding.top - element->layout.scroll_y,
   };
   if (position.y <= 0) return 0;
 
   // Find out which line was clicked
-  i32 line_number = get_child_order_at(element, cursor.y);
+  i32 line_number = get_child_order_at(element, position.y + element->padding.top);
   if (line_number < 0) return 0;
 
   if (line_number >= array_length(element->input->lines)) {
     printf("Line number out of bounds\n");
     return element->input->text.length;
   }
-  // Get the indexes for that line
-  Line *indexes = array_get(element->input->lines, line_number);
-  Arena *temp_arena = arena_open(1024);
-  s8 line_text = {
-    .data = element->input->text.data + indexes->start_index,
-    .length = indexes->end_index - indexes->start_index,
-  };
-
-  i32 index_in_line = index_from_x(element->font_variant, &line_text, position.x);
-
-  arena_close(temp_arena);
-  return indexes->start_index + index_in_line;
+  Line line = get_input_line(element->input, line_number);
+  return index_from_line_x(element->font_variant, element->input, &line, position.x);
 }
 
 // Returns a global position from a character index
 Position position_from_index(i32 index, Element *element) {
-  Arena *temp_arena = arena_open(512);
   Position position = {0, 0};
-
-  s8 element_text = string_from_substring(temp_arena, element->input->text.data, 0, element->input->text.length);
+  s8 element_text = element->input->text;
   // Text is only one line
   if (element->overflow == overflow_type.scroll ||
       element->overflow == overflow_type.scroll_x) {
-    // Copy element text to a new string to avoid modifying the original string
-    i32 width = 0;
-    SFT_text_width(get_sft(element->font_variant), element_text.data, &width);
+    i32 width = get_text_width(element->font_variant, element_text);
     position = (Position){
-      .x = element->layout.x + element->padding.left + width,
-      .y = element->layout.y + element->padding.top,
+      .x = element->render.x + element->padding.left + width,
+      .y = element->render.y + element->padding.top,
     };
   }
   // Text is multiline
   else {
     // Find out which child element contains the index
-    Array *indexes = element->input->lines;
-    Line *line = 0;
-    i32 line_index = 0;
-    for (i32 i = 0; i < array_length(indexes); i++) {
-      Line *current_line = array_get(indexes, i);
-      if (current_line->end_index >= index && current_line->start_index <= index) {
-        line = current_line;
-        line_index = i;
-      }
-    }
-    if (line == 0) {
-      printf("No line found\n");
-      line_index = array_last(indexes);
-      line = array_get(indexes, line_index);
-    }
-    if (line == 0 || element->children == 0) return position;
+    if (array_length(element->input->lines) == 0 || element->children == 0) return position;
+    i32 line_index = find_input_line(element->input, index);
+    Line line = get_input_line(element->input, line_index);
 
     Element *child_element = array_get(element->children, line_index);
     if (child_element == 0) return position;
 
-    i32 relative_end = index - line->start_index;
-    if (relative_end < 0) {
-      relative_end = 0;
-    }
-    s8 line_text = string_from_substring(temp_arena, element_text.data, line->start_index, index - line->start_index);
-
-    i32 width = 0;
+    i32 width = get_line_prefix_width(element->font_variant, element->input, &line, index);
     i32 height = get_text_line_height(element->font_variant);
-    SFT_text_width(get_sft(element->font_variant), line_text.data, &width);
 
     position = (Position){
-      .x = child_element->layout.x + width,
-      .y = child_element->layout.y + height / 2,
+      .x = element->render.x + element->layout.scroll_x + child_element->layout.x + width,
+      .y = element->render.y + element->layout.scroll_y + child_element->layout.y + height / 2,
     };
   }
-  arena_close(temp_arena);
   return position;
 }
 
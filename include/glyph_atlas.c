@@ -0,0 +1,322 @@
+#ifndef C9_GLYPH_ATLAS
+
+#include <SDL2/SDL.h> // SDL_Renderer, SDL_Texture, SDL_Vertex, SDL_Rect, SDL_GetRendererInfo, SDL_CreateTexture, SDL_UpdateTexture, SDL_RenderGeometry, SDL_IntersectRect
+#include <math.h> // floor
+#include <stdbool.h> // bool
+#include <stdio.h> // printf
+#include <string.h> // memset
+#include "arena.c" // Arena, arena_open, arena_fill, arena_close
+#include "array.c" // Array, array_get, array_length
+#include "color.c" // RGBA, red, green, blue, alpha
+#include "font.c" // get_sft
+#include "font_layout.c" // get_text_line_height
+#include "schrift.c" // SFT, SFT_Glyph, SFT_GMetrics, SFT_LMetrics, SFT_Image, SFT_BakedGlyph, sft_gmetrics, sft_lmetrics, sft_render, sft_baked_glyph, GLYPH_CACHE_SUBPIXELS
+#include "string.c" // s8
+#include "text_run.c" // TextRun, get_text_run_index, get_text_run_index_at_x
+#include "text_worker.c" // get_text_run_async, get_shaped_text_run_async, wrap_text_run_async
+#include "types.c" // i32, u8, u32, f32, f64
+#include "types_common.c" // Line
+
+/*
+
+The glyph atlas is an optional text path that draws text with the GPU (or SDL's software renderer) instead of rasterizing it into element textures. Glyph bitmaps are packed into one shared atlas texture the first time they are drawn, and text runs are drawn as textured quads, one SDL_RenderGeometry call per batch of glyphs, straight into the render target. Elements that only hold text are drawn from the atlas in the frames where their text changes, so changing a label only rebuilds its quads instead of rasterizing and uploading its texture. When the text stays the same, it is rasterized into the texture of the element once and copied after that.
+
+The atlas is faster on accelerated renderers, where quads are cheap and texture uploads are not. With SDL's software renderer, drawing quads is slower than rasterizing into element textures, so init_accelerated_glyph_atlas only enables the atlas on accelerated renderers. init_glyph_atlas enables it on any renderer, which lets it be tested headless.
+
+Glyphs are keyed by font variant, glyph id and quarter pixel offset, like the glyph cache in schrift.c. The atlas is packed in rows (shelves) and is emptied when it is full, so it never grows beyond GLYPH_ATLAS_SIZE squared.
+
+```c
+init_accelerated_glyph_atlas(renderer); // Changing text only elements are now drawn from the atlas
+close_glyph_atlas();
+```
+
+*/
+
+#define GLYPH_ATLAS_SIZE 512 // Width and height of the atlas texture
+#define GLYPH_ATLAS_BUCKETS 8192 // Must be a power of two
+#define GLYPH_ATLAS_MAX_GLYPHS (GLYPH_ATLAS_BUCKETS / 2) // The atlas is emptied before the hash table is half full
+#define GLYPH_ATLAS_BATCH 512 // Glyphs per SDL_RenderGeometry call
+
+typedef struct {
+  u32 key; // Font variant, glyph id and subpixel offset plus one, 0 marks an empty slot
+  i32 x; // Position of the bitmap in the atlas
+  i32 y;
+  i32 width;
+  i32 height;
+  i32 left; // Pixels from the pen position to the left edge of the bitmap
+  i32 top; // Pixels from the baseline to the top edge of the bitmap
+} AtlasGlyph;
+
+typedef struct {
+  SDL_Texture *texture;
+  AtlasGlyph glyphs[GLYPH_ATLAS_BUCKETS];
+  i32 glyph_count;
+  i32 shelf_x; // Next free column in the current shelf
+  i32 shelf_y; // Top of the current shelf
+  i32 shelf_height; // Height of the tallest glyph in the current shelf
+  SDL_Vertex vertices[GLYPH_ATLAS_BATCH * 4];
+  i32 indices[GLYPH_ATLAS_BATCH * 6];
+  i32 quad_count; // Quads in the current batch
+  SDL_Renderer *renderer;
+  u32 resets; // Number of times the atlas was full and emptied
+} GlyphAtlas;
+
+GlyphAtlas glyph_atlas = {0};
+
+// Creates the atlas texture. Text only elements are drawn from the atlas until close_glyph_atlas is called.
+bool init_glyph_atlas(SDL_Renderer *renderer) {
+  if (glyph_atlas.texture != 0) return true;
+  SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE);
+  if (texture == 0) {
+    printf("Failed to create glyph atlas: %s\n", SDL_GetError());
+    return false;
+  }
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+  memset(&glyph_atlas, 0, sizeof(glyph_atlas));
+  glyph_atlas.texture = texture;
+  glyph_atlas.renderer = renderer;
+  // Every quad is two triangles split along the top left to bottom right diagonal, which the software renderer draws as a 1:1 copy
+  for (i32 i = 0; i < GLYPH_ATLAS_BATCH; i++) {
+    i32 *indices = &glyph_atlas.indices[i * 6];
+    indices[0] = i * 4;
+    indices[1] = i * 4 + 1;
+    indices[2] = i * 4 + 3;
+    indices[3] = i * 4;
+    indices[4] = i * 4 + 3;
+    indices[5] = i * 4 + 2;
+  }
+  return true;
+}
+
+// Creates the atlas texture if the renderer is accelerated. The software renderer draws quads slower than it copies element
+// textures, so there text is only rasterized into element textures. Returns true if the atlas is enabled.
+bool init_accelerated_glyph_atlas(SDL_Renderer *renderer) {
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) != 0 || (info.flags & SDL_RENDERER_ACCELERATED) == 0) return false;
+  return init_glyph_atlas(renderer);
+}
+
+// Destroys the atlas texture, so that text is rasterized into element textures again
+void close_glyph_atlas(void) {
+  if (glyph_atlas.texture != 0) {
+    SDL_DestroyTexture(glyph_atlas.texture);
+  }
+  memset(&glyph_atlas, 0, sizeof(glyph_atlas));
+}
+
+// Draws the quads of the current batch
+static void flush_glyph_atlas(void) {
+  if (glyph_atlas.quad_count == 0) return;
+  SDL_RenderGeometry(glyph_atlas.renderer, glyph_atlas.texture, glyph_atlas.vertices, glyph_atlas.quad_count * 4, glyph_atlas.indices, glyph_atlas.quad_count * 6);
+  glyph_atlas.quad_count = 0;
+}
+
+// Empties the atlas when it is full. Quads that use the old glyphs are drawn first.
+static void reset_glyph_atlas(void) {
+  flush_glyph_atlas();
+  memset(glyph_atlas.glyphs, 0, sizeof(glyph_atlas.glyphs));
+  glyph_atlas.glyph_count = 0;
+  glyph_atlas.shelf_x = 0;
+  glyph_atlas.shelf_y = 0;
+  glyph_atlas.shelf_height = 0;
+  glyph_atlas.resets++;
+}
+
+// Finds room for a bitmap in the atlas, with a pixel of space to its right and below it. Returns false if the atlas is full.
+static bool pack_glyph_atlas(i32 width, i32 height, i32 *x, i32 *y) {
+  if (glyph_atlas.shelf_x + width + 1 > GLYPH_ATLAS_SIZE) {
+    glyph_atlas.shelf_y += glyph_atlas.shelf_height;
+    glyph_atlas.shelf_x = 0;
+    glyph_atlas.shelf_height = 0;
+  }
+  if (width + 1 > GLYPH_ATLAS_SIZE || glyph_atlas.shelf_y + height + 1 > GLYPH_ATLAS_SIZE) return false;
+  *x = glyph_atlas.shelf_x;
+  *y = glyph_atlas.shelf_y;
+  glyph_atlas.shelf_x += width + 1;
+  if (height + 1 > glyph_atlas.shelf_height) {
+    glyph_atlas.shelf_height = height + 1;
+  }
+  return true;
+}
+
+// Rasterizes a glyph at a quarter pixel offset and uploads it to the atlas
+static AtlasGlyph *add_atlas_glyph(AtlasGlyph *slot, u32 key, SFT *sft, SFT_Glyph glyph, i32 subpixel) {
+  // Baked glyphs are copied from the baked fonts instead of being rasterized
+  const u8 *baked_pixels = 0;
+  const SFT_BakedGlyph *baked = sft_baked_glyph(sft, glyph, subpixel, &baked_pixels);
+  SFT_GMetrics metrics;
+  if (baked == 0 && sft_gmetrics(sft, glyph, &metrics) < 0) return 0;
+  // The bitmap is placed like in the glyph cache, at the quantized pen offset plus the left side bearing
+  f64 left = baked != 0 ? 0 : metrics.leftSideBearing + (f64)subpixel / GLYPH_CACHE_SUBPIXELS;
+  i32 left_pixels = (i32)floor(left);
+  *slot = (AtlasGlyph){
+    .key = key,
+    .width = baked != 0 ? baked->width : metrics.minWidth,
+    .height = baked != 0 ? baked->height : metrics.minHeight,
+    .left = baked != 0 ? baked->left : left_pixels,
+    .top = baked != 0 ? baked->top : metrics.yOffset,
+  };
+  if (slot->width <= 0 || slot->height <= 0) return slot;
+  if (!pack_glyph_atlas(slot->width, slot->height, &slot->x, &slot->y)) return 0;
+
+  i32 pixel_count = slot->width * slot->height;
+  Arena *temp_arena = arena_open(pixel_count * (sizeof(u8) + sizeof(RGBA)) + 64);
+  RGBA *pixels = arena_fill(temp_arena, pixel_count * sizeof(RGBA));
+  const u8 *coverage = baked_pixels;
+  if (baked == 0) {
+    u8 *rendered = arena_fill(temp_arena, pixel_count);
+    memset(rendered, 0, pixel_count);
+    SFT_Image image = {
+      .pixels = rendered,
+      .width = slot->width,
+      .height = slot->height,
+    };
+    f64 x_offset = sft->xOffset;
+    sft->xOffset = left - left_pixels;
+    i32 result = sft_render(sft, glyph, image);
+    sft->xOffset = x_offset;
+    if (result < 0) {
+      arena_close(temp_arena);
+      return 0;
+    }
+    coverage = rendered;
+  }
+  // White pixels with the coverage as alpha, so that the vertex color sets the text color
+  for (i32 i = 0; i < pixel_count; i++) {
+    pixels[i] = 0xFFFFFF00 | coverage[i];
+  }
+  SDL_Rect rect = {slot->x, slot->y, slot->width, slot->height};
+  SDL_UpdateTexture(glyph_atlas.texture, &rect, pixels, slot->width * sizeof(RGBA));
+  arena_close(temp_arena);
+  return slot;
+}
+
+// Returns the atlas glyph, adding it on a miss. Returns 0 if the glyph could not be rasterized or does not fit the atlas.
+static AtlasGlyph *get_atlas_glyph(u8 font_variant, SFT *sft, SFT_Glyph glyph, i32 subpixel) {
+  u32 key = (((u32)font_variant << 24) | ((u32)glyph << 2) | (u32)subpixel) + 1;
+  u32 bucket = (key * 2654435761u) & (GLYPH_ATLAS_BUCKETS - 1);
+  while (glyph_atlas.glyphs[bucket].key != 0) {
+    if (glyph_atlas.glyphs[bucket].key == key) return &glyph_atlas.glyphs[bucket];
+    bucket = (bucket + 1) & (GLYPH_ATLAS_BUCKETS - 1);
+  }
+  if (glyph_atlas.glyph_count >= GLYPH_ATLAS_MAX_GLYPHS) {
+    reset_glyph_atlas();
+    return get_atlas_glyph(font_variant, sft, glyph, subpixel);
+  }
+  AtlasGlyph *added = add_atlas_glyph(&glyph_atlas.glyphs[bucket], key, sft, glyph, subpixel);
+  if (added == 0 && glyph_atlas.shelf_y > 0) {
+    // The atlas is full, so start over with an empty one
+    glyph_atlas.glyphs[bucket].key = 0;
+    reset_glyph_atlas();
+    return get_atlas_glyph(font_variant, sft, glyph, subpixel);
+  }
+  if (added == 0) {
+    glyph_atlas.glyphs[bucket].key = 0;
+    return 0;
+  }
+  glyph_atlas.glyph_count++;
+  return added;
+}
+
+// Adds a quad for the part of a glyph bitmap at x, y that is inside the clip rectangle
+static void push_glyph_quad(AtlasGlyph *entry, i32 x, i32 y, SDL_Color color, SDL_Rect clip) {
+  i32 left = x > clip.x ? x : clip.x;
+  i32 top = y > clip.y ? y : clip.y;
+  i32 right = x + entry->width < clip.x + clip.w ? x + entry->width : clip.x + clip.w;
+  i32 bottom = y + entry->height < clip.y + clip.h ? y + entry->height : clip.y + clip.h;
+  if (left >= right || top >= bottom) return;
+  if (glyph_atlas.quad_count == GLYPH_ATLAS_BATCH) {
+    flush_glyph_atlas();
+  }
+  f32 u0 = (f32)(entry->x + left - x) / GLYPH_ATLAS_SIZE;
+  f32 v0 = (f32)(entry->y + top - y) / GLYPH_ATLAS_SIZE;
+  f32 u1 = (f32)(entry->x + right - x) / GLYPH_ATLAS_SIZE;
+  f32 v1 = (f32)(entry->y + bottom - y) / GLYPH_ATLAS_SIZE;
+  SDL_Vertex *vertices = &glyph_atlas.vertices[glyph_atlas.quad_count * 4];
+  vertices[0] = (SDL_Vertex){{left, top}, color, {u0, v0}};
+  vertices[1] = (SDL_Vertex){{right, top}, color, {u1, v0}};
+  vertices[2] = (SDL_Vertex){{left, bottom}, color, {u0, v1}};
+  vertices[3] = (SDL_Vertex){{right, bottom}, color, {u1, v1}};
+  glyph_atlas.quad_count++;
+}
+
+// Adds the quads of count characters of a run, starting at the character first, with the first character at x and the top of the line at y
+static void push_text_run_quads(u8 font_variant, SFT *sft, TextRun *run, i32 first, i32 count, i32 x, i32 y, SDL_Color color, SDL_Rect clip) {
+  // Only draw the characters that reach into the clip rectangle, with a margin of one em like draw_text_run
+  f64 visible_x = run->pens[first] - x;
+  f64 margin = sft->xScale;
+  i32 visible_first = get_text_run_index_at_x(run, visible_x + clip.x - margin);
+  i32 visible_end = get_text_run_index_at_x(run, visible_x + clip.x + clip.w + margin) + 1;
+  if (visible_first < first) {
+    visible_first = first;
+  }
+  if (visible_end > first + count) {
+    visible_end = first + count;
+  }
+  SFT_LMetrics metrics;
+  if (sft_lmetrics(sft, &metrics) < 0) return;
+  i32 baseline = y + (i32)metrics.ascender;
+  for (i32 i = visible_first; i < visible_end; i++) {
+    // Quantize the pen position like render_glyph_at
+    f64 pen = run->pens[i] - visible_x;
+    i32 subpixel_position = (i32)floor(pen * GLYPH_CACHE_SUBPIXELS + 0.5);
+    i32 pen_pixel = (i32)floor((f64)subpixel_position / GLYPH_CACHE_SUBPIXELS);
+    i32 subpixel = subpixel_position - pen_pixel * GLYPH_CACHE_SUBPIXELS;
+    AtlasGlyph *entry = get_atlas_glyph(font_variant, sft, run->glyphs[i], subpixel);
+    if (entry == 0 || entry->width <= 0) continue;
+    push_glyph_quad(entry, pen_pixel + entry->left, baseline + entry->top, color, clip);
+  }
+}
+
+// Draws a single line of text into the render target. text_position is in target coordinates and nothing is drawn outside clip.
+void draw_atlas_text(SDL_Renderer *renderer, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, SDL_Rect clip) {
+  if (glyph_atlas.texture == 0 || text.data == 0 || text.length <= 0) return;
+  SFT *sft = get_sft(font_variant);
+  TextRun *run = get_shaped_text_run_async(font_variant, text);
+  if (sft == 0 || run == 0 || run->glyph_count == 0) return;
+  glyph_atlas.renderer = renderer;
+  // Clip to the text like draw_text_run
+  if (!SDL_IntersectRect(&clip, &text_position, &clip)) return;
+  SDL_Color vertex_color = {red(color), green(color), blue(color), alpha(color)};
+  push_text_run_quads(font_variant, sft, run, 0, run->glyph_count, text_position.x, text_position.y, vertex_color, clip);
+  flush_glyph_atlas();
+}
+
+// Draws text wrapped to the width of text_position into the render target, like draw_multiline_text
+void draw_atlas_multiline_text(SDL_Renderer *renderer, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, SDL_Rect clip) {
+  if (glyph_atlas.texture == 0 || text.data == 0 || text.length <= 0) return;
+  SFT *sft = get_sft(font_variant);
+  TextRun *run = get_text_run_async(font_variant, text, text_position.w);
+  if (sft == 0 || run == 0 || run->glyph_count == 0) return;
+  Array *lines = wrap_text_run_async(run, text_position.w);
+  if (lines == 0) return;
+  glyph_atlas.renderer = renderer;
+  i32 line_height = get_text_line_height(font_variant);
+  SDL_Color vertex_color = {red(color), green(color), blue(color), alpha(color)};
+  i32 text_bottom = text_position.y + text_position.h;
+  // Skip the lines above the clip rectangle
+  i32 first_line = text_position.y < clip.y ? (clip.y - text_position.y) / line_height : 0;
+  i32 y = text_position.y + first_line * line_height;
+  for (i32 i = first_line; i < array_length(lines) && y < clip.y + clip.h; i++) {
+    Line *line = array_get(lines, i);
+    i32 first = get_text_run_index(run, line->start_index);
+    i32 end = get_text_run_index(run, line->end_index);
+    // Each line is clipped to its own strip, like draw_text_run
+    SDL_Rect line_rect = {
+      .x = text_position.x,
+      .y = y,
+      .w = text_position.w,
+      .h = text_bottom - y < line_height ? text_bottom - y : line_height,
+    };
+    SDL_Rect line_clip;
+    if (end > first && SDL_IntersectRect(&clip, &line_rect, &line_clip)) {
+      push_text_run_quads(font_variant, sft, run, first, end - first, text_position.x, y, vertex_color, line_clip);
+    }
+    y += line_height;
+  }
+  flush_glyph_atlas();
+}
+
+#define C9_GLYPH_ATLAS
+#endif
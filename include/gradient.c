@@ -0,0 +1,224 @@
+#ifndef C9_GRADIENT
+
+#if defined(__AVX2__)
+#include <immintrin.h> // __m256i, _mm256_min_epi32, _mm256_max_epi32, _mm256_i32gather_epi32
+#elif defined(__SSE2__)
+#include <emmintrin.h> // __m128i, _mm_cmpgt_epi32, _mm_srli_epi32, _mm_storeu_si128
+#elif defined(__ARM_NEON)
+#include <arm_neon.h> // int32x4_t, vminq_s32, vmaxq_s32, vshrq_n_s32
+#endif
+#include <stdbool.h> // bool
+#include "color.c" // RGBA, C9_Gradient, get_dither_spread, red, green, blue
+#include "dither.c" // DitherTile, set_dither_tile, get_dither_row, DITHER_TILE_SIZE, DITHER_TILE_MASK
+#include "pixel_span.c" // fill_span, copy_span
+#include "types.c" // i32, i64, u8, f32
+
+/*
+
+A gradient table holds the colors of a gradient at GRADIENT_STEPS + 1 evenly spaced positions between start_at and end_at, so that gradient fills look each pixel up in the table instead of interpolating three channels in floats. Positions along a gradient are 16.16 fixed point indexes into the table, and the blue noise dithering is added to them from a dither tile that is scaled to the dither spread of the gradient. With 4096 steps a position is never more than a sixteenth of a color level from the exact one, so a dithered pixel is at most one level from get_dithered_gradient_color and the gradient looks the same. The table is 16 KB, which stays in the L1 cache while a rectangle is filled. A gradient that is shorter than two pixels is drawn as a hard edge at start_at, so the positions and steps of the spans always fit an i32.
+
+The table of the last gradient is kept, since the elements of a theme share a few gradients.
+
+Horizontal spans look up 8 pixels at a time with AVX2 (with a gather) and compute the positions of 4 pixels at a time with SSE2 or NEON. The dither tile repeats every 32 pixels, so a row of a vertical gradient is 32 colors repeated, and a row of a horizontal gradient is the same as the row 32 rows above it.
+
+*/
+
+#define GRADIENT_STEPS 4096
+#define GRADIENT_ONE (GRADIENT_STEPS << 16) // Fixed point position of end_at
+#define GRADIENT_MAX_POSITION (1 << 29) // Positions and dither offsets are clamped to it, so that their sum fits an i32
+#define GRADIENT_MAX_STEP (GRADIENT_ONE / 2) // Gradients with a larger step, which are shorter than two pixels, are a hard edge
+
+typedef struct {
+  C9_Gradient gradient;
+  RGBA colors[GRADIENT_STEPS + 1];
+  DitherTile dither; // Position offsets of the blue noise
+  bool ready;
+} GradientTable;
+
+// Pixels along the width or height of a gradient rectangle
+typedef struct {
+  i32 first_inside; // First pixel at or after start_at
+  i32 end_inside; // First pixel after end_at
+  i32 origin; // Fixed point position of the first pixel inside, from -GRADIENT_MAX_POSITION to GRADIENT_MAX_POSITION
+  i32 step; // Fixed point distance between two pixels, from 0 to GRADIENT_MAX_STEP
+} GradientAxis;
+
+GradientTable gradient_table = {0};
+
+static f32 get_gradient_range(C9_Gradient gradient) {
+  // Default to 1 if the end_at is 0
+  f32 end_at = gradient.end_at == 0 ? 1 : gradient.end_at;
+  f32 range = end_at - gradient.start_at;
+  // A gradient without length is a hard edge
+  return range > 0 ? range : 1.0 / GRADIENT_MAX_POSITION;
+}
+
+// Returns the table of a gradient, building it if it is not the last one used
+GradientTable *get_gradient_table(C9_Gradient gradient) {
+  GradientTable *table = &gradient_table;
+  if (table->ready && table->gradient.start_color == gradient.start_color && table->gradient.end_color == gradient.end_color &&
+      table->gradient.start_at == gradient.start_at && table->gradient.end_at == gradient.end_at) {
+    return table;
+  }
+  table->gradient = gradient;
+  u8 start_r = red(gradient.start_color);
+  u8 start_g = green(gradient.start_color);
+  u8 start_b = blue(gradient.start_color);
+  i32 delta_r = red(gradient.end_color) - start_r;
+  i32 delta_g = green(gradient.end_color) - start_g;
+  i32 delta_b = blue(gradient.end_color) - start_b;
+  for (i32 i = 0; i <= GRADIENT_STEPS; i++) {
+    f32 position = (f32)i / GRADIENT_STEPS;
+    u8 r = start_r + delta_r * position;
+    u8 g = start_g + delta_g * position;
+    u8 b = start_b + delta_b * position;
+    table->colors[i] = (r << 24) | (g << 16) | (b << 8) | 0xFF;
+  }
+  // The noise moves the position by up to the dither spread
+  f32 offset_scale = get_dither_spread(gradient) / get_gradient_range(gradient) * GRADIENT_ONE / 255;
+  set_dither_tile(&table->dither, offset_scale, GRADIENT_MAX_POSITION);
+  table->ready = true;
+  return table;
+}
+
+// Returns how the pixels along a length of the rectangle map to the gradient
+GradientAxis get_gradient_axis(C9_Gradient gradient, i32 length) {
+  f32 end_at = gradient.end_at == 0 ? 1 : gradient.end_at;
+  f32 one_percent = 1.0 / length; // Same steps as the position of get_dithered_gradient_color
+  GradientAxis axis = {.first_inside = 0, .end_inside = length};
+  while (axis.first_inside < length && axis.first_inside * one_percent < gradient.start_at) {
+    axis.first_inside++;
+  }
+  while (axis.end_inside > axis.first_inside && (axis.end_inside - 1) * one_percent > end_at) {
+    axis.end_inside--;
+  }
+  f32 range = get_gradient_range(gradient);
+  f32 step = one_percent / range * GRADIENT_ONE;
+  // A gradient that is shorter than two pixels (like a hard edge) has no pixels inside, so the pixels before start_at
+  // get the start color and the others the end color. This also keeps steps that do not fit an i32 out of the spans.
+  if (axis.first_inside >= axis.end_inside || !(step <= GRADIENT_MAX_STEP)) {
+    axis.end_inside = axis.first_inside;
+    return axis;
+  }
+  axis.step = (i32)step;
+  // The pixels inside are from 0 to GRADIENT_ONE apart from rounding, the clamp keeps the sums of the spans in an i32
+  i64 origin = (i64)(-gradient.start_at / range * GRADIENT_ONE) + (i64)axis.first_inside * axis.step;
+  if (origin < -GRADIENT_MAX_POSITION) origin = -GRADIENT_MAX_POSITION;
+  if (origin > GRADIENT_MAX_POSITION) origin = GRADIENT_MAX_POSITION;
+  axis.origin = (i32)origin;
+  return axis;
+}
+
+// Returns the color of a dithered fixed point position
+static inline RGBA get_gradient_table_color(GradientTable *table, i32 position) {
+  if (position <= 0) return table->colors[0];
+  if (position >= GRADIENT_ONE) return table->colors[GRADIENT_STEPS];
+  return table->colors[position >> 16];
+}
+
+// Returns the fixed point position of pixel i of an axis that is inside the gradient, clamped to GRADIENT_MAX_POSITION
+static inline i32 get_gradient_axis_position(GradientAxis axis, i32 i) {
+  i64 position = axis.origin + (i64)(i - axis.first_inside) * axis.step;
+  if (position < -GRADIENT_MAX_POSITION) return -GRADIENT_MAX_POSITION;
+  if (position > GRADIENT_MAX_POSITION) return GRADIENT_MAX_POSITION;
+  return (i32)position;
+}
+
+// Returns the color of pixel i along an axis, moved by an offset of the dither tile
+RGBA get_gradient_pixel(GradientTable *table, GradientAxis axis, i32 i, i32 dither_offset) {
+  if (i < axis.first_inside) return table->gradient.start_color;
+  if (i >= axis.end_inside) return table->gradient.end_color;
+  return get_gradient_table_color(table, get_gradient_axis_position(axis, i) + dither_offset);
+}
+
+// Writes count pixels of row y of a horizontal gradient, starting at column first of the rectangle
+void fill_horizontal_gradient_span(RGBA *span, GradientTable *table, GradientAxis axis, i32 first, i32 count, i32 y) {
+  i32 end = first + count;
+  // Pixels before start_at get the start color and pixels after end_at the end color
+  i32 inside_first = axis.first_inside < first ? first : (axis.first_inside > end ? end : axis.first_inside);
+  i32 inside_end = axis.end_inside < inside_first ? inside_first : (axis.end_inside > end ? end : axis.end_inside);
+  fill_span(span, inside_first - first, table->gradient.start_color);
+  i32 *dither_row = get_dither_row(&table->dither, y);
+  i32 position = get_gradient_axis_position(axis, inside_first);
+  i32 step = axis.step;
+  i32 x = inside_first;
+#if defined(__AVX2__)
+  __m256i positions = _mm256_add_epi32(_mm256_set1_epi32(position), _mm256_mullo_epi32(_mm256_set1_epi32(step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+  __m256i vector_step = _mm256_set1_epi32(step * 8);
+  __m256i zero = _mm256_setzero_si256();
+  __m256i one = _mm256_set1_epi32(GRADIENT_ONE);
+  for (; x + 8 <= inside_end; x += 8) {
+    __m256i dithered = _mm256_add_epi32(positions, _mm256_loadu_si256((__m256i *)(dither_row + (x & DITHER_TILE_MASK))));
+    __m256i indexes = _mm256_srli_epi32(_mm256_max_epi32(_mm256_min_epi32(dithered, one), zero), 16);
+    _mm256_storeu_si256((__m256i *)(span + x - first), _mm256_i32gather_epi32((const int *)table->colors, indexes, 4));
+    positions = _mm256_add_epi32(positions, vector_step);
+  }
+  position = _mm256_extract_epi32(positions, 0);
+#elif defined(__SSE2__)
+  __m128i positions = _mm_setr_epi32(position, position + step, position + 2 * step, position + 3 * step);
+  __m128i vector_step = _mm_set1_epi32(step * 4);
+  __m128i one = _mm_set1_epi32(GRADIENT_ONE);
+  for (; x + 4 <= inside_end; x += 4) {
+    __m128i dithered = _mm_add_epi32(positions, _mm_loadu_si128((__m128i *)(dither_row + (x & DITHER_TILE_MASK))));
+    // Clamp to 0 and GRADIENT_ONE, SSE2 has no 32 bit min and max
+    __m128i above = _mm_cmpgt_epi32(dithered, one);
+    dithered = _mm_or_si128(_mm_and_si128(above, one), _mm_andnot_si128(above, dithered));
+    dithered = _mm_and_si128(dithered, _mm_cmpgt_epi32(dithered, _mm_setzero_si128()));
+    i32 indexes[4];
+    _mm_storeu_si128((__m128i *)indexes, _mm_srli_epi32(dithered, 16));
+    RGBA *pixels = span + x - first;
+    pixels[0] = table->colors[indexes[0]];
+    pixels[1] = table->colors[indexes[1]];
+    pixels[2] = table->colors[indexes[2]];
+    pixels[3] = table->colors[indexes[3]];
+    positions = _mm_add_epi32(positions, vector_step);
+  }
+  position = _mm_cvtsi128_si32(positions);
+#elif defined(__ARM_NEON)
+  int32x4_t positions = {position, position + step, position + 2 * step, position + 3 * step};
+  int32x4_t vector_step = vdupq_n_s32(step * 4);
+  int32x4_t zero = vdupq_n_s32(0);
+  int32x4_t one = vdupq_n_s32(GRADIENT_ONE);
+  for (; x + 4 <= inside_end; x += 4) {
+    int32x4_t dithered = vaddq_s32(positions, vld1q_s32(dither_row + (x & DITHER_TILE_MASK)));
+    i32 indexes[4];
+    vst1q_s32(indexes, vshrq_n_s32(vmaxq_s32(vminq_s32(dithered, one), zero), 16));
+    RGBA *pixels = span + x - first;
+    pixels[0] = table->colors[indexes[0]];
+    pixels[1] = table->colors[indexes[1]];
+    pixels[2] = table->colors[indexes[2]];
+    pixels[3] = table->colors[indexes[3]];
+    positions = vaddq_s32(positions, vector_step);
+  }
+  position = vgetq_lane_s32(positions, 0);
+#endif
+  for (; x < inside_end; x++) {
+    span[x - first] = get_gradient_table_color(table, position + dither_row[x & DITHER_TILE_MASK]);
+    position += step;
+  }
+  fill_span(span + inside_end - first, end - inside_end, table->gradient.end_color);
+}
+
+// Writes count pixels of row y of a vertical gradient, starting at column first of the rectangle
+void fill_vertical_gradient_span(RGBA *span, GradientTable *table, GradientAxis axis, i32 first, i32 count, i32 y) {
+  if (y < axis.first_inside || y >= axis.end_inside) {
+    fill_span(span, count, y < axis.first_inside ? table->gradient.start_color : table->gradient.end_color);
+    return;
+  }
+  // The colors of the row repeat with the dither tile, so only the first tile width is looked up
+  i32 *dither_row = get_dither_row(&table->dither, y);
+  i32 position = get_gradient_axis_position(axis, y);
+  i32 pattern = count < DITHER_TILE_SIZE ? count : DITHER_TILE_SIZE;
+  for (i32 x = 0; x < pattern; x++) {
+    span[x] = get_gradient_table_color(table, position + dither_row[(first + x) & DITHER_TILE_MASK]);
+  }
+  // Double the filled part until the span is full
+  for (i32 filled = pattern; filled < count;) {
+    i32 length = filled < count - filled ? filled : count - filled;
+    copy_span(span + filled, span, length);
+    filled += length;
+  }
+}
+
+#define C9_GRADIENT
+#endif
@@ -1,9 +1,12 @@
 #ifndef C9_INPUT
 
-#include "arena.c" // Arena
-#include "array.c" // Array, array_create, array_clear
-#include "string.c" // s8, new_string
-#include "types.c" // u8, i32
+#include <stdbool.h> // bool
+#include <string.h> // memcpy
+#include "arena.c" // Arena, arena_fill
+#include "array.c" // Array, array_create, array_clear, array_get, array_length
+#include "status.c" // status
+#include "string.c" // s8, new_string, insert_into_string, delete_from_string
+#include "types.c" // u8, i32, f32
 #include "types_common.c" // Line
 
 typedef struct {
@@ -35,11 +38,26 @@ typedef struct {
   i32 end_index;
 } Selection;
 
+// Range of the text that has changed since the lines were last wrapped
+// The bytes from start_index to old_end_index in the wrapped text are now the bytes from start_index to new_end_index
+typedef struct {
+  i32 start_index;
+  i32 old_end_index;
+  i32 new_end_index;
+  bool pending; // If the text has changed since the lines were wrapped
+} TextChange;
+
 typedef struct {
   s8 text;
   Selection selection;
   EditHistory *history;
-  Array *lines;
+  Array *lines; // Array of Line, read with get_input_line
+  i32 shift_line; // Lines from this index on are stored without shift_offset, so an edit does not touch every later line
+  i32 shift_offset;
+  TextChange change; // Edits that are not yet wrapped into lines
+  i32 wrap_width; // Width the lines were wrapped at
+  f32 *advances; // Right edge of the character at each byte of the text, measured from the start of its line
+  i32 advances_capacity;
   Arena *arena;
 } InputData;
 
@@ -59,18 +77,115 @@ InputData *new_input(Arena *arena) {
     .selection = (Selection){0, 0},
     .history = new_edit_history(arena),
     .lines = array_create(arena, sizeof(Line)),
+    .shift_line = 0,
+    .shift_offset = 0,
+    .change = (TextChange){0},
+    .wrap_width = 0,
+    .advances = 0,
+    .advances_capacity = 0,
     .arena = arena
   };
   return input;
 }
 
+// Removes all lines of the input
+void clear_input_lines(InputData *input) {
+  array_clear(input->lines);
+  input->shift_line = 0;
+  input->shift_offset = 0;
+}
+
+// Returns a line of the input with its indexes in the current text
+Line get_input_line(InputData *input, i32 line_index) {
+  Line line = *(Line *)array_get(input->lines, line_index);
+  if (line_index >= input->shift_line) {
+    line.start_index += input->shift_offset;
+    line.end_index += input->shift_offset;
+  }
+  return line;
+}
+
+// Returns the index of the last line that starts at or before a character index
+i32 find_input_line(InputData *input, i32 index) {
+  i32 low = 0;
+  i32 high = array_length(input->lines) - 1;
+  while (low < high) {
+    i32 mid = (low + high + 1) / 2;
+    if (get_input_line(input, mid).start_index <= index) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
 void clear_input(InputData *input) {
   input->text.length = 0;
   input->text.data[0] = '\0';
   input->selection = (Selection){0, 0};
   input->history->current_index = 0;
   array_clear(input->history->actions);
-  array_clear(input->lines);
+  clear_input_lines(input);
+  input->change = (TextChange){0};
+}
+
+// Makes room for the advances of length bytes, keeping the advances of the first kept_length bytes
+void reserve_input_advances(InputData *input, i32 length, i32 kept_length) {
+  if (length <= input->advances_capacity) return;
+  i32 capacity = input->advances_capacity > 0 ? input->advances_capacity : 32;
+  while (capacity < length) {
+    capacity *= 2;
+  }
+  f32 *advances = arena_fill(input->arena, capacity * sizeof(f32));
+  if (input->advances != 0 && kept_length > 0) {
+    memcpy(advances, input->advances, kept_length * sizeof(f32));
+  }
+  input->advances = advances;
+  input->advances_capacity = capacity;
+}
+
+// Returns true if the advances match the lines and the current text
+bool has_line_advances(InputData *input) {
+  return input->advances != 0 && !input->change.pending && array_length(input->lines) > 0;
+}
+
+// Adds an edit, where length bytes at index were replaced by new_length bytes, to the pending change of the input
+void add_text_change(InputData *input, i32 index, i32 length, i32 new_length) {
+  TextChange *change = &input->change;
+  if (!change->pending) {
+    *change = (TextChange){
+      .start_index = index,
+      .old_end_index = index + length,
+      .new_end_index = index + new_length,
+      .pending = true,
+    };
+    return;
+  }
+  // Grow the change to cover both edits. Bytes after new_end_index are shifted the same way in both texts.
+  i32 end_index = index + length;
+  if (change->new_end_index > end_index) {
+    end_index = change->new_end_index;
+  }
+  change->old_end_index = end_index - (change->new_end_index - change->old_end_index);
+  change->new_end_index = end_index + new_length - length;
+  if (index < change->start_index) {
+    change->start_index = index;
+  }
+}
+
+// Inserts text into the input and records the change
+i32 insert_into_input(InputData *input, s8 text, i32 index) {
+  if (insert_into_string(input->arena, &input->text, text, index) == status.ERROR) return status.ERROR;
+  add_text_change(input, index, 0, text.length);
+  return status.OK;
+}
+
+// Deletes text from the input and records the change
+void delete_from_input(InputData *input, i32 index, i32 length) {
+  if (input->text.capacity == 0) return;
+  delete_from_string(&input->text, index, length);
+  add_text_change(input, index, length, 0);
 }
 
 #define C9_INPUT
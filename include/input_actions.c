@@ -4,12 +4,12 @@
 #include <stdbool.h> // bool
 #include <string.h> // memcpy, strcmp
 #include "arena.c" // Arena
-#include "array.c" // Array
-#include "font_layout.c" // has_continuation_byte
-#include "input.c" // EditAction, EditHistory, Selection, InputData
-#include "schrift.c" // SFT, SFT_text_width
+#include "array.c" // Array, array_get, array_length
+#include "font_layout.c" // has_continuation_byte, get_line_prefix_width
+#include "input.c" // EditAction, EditHistory, Selection, InputData, insert_into_input, delete_from_input, get_input_line
+#include "text_run.c" // TextRun, get_text_run, get_text_run_prefix_width
 #include "status.c" // status
-#include "string.c" // s8, insert_into_string, delete_from_string, string_from_substring
+#include "string.c" // s8, string_from_substring
 #include "types.c" // u8, i32
 
 // EditHistory is an Array of of EditActions
@@ -123,10 +123,10 @@ void replace_text(InputData *input, char *text) {
   s8 new_text = string_from_substring(input->arena, (u8 *)text, 0, new_text_length);
 
   // Replace the text by removing the replaced text and then inserting the new text
-  delete_from_string(&input->text, *start_index, replaced_text_length);
-  if (insert_into_string(input->arena, &input->text, new_text, *start_index) == status.ERROR) {
+  delete_from_input(input, *start_index, replaced_text_length);
+  if (insert_into_input(input, new_text, *start_index) == status.ERROR) {
     // Clean up and abort if the insert fails
-    insert_into_string(input->arena, &input->text, replaced_text, *start_index);
+    insert_into_input(input, replaced_text, *start_index);
     return;
   }
 
@@ -160,7 +160,7 @@ void insert_text(InputData *input, char *text) {
     s8 new_text = string_from_substring(input->arena, (u8 *)text, 0, new_text_length);
 
     // Insert the text
-    if (insert_into_string(input->arena, &input->text, new_text, *start_index) == status.ERROR) return;
+    if (insert_into_input(input, new_text, *start_index) == status.ERROR) return;
 
     // Create an edit action
     EditAction action = {
@@ -199,7 +199,7 @@ void delete_text(InputData *input) {
   s8 deleted_text = string_from_substring(input->arena, input->text.data, *start_index, deleted_text_length);
 
   // Delete the text
-  delete_from_string(&input->text, *start_index, deleted_text_length);
+  delete_from_input(input, *start_index, deleted_text_length);
 
   // Create an edit action
   EditAction action = {
@@ -230,23 +230,23 @@ void undo_action(InputData *input) {
   i32 *end_index = get_end_ref(&input->selection);
   if (action->type == edit_action_type.insert) {
     // Delete the inserted text
-    delete_from_string(&input->text, action->index, action->text.length);
+    delete_from_input(input, action->index, action->text.length);
     // Set the selection to the start index
     *start_index = action->index;
     *end_index = action->index;
   } else if (action->type == edit_action_type.delete) {
     // Insert the deleted text
-    if (insert_into_string(input->arena, &input->text, action->replaced_text, action->index) == status.ERROR) return;
+    if (insert_into_input(input, action->replaced_text, action->index) == status.ERROR) return;
 
     // Set the selection to the end of the inserted text
     *start_index = action->index + action->replaced_text.length;
     *end_index = action->index + action->replaced_text.length;
   } else if (action->type == edit_action_type.replace) {
     // Replace the replaced text with the text by first removing the replaced text and then inserting the text
-    delete_from_string(&input->text, action->index, action->text.length);
-    if (insert_into_string(input->arena, &input->text, action->replaced_text, action->index) == status.ERROR) {
+    delete_from_input(input, action->index, action->text.length);
+    if (insert_into_input(input, action->replaced_text, action->index) == status.ERROR) {
       // Clean up and abort if the insert fails
-      insert_into_string(input->arena, &input->text, action->replaced_text, action->index);
+      insert_into_input(input, action->replaced_text, action->index);
       return;
     }
     // Set the selection to the end of the inserted text
@@ -270,22 +270,22 @@ void redo_action(InputData *input) {
   // Perform the redo action for next_index
   if (action->type == edit_action_type.insert) {
     // Add the inserted text
-    if (insert_into_string(input->arena, &input->text, action->text, action->index) == status.ERROR) return;
+    if (insert_into_input(input, action->text, action->index) == status.ERROR) return;
     // Move the selection to the end of the inserted text
     *start_index = action->index + action->text.length;
     *end_index = action->index + action->text.length;
   } else if (action->type == edit_action_type.delete) {
     // Delete the deleted text
-    delete_from_string(&input->text, action->index, action->replaced_text.length);
+    delete_from_input(input, action->index, action->replaced_text.length);
     // Set the selection to the start index
     *start_index = action->index;
     *end_index = action->index;
   } else if (action->type == edit_action_type.replace) {
     // Replace by first removing the replaced_text and then inserting the new text
-    delete_from_string(&input->text, action->index, action->replaced_text.length);
-    if (insert_into_string(input->arena, &input->text, action->text, action->index) == status.ERROR) {
+    delete_from_input(input, action->index, action->replaced_text.length);
+    if (insert_into_input(input, action->text, action->index) == status.ERROR) {
       // Clean up and abort if the insert fails
-      insert_into_string(input->arena, &input->text, action->replaced_text, action->index);
+      insert_into_input(input, action->replaced_text, action->index);
       return;
     }
     // Set the selection to the end of the inserted text
@@ -379,29 +379,23 @@ bool handle_text_input(InputData *input, char *text) {
   return changed_text;
 }
 
-SDL_Rect measure_selection(SFT *font, InputData *input) {
+// Measures the x position and width of the selection from the line advances or the shaped run of the text
+SDL_Rect measure_selection(u8 font_variant, InputData *input) {
   i32 start_index = *get_start_ref(&input->selection);
   i32 end_index = *get_end_ref(&input->selection);
-  Arena *temp_arena = arena_open(sizeof(char) * input->text.capacity);
-  s8 text = input->text;
-
-  // Measure from text start to end of selection
-  u8 *selection_end = arena_fill(temp_arena, end_index + 1); // +1 for null terminator
-  memcpy(selection_end, text.data, end_index);
-  // Add null-terminator
-  selection_end[end_index] = '\0';
-  i32 selection_end_x;
-  SFT_text_width(font, selection_end, &selection_end_x);
-
-  // Measure from text start to start of selection
-  u8 *selection_start = arena_fill(temp_arena, start_index + 1); // +1 for null terminator
-  memcpy(selection_start, text.data, start_index);
-  // Add null-terminator
-  selection_start[start_index] = '\0';
-  i32 selection_start_x;
-  SFT_text_width(font, selection_start, &selection_start_x);
-
-  arena_close(temp_arena);
+  // Text on a single line is measured from the advances of the line
+  if (has_line_advances(input) && array_length(input->lines) == 1) {
+    Line line = get_input_line(input, 0);
+    i32 selection_start_x = get_line_prefix_width(font_variant, input, &line, start_index);
+    return (SDL_Rect){
+      .x = selection_start_x,
+      .w = get_line_prefix_width(font_variant, input, &line, end_index) - selection_start_x,
+    };
+  }
+  TextRun *run = get_text_run(font_variant, input->text);
+  if (run == 0) return (SDL_Rect){0};
+  i32 selection_start_x = get_text_run_prefix_width(run, start_index);
+  i32 selection_end_x = get_text_run_prefix_width(run, end_index);
   SDL_Rect result = {
     .x = selection_start_x,
     .w = selection_end_x - selection_start_x,
@@ -1,14 +1,18 @@
 #ifndef C9_LAYOUT
 
 #include <stdbool.h> // bool
-#include "arena.c" // Arena
-#include "array.c" // Array
-#include "element_tree.c" // Element, ElementTree
-#include "font.c" // get_sft
-#include "font_layout.c" // get_text_block_height, split_string_at_width
-#include "schrift.c" // SFT, SFT_text_width
+#include <string.h> // memcpy, memmove
+#include "arena.c" // Arena, arena_fill, arena_open, arena_close
+#include "array.c" // Array, array_move
+#include "element_tree.c" // Element, ElementTree, empty_element, add_new_element, free_textures
+#include "font.c" // get_font_height
+#include "font_layout.c" // get_text_block_height, wrap_paragraphs, wrap_paragraph_window, line_spacing
+#include "input.c" // InputData, reserve_input_advances, clear_input_lines, get_input_line, find_input_line
 #include "string.c" // s8
+#include "text_run.c" // get_text_width
+#include "text_worker.c" // get_text_width_async, get_text_block_height_async
 #include "types.c" // i32
+#include "virtual_list.c" // VirtualList, materialize_virtual_list, get_virtual_row, virtual_list_resized
 
 void force_input_rerender(Element *element) {
   if (element->input != 0) {
@@ -23,11 +27,193 @@ void force_input_rerender(Element *element) {
   }
 }
 
-// Create children from input text, one child per newline
+// Returns the text of a line in the input text
+static s8 get_line_text(s8 input_text, Line line) {
+  return (s8){
+    .data = input_text.data + line.start_index,
+    .length = line.end_index - line.start_index,
+  };
+}
+
+// Sets the text of a line element, keeping its texture. Line elements own a copy of their text, so the lines after an
+// edit do not have to follow the input text when it moves. The copy reuses the buffer of the element if the text fits.
+static void set_line_element(Arena *arena, Element *element, Element *line_element, s8 text) {
+  if (text.length + 1 > line_element->text.capacity) {
+    i32 capacity = line_element->text.capacity > 0 ? line_element->text.capacity : 32;
+    while (capacity < text.length + 1) {
+      capacity *= 2;
+    }
+    line_element->text.data = arena_fill(arena, capacity);
+    line_element->text.capacity = capacity;
+  }
+  memcpy(line_element->text.data, text.data, text.length);
+  line_element->text.data[text.length] = '\0';
+  line_element->text.length = text.length;
+  line_element->overflow = overflow_type.scroll_x;
+  line_element->font_variant = element->font_variant;
+  line_element->changed = true;
+}
+
+// Returns a new line element for the input, without text
+static Element new_line_element(Element *element) {
+  return (Element){
+    .overflow = overflow_type.scroll_x,
+    .font_variant = element->font_variant,
+    .changed = true,
+  };
+}
+
+// Wraps all input text and updates every child
+static void wrap_input_text(Arena *arena, Element *element, i32 max_width) {
+  InputData *input = element->input;
+  clear_input_lines(input);
+  reserve_input_advances(input, input->text.length + 1, 0);
+  wrap_paragraphs(input->lines, input->advances, element->font_variant, input->text, 0, input->text.length, max_width);
+  i32 line_count = array_length(input->lines);
+  i32 child_count = array_length(element->children);
+  // Add one child per new line, before the texts are copied, so that the children stay close together in the arena
+  for (i32 i = child_count; i < line_count; i++) {
+    Element *line_element = add_new_element(arena, element);
+    *line_element = new_line_element(element);
+  }
+  // Remove children if there are more children than lines
+  for (i32 i = line_count; i < child_count; i++) {
+    free_textures(array_pop(element->children));
+  }
+  for (i32 i = 0; i < line_count; i++) {
+    s8 line_text = get_line_text(input->text, get_input_line(input, i));
+    set_line_element(input->arena, element, array_get(element->children, i), line_text);
+  }
+}
+
+// Adds or removes the shift offset of the stored lines from first to end (exclusive)
+static void shift_input_lines(InputData *input, i32 first, i32 end, i32 offset) {
+  for (i32 i = first; i < end; i++) {
+    Line *line = array_get(input->lines, i);
+    line->start_index += offset;
+    line->end_index += offset;
+  }
+}
+
+// Wraps the lines around the pending change again and replaces their lines and children. Wrapping starts a few lines
+// before the change, as the first words of the changed line can move up, and stops at the first new line after the
+// change that starts where an old line started: the text from there on did not change, so neither did its lines.
+// The lines after the change keep their stored indexes and children: the change in length is added to the shift
+// offset of the input, and only the lines between the last change and this one are moved in or out of the shift (see
+// get_input_line). Lines and children after the change are moved in the arrays only if the change adds or removes lines.
+// Returns false if the lines do not match the change, so that all text has to be wrapped again.
+static bool rewrap_input_change(Element *element, i32 max_width) {
+  InputData *input = element->input;
+  TextChange change = input->change;
+  Array *lines = input->lines;
+  i32 line_count = array_length(lines);
+  i32 length_offset = change.new_end_index - change.old_end_index;
+  if (line_count == 0 || array_length(element->children) != line_count) return false;
+  Line last_line = get_input_line(input, line_count - 1);
+  if (last_line.end_index != input->text.length - length_offset || change.old_end_index > last_line.end_index) return false;
+
+  // Start two lines before the line where the change starts, if they are in the same paragraph. A line ends where the
+  // first character that does not fit is found, which can be the first character of the line after the next one.
+  i32 first_line = find_input_line(input, change.start_index);
+  for (i32 i = 0; i < 2 && first_line > 0; i++) {
+    if (get_input_line(input, first_line - 1).end_index != get_input_line(input, first_line).start_index) break;
+    first_line--;
+  }
+
+  // Move the advances after the change like the text, as they are measured from the start of their line
+  i32 old_length = input->text.length - length_offset;
+  reserve_input_advances(input, input->text.length + 1, old_length);
+  memmove(input->advances + change.new_end_index, input->advances + change.old_end_index, (old_length - change.old_end_index) * sizeof(f32));
+
+  // Wrap the changed lines into a temporary array
+  Arena *temp_arena = arena_open(sizeof(Line) * 64);
+  Array *new_lines = array_create_width(temp_arena, sizeof(Line), 4);
+  i32 end_line = line_count; // Old lines from here on are kept
+  i32 start_index = get_input_line(input, first_line).start_index;
+  if (max_width == 0) {
+    // All text is on one line
+    wrap_paragraphs(new_lines, input->advances, element->font_variant, input->text, start_index, change.new_end_index, max_width);
+  }
+  i32 window_length = WRAP_WINDOW_LENGTH;
+  while (max_width > 0 && start_index <= input->text.length) {
+    // The first window reaches past the change, so that an edit is shaped in one go
+    i32 window_base = start_index > change.new_end_index ? start_index : change.new_end_index;
+    i32 first_new_line = array_length(new_lines);
+    i32 next_index = wrap_paragraph_window(new_lines, input->advances, element->font_variant, input->text, start_index, window_base + window_length, max_width);
+    if (next_index == start_index) {
+      // No line ended inside the window
+      window_length *= 2;
+      continue;
+    }
+    window_length = WRAP_WINDOW_LENGTH;
+    start_index = next_index;
+    // Stop at the first line after the change that starts where an old line started
+    for (i32 i = first_new_line; i < array_length(new_lines); i++) {
+      i32 line_start = ((Line *)array_get(new_lines, i))->start_index;
+      if (line_start < change.new_end_index) continue;
+      i32 old_line = find_input_line(input, line_start - length_offset);
+      if (get_input_line(input, old_line).start_index != line_start - length_offset) continue;
+      end_line = old_line;
+      while (array_length(new_lines) > i) {
+        array_pop(new_lines);
+      }
+      break;
+    }
+    if (end_line < line_count) break;
+  }
+  i32 old_count = end_line - first_line;
+  i32 new_count = array_length(new_lines);
+  i32 line_offset = new_count - old_count;
+  i32 tail_count = line_count - end_line;
+
+  // Move the shift to the end of the changed lines: the lines before it are stored with their indexes in the current
+  // text and the lines after it without the shift offset, which gets the change in length
+  if (input->shift_line < first_line) {
+    shift_input_lines(input, input->shift_line, first_line, input->shift_offset);
+  } else if (input->shift_line > end_line) {
+    shift_input_lines(input, end_line, input->shift_line, -input->shift_offset);
+  }
+  input->shift_line = first_line + new_count;
+  input->shift_offset += length_offset;
+
+  // Move the lines after the change to make room for the new lines
+  if (line_offset < 0) {
+    for (i32 i = first_line + new_count; i < end_line; i++) {
+      free_textures(array_get(element->children, i));
+    }
+  }
+  for (i32 i = 0; i < line_offset; i++) {
+    array_push(lines, array_get(lines, line_count - 1));
+    array_push(element->children, &empty_element);
+  }
+  array_move(lines, end_line, end_line + line_offset, tail_count);
+  array_move(element->children, end_line, end_line + line_offset, tail_count);
+  for (i32 i = 0; i < -line_offset; i++) {
+    array_pop(lines);
+    array_pop(element->children);
+  }
+
+  // Replace the lines of the changed paragraphs
+  for (i32 i = 0; i < new_count; i++) {
+    Line *line = array_get(new_lines, i);
+    array_set(lines, first_line + i, line);
+    Element *line_element = array_get(element->children, first_line + i);
+    if (i >= old_count) {
+      // The slot holds an element that was pushed above
+      *line_element = new_line_element(element);
+    }
+    set_line_element(input->arena, element, line_element, get_line_text(input->text, *line));
+  }
+  arena_close(temp_arena);
+  return true;
+}
+
+// Create children from input text, one child per line
+// After the first wrap, only the lines around the edits since the last wrap are wrapped again
 void populate_input_text(Arena *arena, Element *element) {
   // If the element is an input
   if (element->input != 0 && element->input->text.data != 0) {
-    s8 input_text = element->input->text;
+    InputData *input = element->input;
     i32 max_width = element->layout.max_width - element->padding.left - element->padding.right;
     if (element->overflow == overflow_type.scroll || element->overflow == overflow_type.scroll_x) {
       max_width = 0;
@@ -39,79 +225,20 @@ void populate_input_text(Arena *arena, Element *element) {
       if (element->height > 0) {
         element->overflow = overflow_type.scroll_y;
       }
-
-      // Split into lines and save them for later
-      Array *indexes = split_string_at_width(arena, element->font_variant, input_text, max_width);
-      element->input->lines = indexes;
-
-      // Populate children with text lines
       element->children = array_create_width(arena, sizeof(Element), 4);
-      // Add one child per line
-      for (i32 i = 0; i < array_length(indexes); i++) {
-        Line *line = array_get(indexes, i);
-        s8 line_data = {
-          .data = input_text.data + line->start_index,
-          .length = line->end_index - line->start_index,
-        };
-        Element *text_element = add_new_element(arena, element);
-        *text_element = (Element){
-          .text = line_data,
-          .overflow = overflow_type.scroll_x,
-          .font_variant = element->font_variant,
-          .changed = true,
-        };
-      }
+      wrap_input_text(arena, element, max_width);
     }
-    // If the child array already exists
     // If the input element has been changed
     else if (element->changed) {
-      // Split into lines and save them for later
-      Array *indexes = split_string_at_width(arena, element->font_variant, input_text, max_width);
-      element->input->lines = indexes;
-      // Loop through all children and lines and update the changed lines, add lines that are new and remove old lines.
-      i32 line_count = array_length(indexes);
-      i32 child_count = array_length(element->children);
-      // Update the text of the children that already exist
-      for (i32 i = 0; i < line_count && i < child_count; i++) {
-        Line *line = array_get(indexes, i);
-        s8 line_data = {
-          .data = input_text.data + line->start_index,
-          .length = line->end_index - line->start_index,
-        };
-        Element *text_element = array_get(element->children, i);
-        if (!equal_s8(text_element->text, line_data)) {
-          *text_element = (Element){
-            .text = line_data,
-            .overflow = overflow_type.scroll_x,
-            .font_variant = element->font_variant,
-            .changed = true,
-          };
-        }
-      }
-      // Add elements if there are more lines than children
-      if (line_count > child_count) {
-        for (i32 i = child_count; i < line_count; i++) {
-          Line *line = array_get(indexes, i);
-          s8 line_data = {
-            .data = input_text.data + line->start_index,
-            .length = line->end_index - line->start_index,
-          };
-          Element *text_element = add_new_element(arena, element);
-          *text_element = (Element){
-            .text = line_data,
-            .overflow = overflow_type.scroll_x,
-            .font_variant = element->font_variant,
-            .changed = true,
-          };
-        }
-      }
-      // Remove children if there are more children than lines
-      else if (line_count < child_count) {
-        for (i32 i = line_count; i < child_count; i++) {
-          array_pop(element->children);
-        }
+      // Lines wrapped at another width have to be wrapped again
+      if (input->wrap_width != max_width || array_length(input->lines) == 0) {
+        wrap_input_text(arena, element, max_width);
+      } else if (input->change.pending && !rewrap_input_change(element, max_width)) {
+        wrap_input_text(arena, element, max_width);
       }
     }
+    input->wrap_width = max_width;
+    input->change.pending = false;
   }
   // Recursively populate children if the element is not an input
   else if (element->input == 0 && element->children != 0) {
@@ -127,7 +254,7 @@ void populate_input_text(Arena *arena, Element *element) {
       array_clear(element->children);
     }
     if (element->input->lines != 0 && array_length(element->input->lines) > 0) {
-      array_clear(element->input->lines);
+      clear_input_lines(element->input);
     }
   }
 }
@@ -266,9 +393,8 @@ i32 fill_scroll_width(Element *element) {
   }
   // text is always the last child
   else if (element->text.data != 0) {
-    SFT *text_font = get_sft(element->font_variant);
-    i32 text_width = 0;
-    SFT_text_width(text_font, element->text.data, &text_width);
+    // Large texts are measured on the text worker and use an estimate until it is done
+    i32 text_width = get_text_width_async(element->font_variant, element->text);
     if (element->layout.max_width > 0 &&
         element->overflow != overflow_type.scroll &&
         element->overflow != overflow_type.scroll_x) {
@@ -277,7 +403,7 @@ i32 fill_scroll_width(Element *element) {
       } else {
         child_width = element->layout.max_width;
         i32 text_max_width = element->layout.max_width - element_padding;
-        i32 text_height = get_text_block_height(element->font_variant, element->text, text_max_width);
+        i32 text_height = get_text_block_height_async(element->font_variant, element->text, text_max_width);
         element->layout.scroll_height = text_height + element->padding.top + element->padding.bottom;
       }
     } else {
@@ -322,7 +448,20 @@ i32 fill_scroll_height(Element *element) {
   i32 element_padding = element->padding.top + element->padding.bottom;
   i32 child_height = element_padding;
   Array *children = element->children;
-  if (children != 0 && array_length(children) > 0) {
+  // Virtual lists only measure their materialized rows and scroll by themselves
+  if (element->virtual_list != 0) {
+    i64 list_height = get_virtual_list_height(element);
+    for (i32 i = 0; children != 0 && i < array_length(children); i++) {
+      fill_scroll_height(array_get(children, i));
+    }
+    if (element->layout.max_height > 0) {
+      child_height = element->layout.max_height;
+    } else if (list_height + element_padding < INT16_MAX) {
+      child_height = list_height + element_padding;
+    } else {
+      child_height = INT16_MAX;
+    }
+  } else if (children != 0 && array_length(children) > 0) {
     for (i32 i = 0; i < array_length(children); i++) {
       Element *child = array_get(children, i);
       // Vertical layout adds heights
@@ -401,13 +540,14 @@ void cap_scroll(Element *element) {
   }
 }
 
-// Recursively sets element x position
+// Recursively sets element x position relative to the parent
 i32 set_x(Element *element, i32 x) {
   element->layout.x = x;
   Array *children = element->children;
   // If child array is initalized
   if (children != 0) {
-    i32 child_x = x + element->layout.scroll_x + element->padding.left;
+    // Children are placed without the scroll, which is added when rendering
+    i32 child_x = element->padding.left;
     for (i32 i = 0; i < array_length(children); i++) {
       Element *child = array_get(children, i);
       // Horizontal layout sets children after each another
@@ -424,13 +564,24 @@ i32 set_x(Element *element, i32 x) {
   return x + element->layout.max_width;
 }
 
-// Recursively sets element y position
+// Recursively sets element y position relative to the parent
 i32 set_y(Element *element, i32 y) {
   element->layout.y = y;
+  // Virtual list rows are placed from their item index and the list scroll offset
+  if (element->virtual_list != 0) {
+    VirtualList *list = element->virtual_list;
+    i32 stride = get_virtual_row_stride(element);
+    i32 child_y = element->padding.top + ((i64)list->first_index * stride - list->scroll_offset);
+    for (i32 i = 0; i < list->pool_size; i++) {
+      set_y(get_virtual_row(element, i), child_y + i * stride);
+    }
+    return y + element->layout.max_height;
+  }
   Array *children = element->children;
   // If child array is initalized
   if (children != 0) {
-    i32 child_y = y + element->layout.scroll_y + element->padding.top;
+    // Children are placed without the scroll, which is added when rendering
+    i32 child_y = element->padding.top;
     for (i32 i = 0; i < array_length(children); i++) {
       Element *child = array_get(children, i);
       // Vertical layout sets children after each another
@@ -447,17 +598,72 @@ i32 set_y(Element *element, i32 y) {
   return y + element->layout.max_height;
 }
 
+// Sets max dimensions of the materialized rows of a virtual list
+void fill_virtual_rows_max(Element *element) {
+  i32 row_width = element->layout.max_width - element->padding.left - element->padding.right;
+  if (row_width < 0) {
+    row_width = 0;
+  }
+  for (i32 i = 0; i < array_length(element->children); i++) {
+    Element *row = array_get(element->children, i);
+    fill_max_width(row, row_width);
+    fill_max_height(row, 0);
+  }
+}
+
+// Recursively materializes the visible rows of all virtual lists
+void populate_virtual_lists(Element *element) {
+  if (element->virtual_list != 0) {
+    materialize_virtual_list(element);
+    fill_virtual_rows_max(element);
+  }
+  Array *children = element->children;
+  if (children != 0) {
+    for (i32 i = 0; i < array_length(children); i++) {
+      Element *child = array_get(children, i);
+      populate_virtual_lists(child);
+    }
+  }
+}
+
+// Sets the maximum width and height of every element
+void fill_max_dimensions(Element *element, i32 window_width, i32 window_height) {
+  fill_max_width(element, window_width);
+  fill_max_height(element, window_height);
+}
+
+// Materializes the visible rows of all virtual lists
+// Rows that widened a virtual list change the widths of the elements around it, so the maximum dimensions are set again
+void layout_virtual_lists(Element *element, i32 window_width, i32 window_height) {
+  populate_virtual_lists(element);
+  if (virtual_list_resized) {
+    virtual_list_resized = false;
+    fill_max_dimensions(element, window_width, window_height);
+  }
+}
+
+// Sets the scroll dimensions of every element and keeps the scroll offsets inside them
+void fill_scroll_dimensions(Element *element) {
+  fill_scroll_width(element);
+  fill_scroll_height(element);
+  set_max_on_scrolled(element);
+  cap_scroll(element);
+}
+
+// Sets the position of every element relative to its parent
+void set_positions(Element *element) {
+  set_x(element, 0);
+  set_y(element, 0);
+}
+
 // Sets dimensions for a root element
+// Each phase is a function of its own, so that layout_bench times the same phases
 void set_root_element_dimensions(Element *element, i32 window_width, i32 window_height) {
   if (element != 0) {
-    fill_max_width(element, window_width);
-    fill_max_height(element, window_height);
-    fill_scroll_width(element);
-    fill_scroll_height(element);
-    set_max_on_scrolled(element);
-    cap_scroll(element);
-    set_x(element, 0);
-    set_y(element, 0);
+    fill_max_dimensions(element, window_width, window_height);
+    layout_virtual_lists(element, window_width, window_height);
+    fill_scroll_dimensions(element);
+    set_positions(element);
   }
 }
 
@@ -486,6 +692,7 @@ void set_dimensions(ElementTree *tree) {
 }
 
 // Checks if a pointer position is within an element
+// The pointer position is relative to the parent of the element, like the element position
 bool is_pointer_in_element(Element *element, i32 x, i32 y) {
   i32 element_width = element->layout.max_width;
   i32 element_height = element->layout.max_height;
@@ -495,32 +702,84 @@ bool is_pointer_in_element(Element *element, i32 x, i32 y) {
          y <= element->layout.y + element_height;
 }
 
-// Get clickable element at a given position
+// Returns the child under a pointer position relative to the element, or 0 if there is none
+// Flex layout places children after each other, so their offsets along the layout direction are sorted and can be binary searched
+Element *get_child_at(Element *element, i32 x, i32 y) {
+  Array *children = element->children;
+  if (children == 0) return 0;
+  i32 number_of_children = array_length(children);
+  // Virtual list rows are stored in pool order, which is not sorted, but the pool is small
+  if (element->virtual_list != 0) {
+    for (i32 i = 0; i < number_of_children; i++) {
+      Element *child = array_get(children, i);
+      if (is_pointer_in_element(child, x, y)) {
+        return child;
+      }
+    }
+    return 0;
+  }
+  bool horizontal = element->layout_direction == layout_direction.horizontal;
+  i32 pointer = horizontal ? x : y;
+  // Find the last child that starts before the pointer
+  i32 low = 0;
+  i32 high = number_of_children - 1;
+  i32 found = -1;
+  while (low <= high) {
+    i32 mid = (low + high) / 2;
+    Element *child = array_get(children, mid);
+    i32 offset = horizontal ? child->layout.x : child->layout.y;
+    if (offset <= pointer) {
+      found = mid;
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  // Edges are inclusive, so children that end at the pointer can also contain it
+  // Step back over them and return the first match, like a linear search would
+  Element *match = 0;
+  for (i32 i = found; i >= 0; i--) {
+    Element *child = array_get(children, i);
+    i32 end = horizontal ? child->layout.x + child->layout.max_width : child->layout.y + child->layout.max_height;
+    if (end < pointer) break;
+    if (is_pointer_in_element(child, x, y)) {
+      match = child;
+    }
+  }
+  return match;
+}
+
+// Get clickable element at a given position relative to the parent of the element
 Element *get_clickable_element_at(Element *element, i32 x, i32 y) {
   if (element->on_click != 0) {
     return element;
   }
   Array *children = element->children;
   if (children != 0) {
-    for (i32 i = 0; i < array_length(children); i++) {
-      Element *child = array_get(children, i);
-      if (is_pointer_in_element(child, x, y)) {
-        return get_clickable_element_at(child, x, y);
-      }
+    // Pointer position relative to the element, as seen by the scrolled children
+    i32 child_x = x - element->layout.x - element->layout.scroll_x;
+    i32 child_y = y - element->layout.y - element->layout.scroll_y;
+    Element *child = get_child_at(element, child_x, child_y);
+    if (child != 0) {
+      return get_clickable_element_at(child, child_x, child_y);
     }
   }
   return 0;
 };
 
 // Recursively scrolls the elements under the pointer starting with the children
+// Only the scroll offset is changed, as the children are positioned relative to the element
 i32 scroll_x(Element *element, i32 x, i32 y, i32 scroll_delta) {
   // Check if the pointer is within the element
   if (is_pointer_in_element(element, x, y)) {
     Array *children = element->children;
     if (children != 0) {
-      for (i32 i = 0; i < array_length(children); i++) {
-        Element *child = array_get(children, i);
-        scroll_delta = scroll_x(child, x, y, scroll_delta);
+      i32 child_x = x - element->layout.x - element->layout.scroll_x;
+      i32 child_y = y - element->layout.y - element->layout.scroll_y;
+      // Only the child under the pointer can be scrolled
+      Element *child = get_child_at(element, child_x, child_y);
+      if (child != 0) {
+        scroll_delta = scroll_x(child, child_x, child_y, scroll_delta);
       }
     }
     // Check if the element is scrollable
@@ -557,19 +816,57 @@ i32 scroll_x(Element *element, i32 x, i32 y, i32 scroll_delta) {
   return scroll_delta;
 }
 
+// Scrolls a virtual list and lays out the rows that scrolled into view. Returns the remaining scroll delta.
+i32 scroll_virtual_list(Element *element, i32 scroll_delta) {
+  VirtualList *list = element->virtual_list;
+  i64 old_offset = list->scroll_offset;
+  list->scroll_offset -= scroll_delta;
+  cap_virtual_list_scroll(element);
+  i32 scrolled = old_offset - list->scroll_offset;
+  if (scrolled == 0) return scroll_delta;
+
+  // Only rows that were recycled need a new layout
+  if (materialize_virtual_list(element)) {
+    i32 row_x = element->padding.left;
+    fill_virtual_rows_max(element);
+    for (i32 i = 0; i < list->pool_size; i++) {
+      Element *row = array_get(element->children, i);
+      if (row->changed) {
+        fill_scroll_width(row);
+        fill_scroll_height(row);
+        set_max_on_scrolled(row);
+        set_x(row, row_x);
+      }
+    }
+  }
+  set_y(element, element->layout.y);
+  element->changed = true;
+  return scroll_delta - scrolled;
+}
+
 // Recursively scrolls the elements under the pointer starting with the children
+// Only the scroll offset is changed, as the children are positioned relative to the element
 i32 scroll_y(Element *element, i32 x, i32 y, i32 scroll_delta) {
   // Check if the pointer is within the element
   if (is_pointer_in_element(element, x, y)) {
     Array *children = element->children;
     if (children != 0) {
-      for (i32 i = 0; i < array_length(children); i++) {
-        Element *child = array_get(children, i);
-        scroll_delta = scroll_y(child, x, y, scroll_delta);
+      i32 child_x = x - element->layout.x - element->layout.scroll_x;
+      i32 child_y = y - element->layout.y - element->layout.scroll_y;
+      // Only the child under the pointer can be scrolled
+      Element *child = get_child_at(element, child_x, child_y);
+      if (child != 0) {
+        scroll_delta = scroll_y(child, child_x, child_y, scroll_delta);
+      }
+    }
+    // Virtual lists keep their own scroll offset
+    if (element->virtual_list != 0) {
+      if (scroll_delta != 0) {
+        scroll_delta = scroll_virtual_list(element, scroll_delta);
       }
     }
     // Check if the element is scrollable
-    if ((element->overflow == overflow_type.scroll ||
+    else if ((element->overflow == overflow_type.scroll ||
          element->overflow == overflow_type.scroll_y) &&
         element->layout.scroll_height > element->layout.max_height) {
       i32 max_scroll_y = element->layout.max_height - element->layout.scroll_height;
@@ -0,0 +1,267 @@
+#ifndef C9_PIXEL_SPAN
+
+#if defined(__AVX2__)
+#include <immintrin.h> // __m256i, _mm256_set1_epi32, _mm256_storeu_si256, _mm256_mullo_epi16
+#elif defined(__SSE2__)
+#include <emmintrin.h> // __m128i, _mm_set1_epi32, _mm_storeu_si128, _mm_mullo_epi16
+#elif defined(__ARM_NEON)
+#include <arm_neon.h> // uint8x8x4_t, vld4_u8, vst4_u8, vmull_u8, vdupq_n_u32
+#endif
+#include <string.h> // memcpy, memmove
+#include "color.c" // RGBA, blend_alpha, blend_colors
+#include "types.c" // i32, u8, u16, u32, u64
+
+/*
+
+Pixel spans are runs of pixels in one row of a target. The kernels fill, copy, blend and composite a span at a time, so that the drawing code clips a shape once and then hands whole rows to a kernel instead of checking and writing one pixel at a time.
+
+The kernels work on 8 pixels at a time with AVX2 and 4 at a time with SSE2. With NEON, fill_span writes 4 pixels at a time and the blending kernels split 8 pixels into their channels with vld4_u8. The rest of a span, and targets without any of them, use the scalar functions of color.c. The vector kernels divide by 255 with (v + 1 + (v >> 8)) >> 8, which is exact for the products of two bytes, so every kernel gives the same pixels as blend_alpha and blend_colors.
+
+*/
+
+// Writes a color to count pixels
+void fill_span(RGBA *span, i32 count, RGBA color) {
+  i32 x = 0;
+#if defined(__AVX2__)
+  __m256i colors = _mm256_set1_epi32((int)color);
+  for (; x + 8 <= count; x += 8) {
+    _mm256_storeu_si256((__m256i *)(span + x), colors);
+  }
+#elif defined(__SSE2__)
+  __m128i colors = _mm_set1_epi32((int)color);
+  for (; x + 4 <= count; x += 4) {
+    _mm_storeu_si128((__m128i *)(span + x), colors);
+  }
+#elif defined(__ARM_NEON)
+  uint32x4_t colors = vdupq_n_u32(color);
+  for (; x + 4 <= count; x += 4) {
+    vst1q_u32(span + x, colors);
+  }
+#endif
+  for (; x < count; x++) {
+    span[x] = color;
+  }
+}
+
+// Copies count pixels, the spans may overlap
+void copy_span(RGBA *target, RGBA *source, i32 count) {
+  // memmove is already vectorized by the C library
+  if (count > 0) {
+    memmove(target, source, count * sizeof(RGBA));
+  }
+}
+
+#if defined(__AVX2__)
+// Divides 16 bit products of two bytes by 255
+static inline __m256i div255_avx2(__m256i values) {
+  values = _mm256_add_epi16(values, _mm256_set1_epi16(1));
+  values = _mm256_add_epi16(values, _mm256_srli_epi16(values, 8));
+  return _mm256_srli_epi16(values, 8);
+}
+
+// Blends the channels of 4 pixels widened to 16 bits: (alpha * top + (255 - alpha) * bottom) / 255
+static inline __m256i blend_channels_avx2(__m256i top, __m256i bottom, __m256i alphas) {
+  __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alphas);
+  return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(top, alphas), _mm256_mullo_epi16(bottom, inverse)));
+}
+
+// Spreads the low byte of each pixel to all four of its bytes
+static inline __m256i spread_bytes_avx2(__m256i values) {
+  values = _mm256_or_si256(values, _mm256_slli_epi32(values, 8));
+  return _mm256_or_si256(values, _mm256_slli_epi32(values, 16));
+}
+#elif defined(__SSE2__)
+// Divides 16 bit products of two bytes by 255
+static inline __m128i div255_sse2(__m128i values) {
+  values = _mm_add_epi16(values, _mm_set1_epi16(1));
+  values = _mm_add_epi16(values, _mm_srli_epi16(values, 8));
+  return _mm_srli_epi16(values, 8);
+}
+
+// Blends the channels of 2 pixels widened to 16 bits: (alpha * top + (255 - alpha) * bottom) / 255
+static inline __m128i blend_channels_sse2(__m128i top, __m128i bottom, __m128i alphas) {
+  __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alphas);
+  return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(top, alphas), _mm_mullo_epi16(bottom, inverse)));
+}
+
+// Spreads the low byte of each pixel to all four of its bytes
+static inline __m128i spread_bytes_sse2(__m128i values) {
+  values = _mm_or_si128(values, _mm_slli_epi32(values, 8));
+  return _mm_or_si128(values, _mm_slli_epi32(values, 16));
+}
+
+// Picks a where the mask is set and b elsewhere
+static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#elif defined(__ARM_NEON)
+// Divides 16 bit products of two bytes by 255 and narrows them to bytes
+static inline uint8x8_t div255_neon(uint16x8_t values) {
+  values = vaddq_u16(values, vdupq_n_u16(1));
+  values = vaddq_u16(values, vshrq_n_u16(values, 8));
+  return vshrn_n_u16(values, 8);
+}
+
+// Blends one channel of 8 pixels: (alpha * top + (255 - alpha) * bottom) / 255
+static inline uint8x8_t blend_channel_neon(uint8x8_t top, uint8x8_t bottom, uint8x8_t alphas) {
+  uint8x8_t inverse = vsub_u8(vdup_n_u8(255), alphas);
+  return div255_neon(vmlal_u8(vmull_u8(top, alphas), bottom, inverse));
+}
+#endif
+
+// Blends a color into count pixels with the coverage of each pixel in mask, like blend_alpha. Pixels with a coverage of 0 are left as they are.
+void blend_mask_span(RGBA *span, u8 *mask, i32 count, RGBA color) {
+  i32 x = 0;
+#if defined(__AVX2__)
+  __m256i zero = _mm256_setzero_si256();
+  __m256i alpha_mask = _mm256_set1_epi32(0xFF);
+  __m256i colors = _mm256_set1_epi32((int)color);
+  __m256i color_rgb = _mm256_set1_epi32((int)(color & 0xFFFFFF00));
+  __m256i color_channels = _mm256_unpacklo_epi8(colors, zero);
+  for (; x + 8 <= count; x += 8) {
+    u64 word;
+    memcpy(&word, mask + x, sizeof(word));
+    // Most of a text is space between glyphs
+    if (word == 0) continue;
+    __m256i pixels = _mm256_loadu_si256((__m256i *)(span + x));
+    __m256i coverage = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)(mask + x)));
+    __m256i alphas = spread_bytes_avx2(coverage);
+    __m256i low = blend_channels_avx2(color_channels, _mm256_unpacklo_epi8(pixels, zero), _mm256_unpacklo_epi8(alphas, zero));
+    __m256i high = blend_channels_avx2(color_channels, _mm256_unpackhi_epi8(pixels, zero), _mm256_unpackhi_epi8(alphas, zero));
+    __m256i blended = _mm256_or_si256(_mm256_packus_epi16(low, high), alpha_mask);
+    // Empty pixels get the color with the coverage as alpha, uncovered pixels are kept
+    __m256i empty = _mm256_cmpeq_epi32(pixels, zero);
+    blended = _mm256_blendv_epi8(blended, _mm256_or_si256(color_rgb, coverage), empty);
+    blended = _mm256_blendv_epi8(blended, pixels, _mm256_cmpeq_epi32(coverage, zero));
+    _mm256_storeu_si256((__m256i *)(span + x), blended);
+  }
+#elif defined(__SSE2__)
+  __m128i zero = _mm_setzero_si128();
+  __m128i alpha_mask = _mm_set1_epi32(0xFF);
+  __m128i colors = _mm_set1_epi32((int)color);
+  __m128i color_rgb = _mm_set1_epi32((int)(color & 0xFFFFFF00));
+  __m128i color_channels = _mm_unpacklo_epi8(colors, zero);
+  for (; x + 4 <= count; x += 4) {
+    u32 word;
+    memcpy(&word, mask + x, sizeof(word));
+    // Most of a text is space between glyphs
+    if (word == 0) continue;
+    __m128i pixels = _mm_loadu_si128((__m128i *)(span + x));
+    __m128i coverage = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)word), zero), zero);
+    __m128i alphas = spread_bytes_sse2(coverage);
+    __m128i low = blend_channels_sse2(color_channels, _mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(alphas, zero));
+    __m128i high = blend_channels_sse2(color_channels, _mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(alphas, zero));
+    __m128i blended = _mm_or_si128(_mm_packus_epi16(low, high), alpha_mask);
+    // Empty pixels get the color with the coverage as alpha, uncovered pixels are kept
+    blended = select_sse2(_mm_cmpeq_epi32(pixels, zero), _mm_or_si128(color_rgb, coverage), blended);
+    blended = select_sse2(_mm_cmpeq_epi32(coverage, zero), pixels, blended);
+    _mm_storeu_si128((__m128i *)(span + x), blended);
+  }
+#elif defined(__ARM_NEON)
+  // Pixels are 0xRRGGBBAA words, so the bytes in memory are alpha, blue, green and red
+  uint8x8_t color_blue = vdup_n_u8(blue(color));
+  uint8x8_t color_green = vdup_n_u8(green(color));
+  uint8x8_t color_red = vdup_n_u8(red(color));
+  for (; x + 8 <= count; x += 8) {
+    uint8x8_t coverage = vld1_u8(mask + x);
+    // Most of a text is space between glyphs
+    if (vget_lane_u64(vreinterpret_u64_u8(coverage), 0) == 0) continue;
+    uint8x8x4_t pixels = vld4_u8((u8 *)(span + x));
+    uint8x8x4_t blended;
+    blended.val[0] = vdup_n_u8(255);
+    blended.val[1] = blend_channel_neon(color_blue, pixels.val[1], coverage);
+    blended.val[2] = blend_channel_neon(color_green, pixels.val[2], coverage);
+    blended.val[3] = blend_channel_neon(color_red, pixels.val[3], coverage);
+    // Empty pixels get the color with the coverage as alpha, uncovered pixels are kept
+    uint8x8_t empty = vceq_u8(vorr_u8(vorr_u8(pixels.val[0], pixels.val[1]), vorr_u8(pixels.val[2], pixels.val[3])), vdup_n_u8(0));
+    uint8x8_t uncovered = vceq_u8(coverage, vdup_n_u8(0));
+    blended.val[0] = vbsl_u8(empty, coverage, blended.val[0]);
+    blended.val[1] = vbsl_u8(empty, color_blue, blended.val[1]);
+    blended.val[2] = vbsl_u8(empty, color_green, blended.val[2]);
+    blended.val[3] = vbsl_u8(empty, color_red, blended.val[3]);
+    for (i32 channel = 0; channel < 4; channel++) {
+      blended.val[channel] = vbsl_u8(uncovered, pixels.val[channel], blended.val[channel]);
+    }
+    vst4_u8((u8 *)(span + x), blended);
+  }
+#endif
+  for (; x < count; x++) {
+    if (mask[x] > 0) {
+      span[x] = blend_alpha(span[x], color, mask[x]);
+    }
+  }
+}
+
+// Composites count source pixels over the target pixels, like blend_colors(source, target)
+void composite_span(RGBA *target, RGBA *source, i32 count) {
+  i32 x = 0;
+#if defined(__AVX2__)
+  __m256i zero = _mm256_setzero_si256();
+  __m256i alpha_mask = _mm256_set1_epi32(0xFF);
+  for (; x + 8 <= count; x += 8) {
+    __m256i tops = _mm256_loadu_si256((__m256i *)(source + x));
+    __m256i bottoms = _mm256_loadu_si256((__m256i *)(target + x));
+    __m256i top_alphas = _mm256_and_si256(tops, alpha_mask);
+    __m256i bottom_alphas = _mm256_and_si256(bottoms, alpha_mask);
+    __m256i alphas = spread_bytes_avx2(top_alphas);
+    __m256i low = blend_channels_avx2(_mm256_unpacklo_epi8(tops, zero), _mm256_unpacklo_epi8(bottoms, zero), _mm256_unpacklo_epi8(alphas, zero));
+    __m256i high = blend_channels_avx2(_mm256_unpackhi_epi8(tops, zero), _mm256_unpackhi_epi8(bottoms, zero), _mm256_unpackhi_epi8(alphas, zero));
+    __m256i colors = _mm256_andnot_si256(alpha_mask, _mm256_packus_epi16(low, high));
+    // The alpha is top + (255 - top) * bottom / 255
+    __m256i inverse = _mm256_sub_epi32(alpha_mask, top_alphas);
+    __m256i result_alphas = _mm256_add_epi32(top_alphas, div255_avx2(_mm256_mullo_epi16(inverse, bottom_alphas)));
+    __m256i blended = _mm256_or_si256(colors, result_alphas);
+    // A transparent top keeps the bottom and a transparent bottom takes the top
+    blended = _mm256_blendv_epi8(blended, tops, _mm256_cmpeq_epi32(bottom_alphas, zero));
+    blended = _mm256_blendv_epi8(blended, bottoms, _mm256_cmpeq_epi32(top_alphas, zero));
+    _mm256_storeu_si256((__m256i *)(target + x), blended);
+  }
+#elif defined(__SSE2__)
+  __m128i zero = _mm_setzero_si128();
+  __m128i alpha_mask = _mm_set1_epi32(0xFF);
+  for (; x + 4 <= count; x += 4) {
+    __m128i tops = _mm_loadu_si128((__m128i *)(source + x));
+    __m128i bottoms = _mm_loadu_si128((__m128i *)(target + x));
+    __m128i top_alphas = _mm_and_si128(tops, alpha_mask);
+    __m128i bottom_alphas = _mm_and_si128(bottoms, alpha_mask);
+    __m128i alphas = spread_bytes_sse2(top_alphas);
+    __m128i low = blend_channels_sse2(_mm_unpacklo_epi8(tops, zero), _mm_unpacklo_epi8(bottoms, zero), _mm_unpacklo_epi8(alphas, zero));
+    __m128i high = blend_channels_sse2(_mm_unpackhi_epi8(tops, zero), _mm_unpackhi_epi8(bottoms, zero), _mm_unpackhi_epi8(alphas, zero));
+    __m128i colors = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(low, high));
+    // The alpha is top + (255 - top) * bottom / 255
+    __m128i inverse = _mm_sub_epi32(alpha_mask, top_alphas);
+    __m128i result_alphas = _mm_add_epi32(top_alphas, div255_sse2(_mm_mullo_epi16(inverse, bottom_alphas)));
+    __m128i blended = _mm_or_si128(colors, result_alphas);
+    // A transparent top keeps the bottom and a transparent bottom takes the top
+    blended = select_sse2(_mm_cmpeq_epi32(bottom_alphas, zero), tops, blended);
+    blended = select_sse2(_mm_cmpeq_epi32(top_alphas, zero), bottoms, blended);
+    _mm_storeu_si128((__m128i *)(target + x), blended);
+  }
+#elif defined(__ARM_NEON)
+  for (; x + 8 <= count; x += 8) {
+    uint8x8x4_t tops = vld4_u8((u8 *)(source + x));
+    uint8x8x4_t bottoms = vld4_u8((u8 *)(target + x));
+    uint8x8_t alphas = tops.val[0];
+    uint8x8x4_t blended;
+    // The alpha is top + (255 - top) * bottom / 255
+    blended.val[0] = vadd_u8(alphas, div255_neon(vmull_u8(vsub_u8(vdup_n_u8(255), alphas), bottoms.val[0])));
+    blended.val[1] = blend_channel_neon(tops.val[1], bottoms.val[1], alphas);
+    blended.val[2] = blend_channel_neon(tops.val[2], bottoms.val[2], alphas);
+    blended.val[3] = blend_channel_neon(tops.val[3], bottoms.val[3], alphas);
+    // A transparent top keeps the bottom and a transparent bottom takes the top
+    uint8x8_t top_empty = vceq_u8(alphas, vdup_n_u8(0));
+    uint8x8_t bottom_empty = vceq_u8(bottoms.val[0], vdup_n_u8(0));
+    for (i32 channel = 0; channel < 4; channel++) {
+      blended.val[channel] = vbsl_u8(bottom_empty, tops.val[channel], blended.val[channel]);
+      blended.val[channel] = vbsl_u8(top_empty, bottoms.val[channel], blended.val[channel]);
+    }
+    vst4_u8((u8 *)(target + x), blended);
+  }
+#endif
+  for (; x < count; x++) {
+    target[x] = blend_colors(source[x], target[x]);
+  }
+}
+
+#define C9_PIXEL_SPAN
+#endif
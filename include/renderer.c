@@ -5,15 +5,68 @@
 #include "array.c" // array_get
 #include "draw_shapes.c" // draw_filled_rectangle, draw_horizontal_gradient_rectangle, draw_vertical_gradient_rectangle, draw_rectangle_with_border, draw_rectangle, has_border
 #include "element_tree.c" // Element, ElementTree
-#include "font.c" // get_sft
-#include "font_layout.c" // get_text_line_height
-#include "input.c" // InputData
+#include "font.c" // get_font_height
+#include "font_layout.c" // get_text_line_height, get_line_prefix_width
+#include "glyph_atlas.c" // glyph_atlas, draw_atlas_text, draw_atlas_multiline_text
+#include "input.c" // InputData, get_input_line, find_input_line
 #include "input_actions.c" // measure_selection
-#include "schrift.c" // SFT, SFT_text_width
+#include "pixel_span.c" // fill_span
+#include "text_raster.c" // draw_cached_text
+#include "virtual_list.c" // get_virtual_list_height, get_virtual_list_viewport
 #include "types.c" // i32
+#include "types_common.c" // Position
+
+// Returns the position of the element text relative to the element, with its scroll and alignment
+static SDL_Rect get_text_position(Element *element) {
+  SDL_Rect text_position = {
+    .x = element->padding.left + element->layout.scroll_x,
+    .y = element->padding.top + element->layout.scroll_y,
+    .w = element->layout.scroll_width - element->padding.left - element->padding.right,
+    .h = element->layout.scroll_height - element->padding.top - element->padding.bottom,
+  };
+  // Apply text alignment
+  if (element->text_align != text_align.start) {
+    i32 extra_space = element->layout.max_width - element->layout.scroll_width;
+    if (extra_space > 0 && element->text_align == text_align.center) {
+      text_position.x += extra_space / 2;
+    } else if (extra_space > 0 && element->text_align == text_align.end) {
+      text_position.x += extra_space;
+    }
+  }
+  return text_position;
+}
+
+// Elements that only hold text are drawn from the glyph atlas while it is enabled and their text changes, so a label that
+// changes every frame is not rasterized and uploaded every frame. Once it stops changing, the text is rasterized into the
+// texture of the element, which is then copied like the texture of any other element.
+static bool is_atlas_text_element(Element *element) {
+  return glyph_atlas.texture != 0 && element->changed && element->text.data != 0 && element->input == 0 &&
+         element->background_type == background_type.none && !has_border(element->border);
+}
+
+// Draws the text of an element from the glyph atlas straight into the target, clipped to the element without its side padding
+static void draw_atlas_element(SDL_Renderer *renderer, Element *element, SDL_Rect element_rect, SDL_Rect target_rect) {
+  SDL_Rect text_position = get_text_position(element);
+  text_position.x += element_rect.x;
+  text_position.y += element_rect.y;
+  SDL_Rect text_rect = {
+    .x = element_rect.x + element->padding.left,
+    .y = element_rect.y,
+    .w = element_rect.w - element->padding.left - element->padding.right,
+    .h = element_rect.h,
+  };
+  SDL_Rect clip;
+  if (!SDL_IntersectRect(&text_rect, &target_rect, &clip)) return;
+  if (element->overflow == overflow_type.scroll || element->overflow == overflow_type.scroll_x) {
+    draw_atlas_text(renderer, element->font_variant, element->text, element->text_color, text_position, clip);
+  } else {
+    draw_atlas_multiline_text(renderer, element->font_variant, element->text, element->text_color, text_position, clip);
+  }
+}
 
 // Recursively draws all elements
-void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rect, Element *active_element, SDL_Rect window_rect) {
+// The origin is the absolute position of the parent including its scroll, which the element position is relative to
+void draw_elements(SDL_Renderer *renderer, Element *element, Position origin, SDL_Rect target_rect, Element *active_element, SDL_Rect window_rect) {
   // Rectangle that covers the entire element texture
   SDL_Rect element_texture_rect = {
     .x = 0,
@@ -24,11 +77,14 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
 
   // Rectangle that represents the true uncut position of an element
   SDL_Rect element_rect = {
-    .x = element->layout.x,
-    .y = element->layout.y,
+    .x = origin.x + element->layout.x,
+    .y = origin.y + element->layout.y,
     .w = element->layout.max_width,
     .h = element->layout.max_height,
   };
+  // Save the absolute position for pointer events
+  element->render.x = element_rect.x;
+  element->render.y = element_rect.y;
 
   // Skip elements outside of the window
   if (element_rect.x > window_rect.w || element_rect.y > window_rect.h ||
@@ -97,9 +153,16 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
     return;
   };
 
+  if (is_atlas_text_element(element)) {
+    // The texture is kept for when the text stops changing
+    draw_atlas_element(renderer, element, element_rect, target_texture_cutout_rect);
+    element->changed = false;
+    element->render.stale = true;
+  }
   // If the element has a cached texture and it hasn't changed we just copy it
-  if (element->render.texture != 0 &&
+  else if (element->render.texture != 0 &&
       element->changed == false &&
+      element->render.stale == false &&
       element->render.width == element_texture_rect.w &&
       element->render.height == element_texture_rect.h) {
     // Copy a portion of the element texture to the same location on the target texture
@@ -136,9 +199,7 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
 
     // Empty the element texture from any previous data
     for (i32 y = 0; y < element_texture_rect.h; y++) {
-      for (i32 x = 0; x < element_texture_rect.w; x++) {
-        locked_element.pixels[y * locked_element.width + x] = 0;
-      }
+      fill_span(locked_element.pixels + y * locked_element.width, element_texture_rect.w, 0);
     }
 
     if (element->background_type == background_type.color) {
@@ -167,33 +228,12 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
       draw_rectangle_with_border(locked_element, element_texture_rect, element->corner_radius, element->border, element->border_color, 0);
     }
     if (element->text.data != 0) {
-      SFT *font = get_sft(element->font_variant);
-      SDL_Rect text_position = {
-        .x = element->padding.left + element->layout.scroll_x,
-        .y = element->padding.top + element->layout.scroll_y,
-        .w = element->layout.scroll_width - element->padding.left - element->padding.right,
-        .h = element->layout.scroll_height - element->padding.top - element->padding.bottom,
-      };
-      // Apply text alignment
-      if (element->text_align != text_align.start) {
-        i32 extra_space = element->layout.max_width - element->layout.scroll_width;
-        if (extra_space > 0 && element->text_align == text_align.center) {
-          text_position.x += extra_space / 2;
-        } else if (extra_space > 0 && element->text_align == text_align.end) {
-          text_position.x += extra_space;
-        }
-      }
-      if (element->overflow == overflow_type.scroll || element->overflow == overflow_type.scroll_x) {
-        Arena *temp_arena = arena_open(sizeof(u8) * element->text.length + 1);
-        s8 trimmed_line = string_from_substring(temp_arena, element->text.data, 0, element->text.length);
-        draw_text(locked_element, font, trimmed_line.data, element->text_color, text_position, element->padding);
-        arena_close(temp_arena);
-      } else {
-        draw_multiline_text(locked_element, element->font_variant, element->text, element->text_color, text_position, element->padding);
-      }
+      SDL_Rect text_position = get_text_position(element);
+      // The coverage of the text is reused when only the background or text color has changed
+      bool multiline = element->overflow != overflow_type.scroll && element->overflow != overflow_type.scroll_x;
+      draw_cached_text(locked_element, element->font_variant, element->text, element->text_color, text_position, element->padding, multiline);
     } else if (element->input != 0 && element == active_element) {
       // If the element is the active element we should also draw the cursor
-      SFT *font = get_sft(element->font_variant);
       SDL_Rect text_position = {
         .x = element_texture_rect.x + element->padding.left + element->layout.scroll_x,
         .y = element_texture_rect.y + element->padding.top + element->layout.scroll_y,
@@ -203,7 +243,7 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
 
       // Text is scrolling horizontally
       if (element->overflow == overflow_type.scroll || element->overflow == overflow_type.scroll_x) {
-        SDL_Rect selection_rect = measure_selection(font, element->input);
+        SDL_Rect selection_rect = measure_selection(element->font_variant, element->input);
         SDL_Rect selection = {
           .x = text_position.x + selection_rect.x,
           .y = text_position.y + selection_rect.y,
@@ -240,7 +280,8 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
         i32 selection_end_index = get_end_value(element->input->selection);
         i32 line_height = get_text_line_height(element->font_variant);
         SDL_Rect selection = {0};
-        Array *indexes = element->input->lines;
+        InputData *input = element->input;
+        i32 line_count = array_length(input->lines);
         // No data in the input yet
         if (element->input->text.length == 0) {
           selection = (SDL_Rect){
@@ -251,45 +292,47 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
           };
           draw_filled_rectangle(locked_element, selection, 0, text_cursor_color);
         } else {
-          Arena *temp_arena = arena_open(512);
-          // Step over rows and draw a rectangle between selected indexes
+          // Step over the rows around the selection and draw a rectangle between selected indexes
+          i32 first_line_index = find_input_line(input, selection_start_index) - 1;
+          if (first_line_index < 0) {
+            first_line_index = 0;
+          }
           i32 last_line_end_index = 0;
-          for (i32 i = 0; i < array_length(indexes); i++) {
-            Line *line = array_get(indexes, i);
-            Line *next_line = array_get(indexes, i + 1);
+          if (first_line_index > 0) {
+            last_line_end_index = get_input_line(input, first_line_index - 1).end_index;
+          }
+          for (i32 i = first_line_index; i < line_count; i++) {
+            Line line = get_input_line(input, i);
+            // Rows after the selection end are not selected
+            if (last_line_end_index > selection_end_index) break;
             i32 next_line_start_index = 0;
-            if (next_line != 0) {
-              next_line_start_index = next_line->start_index;
+            if (i + 1 < line_count) {
+              next_line_start_index = get_input_line(input, i + 1).start_index;
             }
             bool draw_cursor = false;
 
             // If the selection has started before the end of the line and the line ends on or after the start index
-            if ((selection_start_index < line->end_index && selection_end_index >= line->start_index)) {
+            if ((selection_start_index < line.end_index && selection_end_index >= line.start_index)) {
               draw_cursor = true;
             }
             // If the selection starts on the end of the line and the next line does not start at the same index
-            else if (selection_start_index == line->end_index && selection_start_index != next_line_start_index) {
+            else if (selection_start_index == line.end_index && selection_start_index != next_line_start_index) {
               draw_cursor = true;
             }
             // If the selection starts between the end of the last line and the start of this line
             else if (
-              (selection_start_index > last_line_end_index && selection_start_index < line->start_index)
+              (selection_start_index > last_line_end_index && selection_start_index < line.start_index)
             ) {
               draw_cursor = true;
             }
 
             if (draw_cursor) {
-              Element *child_element = array_get(element->children, i);
-              if (child_element == 0) return;
               // Selection spans the entire line
-              if (selection_start_index <= line->start_index && selection_end_index >= line->end_index) {
-                s8 trimmed_line = string_from_substring(temp_arena, child_element->text.data, 0, child_element->text.length);
-                i32 text_width = 0;
-                SFT_text_width(font, trimmed_line.data, &text_width);
+              if (selection_start_index <= line.start_index && selection_end_index >= line.end_index) {
                 selection = (SDL_Rect){
                   .x = text_position.x,
                   .y = text_position.y + line_height * i,
-                  .w = text_width,
+                  .w = line.width,
                   .h = get_font_height(element->font_variant),
                 };
                 // Line is empty
@@ -300,29 +343,9 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
               }
               // Selection spans only part of the line
               else {
-                i32 relative_start = selection_start_index - line->start_index;
-                if (relative_start < 0) {
-                  relative_start = 0;
-                };
-                i32 relative_end = selection_end_index - line->start_index;
-                if (relative_end < 0) {
-                  relative_end = 0;
-                } else if (selection_end_index >= line->end_index) {
-                  relative_end = line->end_index - line->start_index;
-                };
-
-                // Meassure text from 0 to relative_start
-                i32 selection_start_width = 0;
-                if (relative_start > 0) {
-                  s8 selection_start = string_from_substring(temp_arena, child_element->text.data, 0, relative_start);
-                  SFT_text_width(font, selection_start.data, &selection_start_width);
-                }
-                // Measure text from 0 to relative_end
-                i32 selection_end_width = selection_start_width;
-                if (relative_end != relative_start) {
-                  s8 selection_end = string_from_substring(temp_arena, child_element->text.data, 0, relative_end);
-                  SFT_text_width(font, selection_end.data, &selection_end_width);
-                }
+                // Measure the line from its start to the selection start and end
+                i32 selection_start_width = get_line_prefix_width(element->font_variant, input, &line, selection_start_index);
+                i32 selection_end_width = get_line_prefix_width(element->font_variant, input, &line, selection_end_index);
                 selection = (SDL_Rect){
                   .x = text_position.x + selection_start_width,
                   .y = text_position.y + line_height * i,
@@ -340,9 +363,8 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
                 draw_filled_rectangle(locked_element, selection, 0, selection_color);
               }
             }
-            last_line_end_index = line->end_index;
+            last_line_end_index = line.end_index;
           }
-          arena_close(temp_arena);
         }
       }
     }
@@ -354,18 +376,48 @@ void draw_elements(SDL_Renderer *renderer, Element *element, SDL_Rect target_rec
     SDL_RenderCopy(renderer, element->render.texture, &element_texture_cutout_rect, &target_texture_cutout_rect);
     // Set the element as unchanged
     element->changed = false;
+    element->render.stale = false;
   }
 
   Array *children = element->children;
   if (children == 0) return;
 
+  // Children are positioned relative to the element and moved by its scroll
+  Position child_origin = {
+    .x = element_rect.x + element->layout.scroll_x,
+    .y = element_rect.y + element->layout.scroll_y,
+  };
   for (i32 i = 0; i < array_length(children); i++) {
     Element *child = array_get(children, i);
-    draw_elements(renderer, child, target_texture_cutout_rect, active_element, window_rect);
+    draw_elements(renderer, child, child_origin, target_texture_cutout_rect, active_element, window_rect);
   }
 
+  // Draw a scrollbar from the scroll offset of a virtual list
+  if (element->virtual_list != 0) {
+    i64 list_height = get_virtual_list_height(element);
+    i32 viewport = get_virtual_list_viewport(element);
+    if (viewport > 0 && viewport < list_height) {
+      f32 scroll_percentage = element->virtual_list->scroll_offset / (f32)(list_height - viewport);
+
+      i32 scrollbar_width = 4;
+      i32 scrollbar_x = element_rect.x + element_rect.w - scrollbar_width;
+      i32 scrollbar_height = element_rect.h * viewport / (f32)list_height;
+      if (scrollbar_height < scrollbar_width) {
+        scrollbar_height = scrollbar_width;
+      }
+      i32 scrollbar_y = element_rect.y + scroll_percentage * (element_rect.h - scrollbar_height);
+
+      SDL_Rect scrollbar_rect = {
+        .x = scrollbar_x,
+        .y = scrollbar_y,
+        .w = scrollbar_width,
+        .h = scrollbar_height,
+      };
+      renderer_fill_rectangle(renderer, scrollbar_rect, scrollbar_color);
+    }
+  }
   // Draw a scrollbar if the element has Y overflow
-  if ((element->overflow == overflow_type.scroll ||
+  else if ((element->overflow == overflow_type.scroll ||
        element->overflow == overflow_type.scroll_y) &&
       element->children != 0 &&
       element->input == 0 &&
@@ -417,10 +469,11 @@ void render_element_tree(SDL_Renderer *renderer, ElementTree *tree) {
   // Get the width and height of the target texture
   SDL_QueryTexture(tree->target_texture, NULL, NULL, &target_rectangle.w, &target_rectangle.h);
   // Draw the root element
-  draw_elements(renderer, tree->root, target_rectangle, tree->active_element, target_rectangle);
+  Position window_origin = {0, 0};
+  draw_elements(renderer, tree->root, window_origin, target_rectangle, tree->active_element, target_rectangle);
   if (tree->overlay != 0) {
     // Draw the overlay element
-    draw_elements(renderer, tree->overlay, target_rectangle, tree->active_element, target_rectangle);
+    draw_elements(renderer, tree->overlay, window_origin, target_rectangle, tree->active_element, target_rectangle);
   }
 }
 
@@ -11,6 +11,11 @@
 #include <stdio.h>
 #include <stdlib.h> // calloc, free
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h> // __m128, _mm_add_ps, _mm_cvttps_epi32, _mm_packus_epi16
+#elif defined(__ARM_NEON)
+#include <arm_neon.h> // float32x4_t, vaddq_f32, vcvtq_u32_f32, vqmovn_u16
+#endif
 #include <sys/mman.h> // mmap, munmap
 #include <sys/stat.h> // fstat
 #include <unistd.h> // close
@@ -23,6 +28,9 @@ typedef struct SFT_LMetrics SFT_LMetrics;
 typedef struct SFT_GMetrics SFT_GMetrics;
 typedef struct SFT_Kerning SFT_Kerning;
 typedef struct SFT_Image SFT_Image;
+typedef struct SFT_BakedGlyph SFT_BakedGlyph;
+typedef struct SFT_BakedSize SFT_BakedSize;
+typedef struct SFT_BakedFont SFT_BakedFont;
 
 struct SFT {
   SFT_Font *font;
@@ -58,7 +66,44 @@ struct SFT_Image {
   int height;
 };
 
+// A glyph bitmap rendered ahead of time (see baked_fonts.c), placed like the bitmaps of the glyph cache
+struct SFT_BakedGlyph {
+  int16_t left; // Pixels from the pen position to the left edge of the bitmap
+  int16_t top; // Pixels from the baseline to the top edge of the bitmap
+  uint16_t width;
+  uint16_t height;
+  uint32_t pixels; // Offset of the bitmap in the pixels of its size
+};
+
+struct SFT_BakedSize {
+  double xScale;
+  double yScale;
+  const uint32_t *glyphIndex; // Index plus one into glyphs for each glyph id times GLYPH_CACHE_SUBPIXELS plus subpixel, 0 if not baked
+  const SFT_BakedGlyph *glyphs;
+  const uint8_t *pixels;
+};
+
+// Lookup tables and glyph bitmaps of a font file that were built ahead of time and are used instead of building them at load time
+struct SFT_BakedFont {
+  uint_fast32_t fileSize; // Size of the font file the tables were built from
+  uint_least64_t fileHash; // Hash of the font file the tables were built from (see sft_font_hash)
+  uint_least16_t numGlyphs;
+  const uint16_t *commonGlyphs;
+  const uint16_t *advances;
+  const uint32_t *kernKeys;
+  const int16_t *kernValues;
+  uint_fast32_t kernMask;
+  int numSizes;
+  const SFT_BakedSize *sizes;
+};
+
 void sft_freefont(SFT_Font *font);
+SFT_Font *sft_loadfile_baked(char const *filename, const SFT_BakedFont *baked);
+uint_least64_t sft_font_hash(const SFT_Font *font);
+
+// Flags of SFT
+#define SFT_DOUBLE_CELLS 0x01 // Rasterize with double precision cells like libschrift instead of float cells
+#define SFT_NO_OUTLINE_CACHE 0x02 // Decode and flatten every outline again instead of using the outline cache of the font
 
 #define FILE_MAGIC_ONE 0x00010000
 #define FILE_MAGIC_TWO 0x74727565
@@ -104,6 +149,11 @@ typedef struct SFT_Curve SFT_Curve;
 typedef struct SFT_Cell SFT_Cell;
 typedef struct SFT_Outline SFT_Outline;
 typedef struct SFT_Raster SFT_Raster;
+typedef struct SFT_FloatRaster SFT_FloatRaster;
+typedef struct SFT_Scratch SFT_Scratch;
+typedef struct SFT_FlatOutline SFT_FlatOutline;
+typedef struct SFT_CachedOutline SFT_CachedOutline;
+typedef struct SFT_LatinGlyph SFT_LatinGlyph;
 
 struct SFT_Point {
   double x, y;
@@ -136,6 +186,57 @@ struct SFT_Raster {
   int height;
 };
 
+// Float cells are stored as two planes, so that post_process can load four areas and four covers at once
+struct SFT_FloatRaster {
+  float *areas;
+  float *covers;
+  int width;
+  int height;
+};
+
+// Number of pixel sizes that the flattened lines of an outline are cached for
+#define OUTLINE_CACHE_SIZES 4
+// Bytes that the cached outlines of a font can hold with their flattened lines, before the least recently used are freed
+#define OUTLINE_CACHE_CAPACITY (2 * 1024 * 1024)
+
+// Outline with its curves flattened into lines for one pixel size, in font units
+struct SFT_FlatOutline {
+  int size; // Pixel size the lines are flat enough for, 0 if the slot is unused
+  SFT_Point *points;
+  SFT_Line *lines;
+  uint_least16_t numPoints;
+  uint_least16_t numLines;
+};
+
+// Decoded outline of a glyph in font units, with the flattened lines of the most recently used pixel sizes first
+struct SFT_CachedOutline {
+  SFT_Glyph glyph;
+  size_t size; // Bytes of the outline and its flattened lines
+  SFT_CachedOutline *lruPrev; // Towards the most recently used outline
+  SFT_CachedOutline *lruNext; // Towards the least recently used outline
+  SFT_Point *points;
+  SFT_Curve *curves;
+  SFT_Line *lines;
+  uint_least16_t numPoints;
+  uint_least16_t numCurves;
+  uint_least16_t numLines;
+  SFT_FlatOutline flat[OUTLINE_CACHE_SIZES];
+};
+
+// Scratch memory that is reused by every glyph instead of being allocated per glyph. Every thread has its own scratch,
+// which the thread frees with sft_scratch_free before it exits.
+struct SFT_Scratch {
+  SFT_Outline outline; // Counts are reset for every glyph, the arrays only grow
+  float *cells; // Area plane followed by the cover plane
+  size_t capCells; // Number of pixels the cells have room for
+};
+
+// Glyph id and advance width of a Latin-1 code point, so that shaping ASCII and Latin-1 text is one table load per character
+struct SFT_LatinGlyph {
+  uint_least16_t glyph;
+  uint_least16_t advance;
+};
+
 struct SFT_Font {
   const uint8_t *memory;
   uint_fast32_t size;
@@ -143,6 +244,19 @@ struct SFT_Font {
   uint_least16_t unitsPerEm;
   int_least16_t locaFormat;
   uint_least16_t numLongHmtx;
+  uint_least16_t numGlyphs;
+  // Lookup tables built at load time, so that measuring text does not parse the font tables
+  uint_least16_t *commonGlyphs; // Glyph id of each code point in the common ranges (see common_glyph_index)
+  uint_least16_t *advances; // Advance width of each glyph in font units
+  uint_least32_t *kernKeys; // Hashed kerning pairs as left glyph << 16 | right glyph, 0 marks an empty slot
+  int_least16_t *kernValues; // Horizontal kerning of each pair in font units
+  uint_fast32_t kernMask; // Number of kerning slots minus one, or 0 if the font has no kerning
+  SFT_LatinGlyph latin[256]; // Glyph id and advance width of each code point below 256
+  SFT_CachedOutline **outlines; // Cached outline of each glyph id, allocated when the first glyph is rendered
+  SFT_CachedOutline *outlineHead; // Most recently used cached outline
+  SFT_CachedOutline *outlineTail; // Least recently used cached outline, freed first
+  size_t outlineSize; // Bytes held by the cached outlines, at most OUTLINE_CACHE_CAPACITY
+  const SFT_BakedFont *baked; // Baked tables and bitmaps, or NULL if the tables were built from the font file
 };
 
 // function declarations
@@ -182,6 +296,14 @@ static int glyph_id(SFT_Font *font, SFT_UChar charCode, uint_fast32_t *glyph);
 // glyph metrics lookup
 static int hor_metrics(SFT_Font *font, uint_fast32_t glyph, int *advanceWidth, int *leftSideBearing);
 static int glyph_bbox(const SFT *sft, uint_fast32_t outline, int box[4]);
+// lookup tables built at load time
+static int init_lookup_tables(SFT_Font *font);
+static void free_lookup_tables(SFT_Font *font);
+static inline int lookup_glyph(SFT_Font *font, SFT_UChar charCode, SFT_Glyph *glyph);
+static inline int lookup_advance(SFT_Font *font, SFT_Glyph glyph);
+static inline int lookup_kerning(SFT_Font *font, SFT_Glyph leftGlyph, SFT_Glyph rightGlyph);
+static void init_latin_table(SFT_Font *font);
+static inline int ascii_run_end(const uint8_t *text, int i, int length);
 // decoding outlines
 static int outline_offset(SFT_Font *font, uint_fast32_t glyph, uint_fast32_t *offset);
 static int simple_flags(SFT_Font *font, uint_fast32_t *offset, uint_fast16_t numPts, uint8_t *flags);
@@ -191,16 +313,27 @@ static int simple_outline(SFT_Font *font, uint_fast32_t offset, unsigned int num
 static int compound_outline(SFT_Font *font, uint_fast32_t offset, int recDepth, SFT_Outline *outl);
 static int decode_outline(SFT_Font *font, uint_fast32_t offset, int recDepth, SFT_Outline *outl);
 // tesselation
-static int is_flat(SFT_Outline *outl, SFT_Curve curve);
-static int tesselate_curve(SFT_Curve curve, SFT_Outline *outl);
-static int tesselate_curves(SFT_Outline *outl);
+static int is_flat(SFT_Outline *outl, SFT_Curve curve, double maxArea2);
+static int tesselate_curve(SFT_Curve curve, SFT_Outline *outl, double maxArea2);
+static int tesselate_curves(SFT_Outline *outl, double maxArea2);
+// outline cache
+static int load_outline(const SFT *sft, SFT_Glyph glyph, uint_fast32_t offset, SFT_Outline *outl);
+static void free_outline_cache(SFT_Font *font);
 // silhouette rasterization
 static void draw_line(SFT_Raster buf, SFT_Point origin, SFT_Point goal);
 static void draw_lines(SFT_Outline *outl, SFT_Raster buf);
+static void draw_line_float(SFT_FloatRaster buf, SFT_Point origin, SFT_Point goal);
+static void draw_lines_float(SFT_Outline *outl, SFT_FloatRaster buf);
 // post-processing
 static void post_process(SFT_Raster buf, uint8_t *image);
+static void post_process_float(SFT_FloatRaster buf, uint8_t *image);
 // glyph rendering
 static int render_outline(SFT_Outline *outl, double transform[6], SFT_Image image);
+static int render_outline_float(SFT_Outline *outl, double transform[6], SFT_Image image);
+// glyph cache
+static void glyph_cache_purge_font(const SFT_Font *font);
+
+_Thread_local SFT_Scratch sft_scratch = {0};
 
 // function implementations
 
@@ -225,10 +358,18 @@ SFT_Font *sft_loadmem(const void *mem, size_t size) {
 
 // Loads a font from the file system. To do so, it has to map the entire font into memory.
 SFT_Font *sft_loadfile(char const *filename) {
+  return sft_loadfile_baked(filename, NULL);
+}
+
+// Loads a font from the file system and uses the baked tables and bitmaps if they were built from a file with the same
+// contents (the same size, glyph count and hash).
+// Glyphs that are not baked are rendered from the font file. The baked data has to stay valid until the font is freed.
+SFT_Font *sft_loadfile_baked(char const *filename, const SFT_BakedFont *baked) {
   SFT_Font *font;
   if (!(font = calloc(1, sizeof *font))) {
     return NULL;
   }
+  font->baked = baked;
   if (map_file(font, filename) < 0) {
     printf("Failed to map file\n");
     free(font);
@@ -242,8 +383,27 @@ SFT_Font *sft_loadfile(char const *filename) {
   return font;
 }
 
+// Returns the FNV-1a hash of the font file, 8 bytes at a time, which tells baked data of another build of a font apart
+uint_least64_t sft_font_hash(const SFT_Font *font) {
+  uint_least64_t hash = 14695981039346656037ULL;
+  uint_fast32_t i = 0;
+  for (; i + 8 <= font->size; i += 8) {
+    uint_least64_t word;
+    memcpy(&word, font->memory + i, sizeof word);
+    hash = (hash ^ word) * 1099511628211ULL;
+    hash ^= hash >> 32;
+  }
+  for (; i < font->size; i++) {
+    hash = (hash ^ font->memory[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
 void sft_freefont(SFT_Font *font) {
   if (!font) return;
+  glyph_cache_purge_font(font);
+  free_lookup_tables(font);
+  free_outline_cache(font);
   // Only unmap if we mapped it ourselves.
   if (font->source == SrcMapping)
     unmap_file(font);
@@ -352,11 +512,12 @@ int sft_kerning(const SFT *sft, SFT_Glyph leftGlyph, SFT_Glyph rightGlyph, SFT_K
   return 0;
 }
 
+// Renders a glyph into the image. The outline and the cells are scratch memory of the calling thread, but the outline
+// cache belongs to the font, so threads that render glyphs of the same font at the same time set SFT_NO_OUTLINE_CACHE.
 int sft_render(const SFT *sft, SFT_Glyph glyph, SFT_Image image) {
   uint_fast32_t outline;
   double transform[6];
   int bbox[4];
-  SFT_Outline outl;
 
   if (outline_offset(sft->font, glyph, &outline) < 0) return -1;
   if (!outline) return 0;
@@ -371,21 +532,32 @@ int sft_render(const SFT *sft, SFT_Glyph glyph, SFT_Image image) {
   transform[3] = -sft->yScale / sft->font->unitsPerEm;
   transform[5] = bbox[3] - sft->yOffset;
 
-  memset(&outl, 0, sizeof outl);
-  if (init_outline(&outl) < 0) {
-    free_outline(&outl);
+  // The outline arrays are kept between glyphs, so only glyphs larger than all before them allocate
+  SFT_Outline *outl = &sft_scratch.outline;
+  if (!outl->capPoints && init_outline(outl) < 0) {
+    free_outline(outl);
+    memset(outl, 0, sizeof *outl);
     return -1;
   }
-  if (decode_outline(sft->font, outline, 0, &outl) < 0) {
-    free_outline(&outl);
+  outl->numPoints = 0;
+  outl->numCurves = 0;
+  outl->numLines = 0;
+  if (sft->flags & SFT_NO_OUTLINE_CACHE) {
+    if (decode_outline(sft->font, outline, 0, outl) < 0) return -1;
+  } else if (load_outline(sft, glyph, outline, outl) < 0) {
     return -1;
   }
-  if (render_outline(&outl, transform, image) < 0) {
-    free_outline(&outl);
-    return -1;
+  if (sft->flags & SFT_DOUBLE_CELLS) {
+    return render_outline(outl, transform, image);
   }
-  free_outline(&outl);
-  return 0;
+  return render_outline_float(outl, transform, image);
+}
+
+// Frees the scratch memory of the rasterizer on the calling thread. It is allocated again by the next glyph that the thread renders.
+void sft_scratch_free(void) {
+  free_outline(&sft_scratch.outline);
+  free(sft_scratch.cells);
+  memset(&sft_scratch, 0, sizeof sft_scratch);
 }
 
 // This is sqrt(SIZE_MAX+1), as s1*s2 <= SIZE_MAX
@@ -457,7 +629,7 @@ static int init_font(SFT_Font *font) {
   if (!is_safe_offset(font, hhea, 36)) return -1;
   font->numLongHmtx = getu16(font, hhea + 34);
 
-  return 0;
+  return init_lookup_tables(font);
 }
 
 static SFT_Point midpoint(SFT_Point a, SFT_Point b) {
@@ -807,6 +979,183 @@ static int hor_metrics(SFT_Font *font, SFT_Glyph glyph, int *advanceWidth, int *
   }
 }
 
+// Code points in the common ranges are looked up in a dense table instead of the cmap.
+// The ranges are Basic Latin to Spacing Modifier Letters (U+0000 to U+02FF) and General Punctuation to Currency Symbols (U+2000 to U+20CF).
+#define COMMON_GLYPH_COUNT (0x300 + 0xD0)
+
+// Returns the index of a code point in the common glyph table, or -1 if it is outside the common ranges.
+static inline int common_glyph_index(SFT_UChar charCode) {
+  if (charCode < 0x300) return (int)charCode;
+  if (charCode >= 0x2000 && charCode < 0x20D0) return (int)(charCode - 0x2000 + 0x300);
+  return -1;
+}
+
+static uint_fast32_t kerning_slot(uint_least32_t key, uint_fast32_t mask) {
+  return (key * 2654435761u >> 7) & mask;
+}
+
+// Adds the kerning pairs of all horizontal format 0 subtables to the kerning map. Pairs in several subtables are summed like in sft_kerning.
+static int init_kerning_map(SFT_Font *font) {
+  uint_fast32_t kern, offset;
+  unsigned int numTables, numPairs, totalPairs = 0, length, format, flags, idx, pass;
+
+  if (gettable(font, "kern", &kern) < 0) return 0;
+  if (!is_safe_offset(font, kern, 4)) return -1;
+  if (getu16(font, kern) != 0) return 0;
+
+  // The first pass counts the pairs and the second pass fills the map
+  for (pass = 0; pass < 2; ++pass) {
+    numTables = getu16(font, kern + 2);
+    offset = kern + 4;
+    while (numTables > 0) {
+      if (!is_safe_offset(font, offset, 6)) return -1;
+      length = getu16(font, offset + 2);
+      format = getu8(font, offset + 4);
+      flags = getu8(font, offset + 5);
+      offset += 6;
+      if (format == 0 && (flags & HORIZONTAL_KERNING) && !(flags & MINIMUM_KERNING) && !(flags & CROSS_STREAM_KERNING)) {
+        if (!is_safe_offset(font, offset, 8)) return -1;
+        numPairs = getu16(font, offset);
+        if (!is_safe_offset(font, offset + 8, numPairs * 6)) return -1;
+        if (pass == 0) {
+          totalPairs += numPairs;
+        } else {
+          for (idx = 0; idx < numPairs; ++idx) {
+            uint_least32_t key = getu32(font, offset + 8 + idx * 6);
+            int value = geti16(font, offset + 8 + idx * 6 + 4);
+            if (key == 0) continue;
+            uint_fast32_t slot = kerning_slot(key, font->kernMask);
+            while (font->kernKeys[slot] != 0 && font->kernKeys[slot] != key) {
+              slot = (slot + 1) & font->kernMask;
+            }
+            font->kernKeys[slot] = key;
+            font->kernValues[slot] += value;
+          }
+        }
+      }
+      offset += length;
+      --numTables;
+    }
+    if (pass == 0) {
+      if (totalPairs == 0) return 0;
+      // Keep the map at most half full
+      uint_fast32_t slots = 16;
+      while (slots < 2 * (uint_fast32_t)totalPairs) {
+        slots *= 2;
+      }
+      font->kernKeys = calloc(slots, sizeof *font->kernKeys);
+      font->kernValues = calloc(slots, sizeof *font->kernValues);
+      if (!font->kernKeys || !font->kernValues) return -1;
+      font->kernMask = slots - 1;
+    }
+  }
+  return 0;
+}
+
+// Builds the common glyph table, the advance width of every glyph and the kerning map.
+static int init_lookup_tables(SFT_Font *font) {
+  uint_fast32_t maxp;
+  SFT_Glyph glyph;
+  SFT_UChar charCode;
+  int adv, lsb, idx;
+
+  if (gettable(font, "maxp", &maxp) < 0) return -1;
+  if (!is_safe_offset(font, maxp, 6)) return -1;
+  font->numGlyphs = getu16(font, maxp + 4);
+
+  // Point into baked tables that were built from the same font file, they are never freed or written. Another build of
+  // the same font can have the same size and glyph count, so the file contents are compared by their hash.
+  if (font->baked) {
+    const SFT_BakedFont *baked = font->baked;
+    if (baked->fileSize != font->size || baked->numGlyphs != font->numGlyphs || baked->fileHash != sft_font_hash(font)) {
+      font->baked = NULL;
+    } else {
+      font->commonGlyphs = (uint_least16_t *)baked->commonGlyphs;
+      font->advances = (uint_least16_t *)baked->advances;
+      font->kernKeys = (uint_least32_t *)baked->kernKeys;
+      font->kernValues = (int_least16_t *)baked->kernValues;
+      font->kernMask = baked->kernMask;
+      init_latin_table(font);
+      return 0;
+    }
+  }
+
+  if (!(font->advances = calloc(font->numGlyphs + 1, sizeof *font->advances))) return -1;
+  for (glyph = 0; glyph < font->numGlyphs; ++glyph) {
+    if (hor_metrics(font, glyph, &adv, &lsb) < 0) return -1;
+    font->advances[glyph] = (uint_least16_t)adv;
+  }
+
+  if (!(font->commonGlyphs = calloc(COMMON_GLYPH_COUNT, sizeof *font->commonGlyphs))) return -1;
+  for (charCode = 0; charCode < 0x20D0; ++charCode) {
+    idx = common_glyph_index(charCode);
+    if (idx < 0) continue;
+    if (glyph_id(font, charCode, &glyph) < 0) return -1;
+    font->commonGlyphs[idx] = glyph < font->numGlyphs ? (uint_least16_t)glyph : 0;
+  }
+  init_latin_table(font);
+
+  return init_kerning_map(font);
+}
+
+// Copies the glyph id and advance width of the code points below 256 from the common glyph table and the advance widths.
+static void init_latin_table(SFT_Font *font) {
+  for (int charCode = 0; charCode < 256; ++charCode) {
+    uint_least16_t glyph = font->commonGlyphs[charCode];
+    font->latin[charCode].glyph = glyph;
+    font->latin[charCode].advance = (uint_least16_t)lookup_advance(font, glyph);
+  }
+}
+
+// Returns the end of the ASCII bytes that start at i, checking 8 bytes at a time.
+static inline int ascii_run_end(const uint8_t *text, int i, int length) {
+  while (i + 8 <= length) {
+    uint64_t word;
+    memcpy(&word, text + i, sizeof word);
+    if (word & 0x8080808080808080ULL) break;
+    i += 8;
+  }
+  while (i < length && text[i] < 0x80) {
+    ++i;
+  }
+  return i;
+}
+
+static void free_lookup_tables(SFT_Font *font) {
+  if (font->baked) return;
+  free(font->commonGlyphs);
+  free(font->advances);
+  free(font->kernKeys);
+  free(font->kernValues);
+}
+
+// Maps a code point to a glyph id, using the common glyph table when possible.
+static inline int lookup_glyph(SFT_Font *font, SFT_UChar charCode, SFT_Glyph *glyph) {
+  int idx = common_glyph_index(charCode);
+  if (idx >= 0) {
+    *glyph = font->commonGlyphs[idx];
+    return 0;
+  }
+  return glyph_id(font, charCode, glyph);
+}
+
+// Returns the advance width of a glyph in font units.
+static inline int lookup_advance(SFT_Font *font, SFT_Glyph glyph) {
+  return glyph < font->numGlyphs ? font->advances[glyph] : 0;
+}
+
+// Returns the horizontal kerning between two glyphs in font units.
+static inline int lookup_kerning(SFT_Font *font, SFT_Glyph leftGlyph, SFT_Glyph rightGlyph) {
+  if (font->kernMask == 0) return 0;
+  uint_least32_t key = (uint_least32_t)(leftGlyph & 0xFFFF) << 16 | (rightGlyph & 0xFFFF);
+  uint_fast32_t slot = kerning_slot(key, font->kernMask);
+  while (font->kernKeys[slot] != 0) {
+    if (font->kernKeys[slot] == key) return font->kernValues[slot];
+    slot = (slot + 1) & font->kernMask;
+  }
+  return 0;
+}
+
 static int glyph_bbox(const SFT *sft, uint_fast32_t outline, int box[4]) {
   double xScale, yScale;
   // Read the bounding box from the font file verbatim.
@@ -1138,8 +1487,8 @@ static int decode_outline(SFT_Font *font, uint_fast32_t offset, int recDepth, SF
 }
 
 // A heuristic to tell whether a given curve can be approximated closely enough by a line.
-static int is_flat(SFT_Outline *outl, SFT_Curve curve) {
-  const double maxArea2 = 2.0;
+// maxArea2 is 2 square pixels in the units of the points.
+static int is_flat(SFT_Outline *outl, SFT_Curve curve, double maxArea2) {
   SFT_Point a = outl->points[curve.beg];
   SFT_Point b = outl->points[curve.ctrl];
   SFT_Point c = outl->points[curve.end];
@@ -1149,13 +1498,13 @@ static int is_flat(SFT_Outline *outl, SFT_Curve curve) {
   return area2 <= maxArea2;
 }
 
-static int tesselate_curve(SFT_Curve curve, SFT_Outline *outl) {
+static int tesselate_curve(SFT_Curve curve, SFT_Outline *outl, double maxArea2) {
   // From my tests I can conclude that this stack barely reaches a top height of 4 elements even for the largest font sizes I'm willing to support. And as space requirements should only grow logarithmically, I think 10 is more than enough.
 #define STACK_SIZE 10
   SFT_Curve stack[STACK_SIZE];
   unsigned int top = 0;
   for (;;) {
-    if (is_flat(outl, curve) || top >= STACK_SIZE) {
+    if (is_flat(outl, curve, maxArea2) || top >= STACK_SIZE) {
       if (outl->numLines >= outl->capLines && grow_lines(outl) < 0)
         return -1;
       outl->lines[outl->numLines++] = (SFT_Line){curve.beg, curve.end};
@@ -1188,12 +1537,14 @@ static int tesselate_curve(SFT_Curve curve, SFT_Outline *outl) {
 #undef STACK_SIZE
 }
 
-static int tesselate_curves(SFT_Outline *outl) {
+static int tesselate_curves(SFT_Outline *outl, double maxArea2) {
   unsigned int i;
   for (i = 0; i < outl->numCurves; ++i) {
-    if (tesselate_curve(outl->curves[i], outl) < 0)
+    if (tesselate_curve(outl->curves[i], outl, maxArea2) < 0)
       return -1;
   }
+  // Every curve is now part of the lines
+  outl->numCurves = 0;
   return 0;
 }
 
@@ -1330,7 +1681,7 @@ static int render_outline(SFT_Outline *outl, double transform[6], SFT_Image imag
 
   clip_points(outl->numPoints, outl->points, image.width, image.height);
 
-  if (tesselate_curves(outl) < 0) {
+  if (tesselate_curves(outl, 2.0) < 0) {
     STACK_FREE(cells);
     return -1;
   }
@@ -1343,6 +1694,357 @@ static int render_outline(SFT_Outline *outl, double transform[6], SFT_Image imag
   return 0;
 }
 
+// Draws a line into float cells. Same as draw_line, with the crossings tracked in float precision.
+static void draw_line_float(SFT_FloatRaster buf, SFT_Point origin, SFT_Point goal) {
+  float originX = (float)origin.x, originY = (float)origin.y;
+  float deltaX = (float)(goal.x - origin.x), deltaY = (float)(goal.y - origin.y);
+  float nextCrossingX, nextCrossingY;
+  float crossingIncrX, crossingIncrY;
+  float halfDeltaX;
+  float prevDistance = 0.0f, nextDistance;
+  float xAverage, yDifference;
+  int pixelX, pixelY;
+  int dirX = SIGN(deltaX), dirY = SIGN(deltaY);
+  int step, numSteps = 0;
+  int index;
+
+  if (!dirY) {
+    return;
+  }
+
+  crossingIncrX = dirX ? fabsf(1.0f / deltaX) : 1.0f;
+  crossingIncrY = fabsf(1.0f / deltaY);
+
+  if (!dirX) {
+    pixelX = fast_floor(origin.x);
+    nextCrossingX = 100.0f;
+  } else {
+    if (dirX > 0) {
+      pixelX = fast_floor(origin.x);
+      nextCrossingX = crossingIncrX - (originX - pixelX) * crossingIncrX;
+      numSteps += fast_ceil(goal.x) - fast_floor(origin.x) - 1;
+    } else {
+      pixelX = fast_ceil(origin.x) - 1;
+      nextCrossingX = (originX - pixelX) * crossingIncrX;
+      numSteps += fast_ceil(origin.x) - fast_floor(goal.x) - 1;
+    }
+  }
+
+  if (dirY > 0) {
+    pixelY = fast_floor(origin.y);
+    nextCrossingY = crossingIncrY - (originY - pixelY) * crossingIncrY;
+    numSteps += fast_ceil(goal.y) - fast_floor(origin.y) - 1;
+  } else {
+    pixelY = fast_ceil(origin.y) - 1;
+    nextCrossingY = (originY - pixelY) * crossingIncrY;
+    numSteps += fast_ceil(origin.y) - fast_floor(goal.y) - 1;
+  }
+
+  nextDistance = MIN(nextCrossingX, nextCrossingY);
+  halfDeltaX = 0.5f * deltaX;
+
+  for (step = 0; step < numSteps; ++step) {
+    xAverage = originX + (prevDistance + nextDistance) * halfDeltaX;
+    yDifference = (nextDistance - prevDistance) * deltaY;
+    index = pixelY * buf.width + pixelX;
+    buf.covers[index] += yDifference;
+    buf.areas[index] += (1.0f - (xAverage - (float)pixelX)) * yDifference;
+    prevDistance = nextDistance;
+    int alongX = nextCrossingX < nextCrossingY;
+    pixelX += alongX ? dirX : 0;
+    pixelY += alongX ? 0 : dirY;
+    nextCrossingX += alongX ? crossingIncrX : 0.0f;
+    nextCrossingY += alongX ? 0.0f : crossingIncrY;
+    nextDistance = MIN(nextCrossingX, nextCrossingY);
+  }
+
+  xAverage = originX + (prevDistance + 1.0f) * halfDeltaX;
+  yDifference = (1.0f - prevDistance) * deltaY;
+  index = pixelY * buf.width + pixelX;
+  buf.covers[index] += yDifference;
+  buf.areas[index] += (1.0f - (xAverage - (float)pixelX)) * yDifference;
+}
+
+static void draw_lines_float(SFT_Outline *outl, SFT_FloatRaster buf) {
+  unsigned int i;
+  for (i = 0; i < outl->numLines; ++i) {
+    SFT_Line line = outl->lines[i];
+    draw_line_float(buf, outl->points[line.beg], outl->points[line.end]);
+  }
+}
+
+// Integrates float cells into the grayscale image like post_process. The running sum of the covers is computed four cells at a time with SSE2 or NEON when available.
+static void post_process_float(SFT_FloatRaster buf, uint8_t *image) {
+  float accum = 0.0f, value;
+  unsigned int i = 0, num;
+  num = (unsigned int)buf.width * (unsigned int)buf.height;
+#if defined(__SSE2__)
+  __m128 sums = _mm_setzero_ps();
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  const __m128 ones = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (; i + 4 <= num; i += 4) {
+    __m128 areas = _mm_loadu_ps(&buf.areas[i]);
+    __m128 covers = _mm_loadu_ps(&buf.covers[i]);
+    // Running sum of the covers within the four cells, then shifted by one cell so that each cell only sees the covers before it
+    __m128 running = _mm_add_ps(covers, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(covers), 4)));
+    running = _mm_add_ps(running, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(running), 8)));
+    __m128 before = _mm_add_ps(sums, _mm_sub_ps(running, covers));
+    __m128 values = _mm_andnot_ps(signMask, _mm_add_ps(before, areas));
+    values = _mm_add_ps(_mm_mul_ps(_mm_min_ps(values, ones), scale), half);
+    __m128i bytes = _mm_cvttps_epi32(values);
+    bytes = _mm_packs_epi32(bytes, bytes);
+    bytes = _mm_packus_epi16(bytes, bytes);
+    int packed = _mm_cvtsi128_si32(bytes);
+    memcpy(&image[i], &packed, 4);
+    sums = _mm_add_ps(sums, _mm_shuffle_ps(running, running, _MM_SHUFFLE(3, 3, 3, 3)));
+  }
+  accum = _mm_cvtss_f32(sums);
+#elif defined(__ARM_NEON)
+  float32x4_t sums = vdupq_n_f32(0.0f);
+  const float32x4_t zeros = vdupq_n_f32(0.0f);
+  const float32x4_t ones = vdupq_n_f32(1.0f);
+  const float32x4_t scale = vdupq_n_f32(255.0f);
+  const float32x4_t half = vdupq_n_f32(0.5f);
+  for (; i + 4 <= num; i += 4) {
+    float32x4_t areas = vld1q_f32(&buf.areas[i]);
+    float32x4_t covers = vld1q_f32(&buf.covers[i]);
+    float32x4_t running = vaddq_f32(covers, vextq_f32(zeros, covers, 3));
+    running = vaddq_f32(running, vextq_f32(zeros, running, 2));
+    float32x4_t before = vaddq_f32(sums, vsubq_f32(running, covers));
+    float32x4_t values = vabsq_f32(vaddq_f32(before, areas));
+    values = vaddq_f32(vmulq_f32(vminq_f32(values, ones), scale), half);
+    uint16x4_t words = vmovn_u32(vcvtq_u32_f32(values));
+    uint8x8_t bytes = vmovn_u16(vcombine_u16(words, words));
+    uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+    memcpy(&image[i], &packed, 4);
+    sums = vaddq_f32(sums, vdupq_n_f32(vgetq_lane_f32(running, 3)));
+  }
+  accum = vgetq_lane_f32(sums, 0);
+#endif
+  for (; i < num; ++i) {
+    value = fabsf(accum + buf.areas[i]);
+    value = MIN(value, 1.0f);
+    value = value * 255.0f + 0.5f;
+    image[i] = (uint8_t)value;
+    accum += buf.covers[i];
+  }
+}
+
+// Renders an outline with float cells. The cells are kept in sft_scratch and only grow, so rendering does not allocate once the largest glyph has been drawn.
+static int render_outline_float(SFT_Outline *outl, double transform[6], SFT_Image image) {
+  SFT_FloatRaster buf;
+  size_t numPixels = (size_t)image.width * (size_t)image.height;
+
+  if (numPixels > sft_scratch.capCells) {
+    size_t capCells = sft_scratch.capCells ? sft_scratch.capCells : 128 * 128;
+    while (capCells < numPixels) {
+      capCells *= 2;
+    }
+    float *cells = reallocarray(sft_scratch.cells, capCells, 2 * sizeof(float));
+    if (!cells) {
+      return -1;
+    }
+    sft_scratch.cells = cells;
+    sft_scratch.capCells = capCells;
+  }
+  buf.areas = sft_scratch.cells;
+  buf.covers = sft_scratch.cells + numPixels;
+  buf.width = image.width;
+  buf.height = image.height;
+  memset(sft_scratch.cells, 0, 2 * numPixels * sizeof(float));
+
+  transform_points(outl->numPoints, outl->points, transform);
+
+  clip_points(outl->numPoints, outl->points, image.width, image.height);
+
+  if (tesselate_curves(outl, 2.0) < 0) {
+    return -1;
+  }
+
+  draw_lines_float(outl, buf);
+
+  post_process_float(buf, image.pixels);
+
+  return 0;
+}
+
+// Grows the outline until it has room for the given number of points, curves and lines
+static int reserve_outline(SFT_Outline *outl, unsigned int numPoints, unsigned int numCurves, unsigned int numLines) {
+  while (outl->capPoints < numPoints) {
+    if (grow_points(outl) < 0) return -1;
+  }
+  while (outl->capCurves < numCurves) {
+    if (grow_curves(outl) < 0) return -1;
+  }
+  while (outl->capLines < numLines) {
+    if (grow_lines(outl) < 0) return -1;
+  }
+  return 0;
+}
+
+// Copies the decoded outline of a glyph out of the font, keeping the points in font units
+static SFT_CachedOutline *cache_outline(SFT_Outline *outl) {
+  size_t pointsSize = outl->numPoints * sizeof(SFT_Point);
+  size_t curvesSize = outl->numCurves * sizeof(SFT_Curve);
+  size_t linesSize = outl->numLines * sizeof(SFT_Line);
+  SFT_CachedOutline *cached = calloc(1, sizeof *cached + pointsSize + curvesSize + linesSize);
+  if (!cached) return NULL;
+  cached->size = sizeof *cached + pointsSize + curvesSize + linesSize;
+  cached->points = (SFT_Point *)(cached + 1);
+  cached->curves = (SFT_Curve *)((uint8_t *)cached->points + pointsSize);
+  cached->lines = (SFT_Line *)((uint8_t *)cached->curves + curvesSize);
+  cached->numPoints = outl->numPoints;
+  cached->numCurves = outl->numCurves;
+  cached->numLines = outl->numLines;
+  memcpy(cached->points, outl->points, pointsSize);
+  memcpy(cached->curves, outl->curves, curvesSize);
+  memcpy(cached->lines, outl->lines, linesSize);
+  return cached;
+}
+
+// Returns the bytes of the flattened lines of a pixel size
+static size_t get_flat_outline_size(SFT_FlatOutline flat) {
+  return flat.numPoints * sizeof(SFT_Point) + flat.numLines * sizeof(SFT_Line);
+}
+
+// Keeps the flattened lines of the outline for a pixel size, evicting the least recently used size when all slots are taken
+static void cache_flat_outline(SFT_Font *font, SFT_CachedOutline *cached, int size, SFT_Outline *outl) {
+  size_t pointsSize = outl->numPoints * sizeof(SFT_Point);
+  size_t linesSize = outl->numLines * sizeof(SFT_Line);
+  SFT_Point *points = malloc(pointsSize + linesSize);
+  if (!points) return;
+  SFT_FlatOutline evicted = cached->flat[OUTLINE_CACHE_SIZES - 1];
+  if (evicted.size) {
+    cached->size -= get_flat_outline_size(evicted);
+    font->outlineSize -= get_flat_outline_size(evicted);
+  }
+  free(evicted.points);
+  memmove(&cached->flat[1], &cached->flat[0], (OUTLINE_CACHE_SIZES - 1) * sizeof(SFT_FlatOutline));
+  cached->flat[0] = (SFT_FlatOutline){
+    .size = size,
+    .points = points,
+    .lines = (SFT_Line *)((uint8_t *)points + pointsSize),
+    .numPoints = outl->numPoints,
+    .numLines = outl->numLines,
+  };
+  memcpy(cached->flat[0].points, outl->points, pointsSize);
+  memcpy(cached->flat[0].lines, outl->lines, linesSize);
+  cached->size += pointsSize + linesSize;
+  font->outlineSize += pointsSize + linesSize;
+}
+
+static void outline_cache_unlink_lru(SFT_Font *font, SFT_CachedOutline *cached) {
+  if (cached->lruPrev) {
+    cached->lruPrev->lruNext = cached->lruNext;
+  } else {
+    font->outlineHead = cached->lruNext;
+  }
+  if (cached->lruNext) {
+    cached->lruNext->lruPrev = cached->lruPrev;
+  } else {
+    font->outlineTail = cached->lruPrev;
+  }
+  cached->lruPrev = NULL;
+  cached->lruNext = NULL;
+}
+
+static void outline_cache_push_lru(SFT_Font *font, SFT_CachedOutline *cached) {
+  cached->lruPrev = NULL;
+  cached->lruNext = font->outlineHead;
+  if (font->outlineHead) {
+    font->outlineHead->lruPrev = cached;
+  } else {
+    font->outlineTail = cached;
+  }
+  font->outlineHead = cached;
+}
+
+// Frees a cached outline with its flattened lines and removes it from the font
+static void free_cached_outline(SFT_Font *font, SFT_CachedOutline *cached) {
+  outline_cache_unlink_lru(font, cached);
+  font->outlines[cached->glyph] = NULL;
+  font->outlineSize -= cached->size;
+  for (int i = 0; i < OUTLINE_CACHE_SIZES; i++) {
+    free(cached->flat[i].points);
+  }
+  free(cached);
+}
+
+// Frees the least recently used outlines until the cache fits in OUTLINE_CACHE_CAPACITY, keeping the most recent one
+static void trim_outline_cache(SFT_Font *font) {
+  while (font->outlineSize > OUTLINE_CACHE_CAPACITY && font->outlineTail != font->outlineHead) {
+    free_cached_outline(font, font->outlineTail);
+  }
+}
+
+// Loads the outline of a glyph into outl with its curves flattened, in font units. The decoded outline is cached per font
+// and the flattened lines per pixel size, so a glyph that is rendered at a new size or subpixel offset skips decoding,
+// and one that is rendered at a size it has been flattened for also skips the flattening. The lines of a size are flat
+// enough for every scale up to that size, so fractional scales share the slot of the next whole size. The cache holds at
+// most OUTLINE_CACHE_CAPACITY bytes per font, and the outlines that were used least recently are freed first.
+static int load_outline(const SFT *sft, SFT_Glyph glyph, uint_fast32_t offset, SFT_Outline *outl) {
+  SFT_Font *font = sft->font;
+  if (glyph >= font->numGlyphs) {
+    return decode_outline(font, offset, 0, outl);
+  }
+  if (!font->outlines && !(font->outlines = calloc(font->numGlyphs, sizeof *font->outlines))) return -1;
+
+  SFT_CachedOutline *cached = font->outlines[glyph];
+  if (!cached) {
+    if (decode_outline(font, offset, 0, outl) < 0) return -1;
+    if (!(cached = cache_outline(outl))) return -1;
+    cached->glyph = glyph;
+    font->outlines[glyph] = cached;
+    font->outlineSize += cached->size;
+  } else {
+    outline_cache_unlink_lru(font, cached);
+  }
+  outline_cache_push_lru(font, cached);
+
+  int size = fast_ceil(sft->xScale > sft->yScale ? sft->xScale : sft->yScale);
+  if (size < 1) size = 1;
+  for (int i = 0; i < OUTLINE_CACHE_SIZES && cached->flat[i].size; i++) {
+    if (cached->flat[i].size != size) continue;
+    SFT_FlatOutline flat = cached->flat[i];
+    // Move the size to the front so that it is evicted last
+    memmove(&cached->flat[1], &cached->flat[0], i * sizeof(SFT_FlatOutline));
+    cached->flat[0] = flat;
+    if (reserve_outline(outl, flat.numPoints, 0, flat.numLines) < 0) return -1;
+    memcpy(outl->points, flat.points, flat.numPoints * sizeof(SFT_Point));
+    memcpy(outl->lines, flat.lines, flat.numLines * sizeof(SFT_Line));
+    outl->numPoints = flat.numPoints;
+    outl->numCurves = 0;
+    outl->numLines = flat.numLines;
+    return 0;
+  }
+
+  if (reserve_outline(outl, cached->numPoints, cached->numCurves, cached->numLines) < 0) return -1;
+  memcpy(outl->points, cached->points, cached->numPoints * sizeof(SFT_Point));
+  memcpy(outl->curves, cached->curves, cached->numCurves * sizeof(SFT_Curve));
+  memcpy(outl->lines, cached->lines, cached->numLines * sizeof(SFT_Line));
+  outl->numPoints = cached->numPoints;
+  outl->numCurves = cached->numCurves;
+  outl->numLines = cached->numLines;
+  // 2 square pixels at the cached size, in square font units
+  double unitsPerPixel = (double)font->unitsPerEm / size;
+  if (tesselate_curves(outl, 2.0 * unitsPerPixel * unitsPerPixel) < 0) return -1;
+  cache_flat_outline(font, cached, size, outl);
+  trim_outline_cache(font);
+  return 0;
+}
+
+// Frees the cached outlines of a font
+static void free_outline_cache(SFT_Font *font) {
+  if (!font->outlines) return;
+  while (font->outlineHead) {
+    free_cached_outline(font, font->outlineHead);
+  }
+  free(font->outlines);
+  font->outlines = NULL;
+}
+
 // Takes a UTF-8 string (uint8 array) and returns the first full UTF-8 character and assigns it to a uint32. Returns the number of bytes converted.
 static int utf8_to_utf32(const uint8_t *utf8, uint32_t *utf32) {
   uint8_t c = utf8[0];
@@ -1367,31 +2069,37 @@ static int utf8_to_utf32(const uint8_t *utf8, uint32_t *utf32) {
 
 // Steps through a UTF-8 string and measures the width of each character and the kerning between them to determine how many characters fit into a given width. Set measure_width to 0 to measure the entire string.
 int SFT_MeasureUTF8(SFT *sft, uint8_t *text, int measure_width, int *extent, int *count) {
+  SFT_Font *font = sft->font;
   SFT_UChar charCode;
   SFT_Glyph glyph;
   SFT_Glyph lastGlyph = 0;
-  SFT_Kerning kerning;
-  SFT_GMetrics metrics;
+  double xScale = sft->xScale / font->unitsPerEm;
   double width = 0;
   int i = 0;
   int j = 0;
   // Loop through the string until null terminator
   while (text[i] != 0) {
-    // i is incremented by the number of bytes in the UTF-8 character
-    i += utf8_to_utf32(&text[i], &charCode);
-    if (glyph_id(sft->font, charCode, &glyph) < 0) {
-      printf("glyph_id failed\n");
-      return -1;
-    }
-    if (sft_gmetrics(sft, glyph, &metrics) < 0) {
-      printf("sft_metrics failed\n");
-      return -1;
-    }
-    if (lastGlyph != 0) {
-      if (sft_kerning(sft, lastGlyph, glyph, &kerning) < 0) return -1;
+    int advance;
+    // ASCII characters are one byte and are looked up in the Latin-1 table
+    if (text[i] < 0x80) {
+      glyph = font->latin[text[i]].glyph;
+      advance = font->latin[text[i]].advance;
+      i++;
+    } else {
+      // i is incremented by the number of bytes in the UTF-8 character
+      i += utf8_to_utf32(&text[i], &charCode);
+      if (lookup_glyph(font, charCode, &glyph) < 0) {
+        printf("glyph_id failed\n");
+        return -1;
+      }
+      advance = lookup_advance(font, glyph);
     }
-    if (measure_width == 0 || width + kerning.xShift + metrics.advanceWidth < measure_width) {
-      width += kerning.xShift + metrics.advanceWidth;
+    // Kerning is scaled the same way as in sft_kerning, most pairs have none
+    int kerningUnits = lastGlyph != 0 ? lookup_kerning(font, lastGlyph, glyph) : 0;
+    double kerning = kerningUnits != 0 ? (double)kerningUnits / font->unitsPerEm * sft->xScale : 0;
+    double advanceWidth = advance * xScale;
+    if (measure_width == 0 || width + kerning + advanceWidth < measure_width) {
+      width += kerning + advanceWidth;
     } else {
       break;
     }
@@ -1416,74 +2124,593 @@ int SFT_text_width(SFT *sft, uint8_t *text, int *width_ref) {
   return 0;
 }
 
-// Renders a UTF-8 string into an image using sft_render for each character.
+// Rasterized glyph cache
+// Glyph bitmaps are cached by font, scale, y offset, flags, glyph id and a quantized subpixel x offset, so that repainting text only
+// copies pixels. Each cache entry is a header followed by its pixels, stored in a block of a fixed size class. Blocks are carved from
+// pages that are dedicated to one size class and freed blocks go back to a free list for their class, so the pages stay packed without
+// moving entries. When the memory cap is reached, the least recently used glyph of the needed size class is evicted to make room. If no
+// glyph of that class is cached, the least recently used glyphs of any class are evicted until a page is empty, and the page is carved
+// again for the needed class, so the pages never grow past the cap. Glyphs larger than the largest size class (large font sizes) get a
+// block of their own, which counts against the same cap and is freed when the glyph is evicted.
+
+#define GLYPH_CACHE_SUBPIXELS 4
+#define GLYPH_CACHE_BUCKETS 2048 // Must be a power of two
+#define GLYPH_CACHE_PAGE_SIZE 65536
+#define GLYPH_CACHE_CLASSES 6 // Block sizes 128, 256, 512, 1024, 2048 and 4096 bytes
+#define GLYPH_CACHE_LARGE GLYPH_CACHE_CLASSES // Size class of glyphs with a block of their own
+#define GLYPH_CACHE_MIN_BLOCK 128
+#define GLYPH_CACHE_DEFAULT_CAPACITY (4 * 1024 * 1024)
+
+typedef struct SFT_CachedGlyph SFT_CachedGlyph;
+typedef struct SFT_GlyphCache SFT_GlyphCache;
+typedef struct SFT_GlyphCachePage SFT_GlyphCachePage;
+typedef struct SFT_FreeBlock SFT_FreeBlock;
+
+// Stored at the start of each page, before the first block
+struct SFT_GlyphCachePage {
+  SFT_GlyphCachePage *next;
+  int sizeClass;
+  int used; // Blocks that hold a glyph
+};
+
+// A block on the free list of its size class
+struct SFT_FreeBlock {
+  SFT_FreeBlock *next;
+  SFT_GlyphCachePage *page;
+};
+
+struct SFT_CachedGlyph {
+  const SFT_Font *font;
+  double xScale;
+  double yScale;
+  double yOffset;
+  int flags;
+  SFT_Glyph glyph;
+  double advanceWidth;
+  int subpixel; // Quantized x offset of the pen, from 0 to GLYPH_CACHE_SUBPIXELS - 1
+  int left; // Pixels from the pen position to the left edge of the bitmap
+  int top; // Pixels from the baseline to the top edge of the bitmap
+  int width;
+  int height;
+  int sizeClass; // GLYPH_CACHE_LARGE if the glyph has a block of its own
+  SFT_GlyphCachePage *page; // Page that holds the block of the glyph, NULL for large glyphs
+  SFT_CachedGlyph *hashNext;
+  SFT_CachedGlyph *lruPrev; // Towards the most recently used glyph
+  SFT_CachedGlyph *lruNext; // Towards the least recently used glyph
+  uint8_t *pixels;
+};
+
+struct SFT_GlyphCache {
+  SFT_CachedGlyph *buckets[GLYPH_CACHE_BUCKETS];
+  SFT_CachedGlyph *lruHead; // Most recently used
+  SFT_CachedGlyph *lruTail; // Least recently used
+  SFT_FreeBlock *freeBlocks[GLYPH_CACHE_CLASSES];
+  SFT_GlyphCachePage *pages;
+  size_t capacity; // Memory cap for all pages and large glyphs in bytes
+  size_t size; // Memory used by all pages and large glyphs in bytes
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+};
+
+SFT_GlyphCache sft_glyph_cache = {
+  .capacity = GLYPH_CACHE_DEFAULT_CAPACITY,
+};
+
+// Header size rounded up so that the pixels following it stay pointer aligned
+#define GLYPH_CACHE_HEADER_SIZE ((sizeof(SFT_CachedGlyph) + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *))
+// Room for the page header before the first block
+#define GLYPH_CACHE_PAGE_HEADER ((sizeof(SFT_GlyphCachePage) + 15) / 16 * 16)
+
+static size_t glyph_cache_block_size(int sizeClass) {
+  return (size_t)GLYPH_CACHE_MIN_BLOCK << sizeClass;
+}
+
+static unsigned int glyph_cache_hash(const SFT *sft, SFT_Glyph glyph, int subpixel) {
+  uintptr_t font = (uintptr_t)sft->font;
+  unsigned int hash = (unsigned int)(font >> 4) * 2654435761u;
+  hash ^= (unsigned int)glyph * 40503u;
+  hash ^= (unsigned int)(sft->xScale * 64.0) * 97u;
+  hash ^= (unsigned int)(sft->yScale * 64.0) * 193u;
+  hash ^= (unsigned int)(int)(sft->yOffset * 64.0) * 389u;
+  hash ^= (unsigned int)sft->flags * 1031u;
+  hash ^= (unsigned int)subpixel * 7919u;
+  return hash & (GLYPH_CACHE_BUCKETS - 1);
+}
+
+// Returns the size of the block of a large glyph
+static size_t glyph_cache_large_size(const SFT_CachedGlyph *entry) {
+  return GLYPH_CACHE_HEADER_SIZE + (size_t)entry->width * entry->height;
+}
+
+static void glyph_cache_unlink_lru(SFT_GlyphCache *cache, SFT_CachedGlyph *entry) {
+  if (entry->lruPrev) {
+    entry->lruPrev->lruNext = entry->lruNext;
+  } else {
+    cache->lruHead = entry->lruNext;
+  }
+  if (entry->lruNext) {
+    entry->lruNext->lruPrev = entry->lruPrev;
+  } else {
+    cache->lruTail = entry->lruPrev;
+  }
+  entry->lruPrev = NULL;
+  entry->lruNext = NULL;
+}
+
+static void glyph_cache_push_lru(SFT_GlyphCache *cache, SFT_CachedGlyph *entry) {
+  entry->lruPrev = NULL;
+  entry->lruNext = cache->lruHead;
+  if (cache->lruHead) {
+    cache->lruHead->lruPrev = entry;
+  } else {
+    cache->lruTail = entry;
+  }
+  cache->lruHead = entry;
+}
+
+// Returns a block to the free list of its size class
+static void glyph_cache_free_block(SFT_GlyphCache *cache, void *block, int sizeClass, SFT_GlyphCachePage *page) {
+  SFT_FreeBlock *freeBlock = block;
+  freeBlock->next = cache->freeBlocks[sizeClass];
+  freeBlock->page = page;
+  cache->freeBlocks[sizeClass] = freeBlock;
+  page->used--;
+}
+
+// Removes an entry from the hash table and the LRU list and returns its block to the free list, or frees the block of a large glyph
+static void glyph_cache_remove(SFT_GlyphCache *cache, SFT_CachedGlyph *entry) {
+  SFT key = {
+    .font = (SFT_Font *)entry->font,
+    .xScale = entry->xScale,
+    .yScale = entry->yScale,
+    .yOffset = entry->yOffset,
+    .flags = entry->flags,
+  };
+  SFT_CachedGlyph **link = &cache->buckets[glyph_cache_hash(&key, entry->glyph, entry->subpixel)];
+  while (*link && *link != entry) {
+    link = &(*link)->hashNext;
+  }
+  if (*link) {
+    *link = entry->hashNext;
+  }
+  glyph_cache_unlink_lru(cache, entry);
+  if (entry->sizeClass == GLYPH_CACHE_LARGE) {
+    cache->size -= glyph_cache_large_size(entry);
+    free(entry);
+    return;
+  }
+  glyph_cache_free_block(cache, entry, entry->sizeClass, entry->page);
+}
+
+// Carves a page into blocks of one size class and adds them to its free list
+static void glyph_cache_carve_page(SFT_GlyphCache *cache, SFT_GlyphCachePage *page, int sizeClass) {
+  page->sizeClass = sizeClass;
+  page->used = 0;
+  size_t blockSize = glyph_cache_block_size(sizeClass);
+  for (size_t offset = GLYPH_CACHE_PAGE_HEADER; offset + blockSize <= GLYPH_CACHE_PAGE_SIZE; offset += blockSize) {
+    SFT_FreeBlock *block = (SFT_FreeBlock *)((uint8_t *)page + offset);
+    block->next = cache->freeBlocks[sizeClass];
+    block->page = page;
+    cache->freeBlocks[sizeClass] = block;
+  }
+}
+
+// Adds a new page for a size class
+static int glyph_cache_add_page(SFT_GlyphCache *cache, int sizeClass) {
+  SFT_GlyphCachePage *page = malloc(GLYPH_CACHE_PAGE_SIZE);
+  if (!page) return -1;
+  page->next = cache->pages;
+  cache->pages = page;
+  cache->size += GLYPH_CACHE_PAGE_SIZE;
+  glyph_cache_carve_page(cache, page, sizeClass);
+  return 0;
+}
+
+// Drops the free blocks of a page from the free list of its size class
+static void glyph_cache_drop_free_blocks(SFT_GlyphCache *cache, SFT_GlyphCachePage *page) {
+  SFT_FreeBlock **link = &cache->freeBlocks[page->sizeClass];
+  while (*link) {
+    if ((*link)->page == page) {
+      *link = (*link)->next;
+    } else {
+      link = &(*link)->next;
+    }
+  }
+}
+
+// Frees an empty page
+static void glyph_cache_free_page(SFT_GlyphCache *cache, SFT_GlyphCachePage *page) {
+  glyph_cache_drop_free_blocks(cache, page);
+  SFT_GlyphCachePage **link = &cache->pages;
+  while (*link != page) {
+    link = &(*link)->next;
+  }
+  *link = page->next;
+  cache->size -= GLYPH_CACHE_PAGE_SIZE;
+  free(page);
+}
+
+// Makes a page for a size class from an empty page, or evicts the least recently used glyphs of any size class until a page is
+// empty or evicted large glyphs leave room for a new page. Returns -1 if no page can be made under the cap.
+static int glyph_cache_make_page(SFT_GlyphCache *cache, int sizeClass) {
+  SFT_GlyphCachePage *page = cache->pages;
+  while (page && page->used > 0) {
+    page = page->next;
+  }
+  while (!page) {
+    if (cache->size + GLYPH_CACHE_PAGE_SIZE <= cache->capacity) return glyph_cache_add_page(cache, sizeClass);
+    SFT_CachedGlyph *victim = cache->lruTail;
+    if (!victim) return -1;
+    SFT_GlyphCachePage *victimPage = victim->page;
+    glyph_cache_remove(cache, victim);
+    cache->evictions++;
+    if (victimPage && victimPage->used == 0) {
+      page = victimPage;
+    }
+  }
+  glyph_cache_drop_free_blocks(cache, page);
+  glyph_cache_carve_page(cache, page, sizeClass);
+  return 0;
+}
+
+// Frees the empty pages and evicts the least recently used glyphs, freeing the pages they leave empty, until the cache uses at
+// most size bytes
+static void glyph_cache_shrink(SFT_GlyphCache *cache, size_t size) {
+  SFT_GlyphCachePage *page = cache->pages;
+  while (page && cache->size > size) {
+    SFT_GlyphCachePage *next = page->next;
+    if (page->used == 0) {
+      glyph_cache_free_page(cache, page);
+    }
+    page = next;
+  }
+  while (cache->size > size && cache->lruTail) {
+    SFT_CachedGlyph *victim = cache->lruTail;
+    SFT_GlyphCachePage *victimPage = victim->page;
+    glyph_cache_remove(cache, victim);
+    cache->evictions++;
+    if (victimPage && victimPage->used == 0) {
+      glyph_cache_free_page(cache, victimPage);
+    }
+  }
+}
+
+// Returns a free block of the size class and sets its page. When the cache is full, the least recently used glyph of the same size
+// class is evicted, or an emptied page of another class is carved again. Returns NULL if no block fits under the cap.
+static void *glyph_cache_alloc(SFT_GlyphCache *cache, int sizeClass, SFT_GlyphCachePage **pageRef) {
+  if (!cache->freeBlocks[sizeClass]) {
+    if (cache->size + GLYPH_CACHE_PAGE_SIZE <= cache->capacity) {
+      if (glyph_cache_add_page(cache, sizeClass) < 0) return NULL;
+    } else {
+      SFT_CachedGlyph *victim = cache->lruTail;
+      while (victim && victim->sizeClass != sizeClass) {
+        victim = victim->lruPrev;
+      }
+      if (victim) {
+        glyph_cache_remove(cache, victim);
+        cache->evictions++;
+      } else if (glyph_cache_make_page(cache, sizeClass) < 0) {
+        return NULL;
+      }
+    }
+  }
+  SFT_FreeBlock *block = cache->freeBlocks[sizeClass];
+  cache->freeBlocks[sizeClass] = block->next;
+  block->page->used++;
+  *pageRef = block->page;
+  return block;
+}
+
+// Returns a block of its own for a glyph larger than the largest size class, evicting glyphs until it fits under the cap.
+// Returns NULL if it can not fit.
+static void *glyph_cache_alloc_large(SFT_GlyphCache *cache, size_t size) {
+  if (size > cache->capacity) return NULL;
+  glyph_cache_shrink(cache, cache->capacity - size);
+  if (cache->size + size > cache->capacity) return NULL;
+  void *block = malloc(size);
+  if (!block) return NULL;
+  cache->size += size;
+  return block;
+}
+
+// Removes all glyphs of a font, so that a new font loaded at the same address does not get them
+static void glyph_cache_purge_font(const SFT_Font *font) {
+  SFT_GlyphCache *cache = &sft_glyph_cache;
+  SFT_CachedGlyph *entry = cache->lruHead;
+  while (entry) {
+    SFT_CachedGlyph *next = entry->lruNext;
+    if (entry->font == font) {
+      glyph_cache_remove(cache, entry);
+    }
+    entry = next;
+  }
+}
+
+// Frees all cached glyphs and pages
+void sft_glyph_cache_clear(void) {
+  SFT_GlyphCache *cache = &sft_glyph_cache;
+  SFT_CachedGlyph *entry = cache->lruHead;
+  while (entry) {
+    SFT_CachedGlyph *next = entry->lruNext;
+    if (entry->sizeClass == GLYPH_CACHE_LARGE) {
+      free(entry);
+    }
+    entry = next;
+  }
+  SFT_GlyphCachePage *page = cache->pages;
+  while (page) {
+    SFT_GlyphCachePage *next = page->next;
+    free(page);
+    page = next;
+  }
+  size_t capacity = cache->capacity;
+  memset(cache, 0, sizeof *cache);
+  cache->capacity = capacity;
+}
+
+// Sets the memory cap of the glyph cache in bytes. A lower cap evicts the least recently used glyphs and frees pages until the
+// cache fits. A capacity of 0 disables the cache.
+void sft_glyph_cache_set_capacity(size_t capacity) {
+  sft_glyph_cache.capacity = capacity;
+  glyph_cache_shrink(&sft_glyph_cache, capacity);
+}
+
+// Returns the cached glyph, rasterizing it on a miss. Returns NULL if the glyph is larger than the cap.
+static SFT_CachedGlyph *glyph_cache_get(SFT *sft, SFT_Glyph glyph, int subpixel) {
+  SFT_GlyphCache *cache = &sft_glyph_cache;
+  if (cache->capacity == 0) return NULL;
+  unsigned int bucket = glyph_cache_hash(sft, glyph, subpixel);
+  for (SFT_CachedGlyph *entry = cache->buckets[bucket]; entry; entry = entry->hashNext) {
+    if (entry->glyph == glyph && entry->subpixel == subpixel && entry->font == sft->font &&
+        entry->xScale == sft->xScale && entry->yScale == sft->yScale && entry->yOffset == sft->yOffset &&
+        entry->flags == sft->flags) {
+      // Move to the front of the LRU list
+      if (cache->lruHead != entry) {
+        glyph_cache_unlink_lru(cache, entry);
+        glyph_cache_push_lru(cache, entry);
+      }
+      cache->hits++;
+      return entry;
+    }
+  }
+  cache->misses++;
+
+  SFT_GMetrics metrics;
+  if (sft_gmetrics(sft, glyph, &metrics) < 0) return NULL;
+  size_t needed = GLYPH_CACHE_HEADER_SIZE + (size_t)metrics.minWidth * metrics.minHeight;
+  int sizeClass = 0;
+  while (sizeClass < GLYPH_CACHE_CLASSES && glyph_cache_block_size(sizeClass) < needed) {
+    sizeClass++;
+  }
+  SFT_GlyphCachePage *page = NULL;
+  SFT_CachedGlyph *entry;
+  if (sizeClass == GLYPH_CACHE_LARGE) {
+    entry = glyph_cache_alloc_large(cache, needed);
+  } else {
+    entry = glyph_cache_alloc(cache, sizeClass, &page);
+  }
+  if (!entry) return NULL;
+
+  // The bitmap is placed at the quantized pen offset plus the left side bearing
+  double left = metrics.leftSideBearing + (double)subpixel / GLYPH_CACHE_SUBPIXELS;
+  int leftPixels = fast_floor(left);
+  *entry = (SFT_CachedGlyph){
+    .font = sft->font,
+    .xScale = sft->xScale,
+    .yScale = sft->yScale,
+    .yOffset = sft->yOffset,
+    .flags = sft->flags,
+    .glyph = glyph,
+    .advanceWidth = metrics.advanceWidth,
+    .subpixel = subpixel,
+    .left = leftPixels,
+    .top = metrics.yOffset,
+    .width = metrics.minWidth,
+    .height = metrics.minHeight,
+    .sizeClass = sizeClass,
+    .page = page,
+    .pixels = (uint8_t *)entry + GLYPH_CACHE_HEADER_SIZE,
+  };
+  memset(entry->pixels, 0, (size_t)entry->width * entry->height);
+  SFT_Image image = {
+    .pixels = entry->pixels,
+    .width = entry->width,
+    .height = entry->height,
+  };
+  double xOffset = sft->xOffset;
+  sft->xOffset = left - leftPixels;
+  int result = sft_render(sft, glyph, image);
+  sft->xOffset = xOffset;
+  if (result < 0) {
+    if (sizeClass == GLYPH_CACHE_LARGE) {
+      cache->size -= needed;
+      free(entry);
+    } else {
+      glyph_cache_free_block(cache, entry, sizeClass, page);
+    }
+    return NULL;
+  }
+
+  entry->hashNext = cache->buckets[bucket];
+  cache->buckets[bucket] = entry;
+  glyph_cache_push_lru(cache, entry);
+  return entry;
+}
+
+// Returns the baked bitmap of a glyph at the size of sft and a subpixel offset, or NULL if it was not baked.
+// Glyphs are baked without a y offset or flags, so an sft with either does not use them.
+const SFT_BakedGlyph *sft_baked_glyph(const SFT *sft, SFT_Glyph glyph, int subpixel, const uint8_t **pixels) {
+  const SFT_BakedFont *baked = sft->font->baked;
+  if (!baked || glyph >= baked->numGlyphs || sft->yOffset != 0 || sft->flags != 0) return NULL;
+  for (int i = 0; i < baked->numSizes; i++) {
+    const SFT_BakedSize *size = &baked->sizes[i];
+    if (size->xScale != sft->xScale || size->yScale != sft->yScale) continue;
+    uint32_t index = size->glyphIndex[glyph * GLYPH_CACHE_SUBPIXELS + subpixel];
+    if (index == 0) return NULL;
+    const SFT_BakedGlyph *entry = &size->glyphs[index - 1];
+    *pixels = size->pixels + entry->pixels;
+    return entry;
+  }
+  return NULL;
+}
+
+// Copies glyph pixels into the image at x, y, keeping the maximum value where glyphs overlap
+static void blit_glyph(SFT_Image image, const uint8_t *pixels, int width, int height, int x, int y) {
+  // Clip the glyph to the image once instead of per pixel
+  int first_column = x < 0 ? -x : 0;
+  int last_column = x + width > image.width ? image.width - x : width;
+  int first_row = y < 0 ? -y : 0;
+  int last_row = y + height > image.height ? image.height - y : height;
+  uint8_t *target_pixels = image.pixels;
+  for (int row = first_row; row < last_row; row++) {
+    const uint8_t *source = &pixels[row * width];
+    uint8_t *target = &target_pixels[(y + row) * image.width + x];
+    for (int column = first_column; column < last_column; column++) {
+      if (source[column] > target[column]) {
+        target[column] = source[column];
+      }
+    }
+  }
+}
+
+// Draws a glyph with its pen position at penX pixels from the left edge of the image, using the glyph cache.
+// The pen position is quantized to 1/GLYPH_CACHE_SUBPIXELS of a pixel. Glyphs that are larger than the cap are rendered directly.
+static int render_glyph_at(SFT *sft, SFT_Glyph glyph, double penX, int baseline, SFT_Image image) {
+  // Round the pen position to the nearest subpixel bucket
+  int subpixelPosition = fast_floor(penX * GLYPH_CACHE_SUBPIXELS + 0.5);
+  int penPixel = fast_floor((double)subpixelPosition / GLYPH_CACHE_SUBPIXELS);
+  int subpixel = subpixelPosition - penPixel * GLYPH_CACHE_SUBPIXELS;
+
+  // Baked bitmaps are used in place, without going through the cache
+  const uint8_t *bakedPixels;
+  const SFT_BakedGlyph *baked = sft_baked_glyph(sft, glyph, subpixel, &bakedPixels);
+  if (baked) {
+    blit_glyph(image, bakedPixels, baked->width, baked->height, penPixel + baked->left, baseline + baked->top);
+    return 0;
+  }
+  SFT_CachedGlyph *cached = glyph_cache_get(sft, glyph, subpixel);
+  if (cached) {
+    blit_glyph(image, cached->pixels, cached->width, cached->height, penPixel + cached->left, baseline + cached->top);
+    return 0;
+  }
+  // Render glyphs that do not fit in the cache directly
+  SFT_GMetrics metrics;
+  if (sft_gmetrics(sft, glyph, &metrics) < 0) return -1;
+  uint8_t *char_pixels = calloc((size_t)metrics.minWidth * metrics.minHeight, 1);
+  if (!char_pixels) return -1;
+  SFT_Image charImage = {
+    .width = metrics.minWidth,
+    .height = metrics.minHeight,
+    .pixels = char_pixels
+  };
+  // Use the same quantized pen position as cached glyphs
+  double left = penPixel + (double)subpixel / GLYPH_CACHE_SUBPIXELS + metrics.leftSideBearing;
+  int glyph_start = fast_floor(left);
+  double xOffset = sft->xOffset;
+  sft->xOffset = left - glyph_start;
+  sft_render(sft, glyph, charImage);
+  sft->xOffset = xOffset;
+  blit_glyph(image, char_pixels, charImage.width, charImage.height, glyph_start, baseline + metrics.yOffset);
+  free(char_pixels);
+  return 0;
+}
+
+// Renders a UTF-8 string into an image using cached glyph bitmaps.
 int SFT_RenderUTF8(SFT *sft, uint8_t *text, SFT_Image image) {
   int i = 0;
   SFT_UChar charCode = 0;
   SFT_Glyph glyph = 0;
-  SFT_GMetrics metrics;
   SFT_Glyph lastGlyph = 0;
-  SFT_Kerning kerning;
+  double xScale = sft->xScale / sft->font->unitsPerEm;
   // Character start position from the left
   double charStart = 0;
-  // Glyph start position from the left
-  int glyph_start = 0;
-  double rounding_error = 0;
-  SFT_Image charImage;
-  uint8_t *target_pixels = image.pixels;
   SFT_LMetrics lmetrics;
   sft_lmetrics(sft, &lmetrics);
+  int baseline = (int)lmetrics.ascender;
 
   // Loop over the string
   while (text[i] != 0) {
     // Get the UTF-32 character code
     i += utf8_to_utf32(&text[i], &charCode);
     // Get the glyph for the character
-    if (glyph_id(sft->font, charCode, &glyph) < 0) return -1;
-    if (sft_gmetrics(sft, glyph, &metrics) < 0) return -1;
-    // Allocate memory for the character image
-    uint32_t num_pixels = (metrics.minWidth) * metrics.minHeight;
-    uint8_t *char_pixels = (uint8_t *)malloc(num_pixels * sizeof(uint8_t));
-    // Fill the pixels with 0
-    memset(char_pixels, 0, num_pixels);
-    charImage = (SFT_Image){
-      .width = metrics.minWidth,
-      .height = metrics.minHeight,
-      .pixels = char_pixels
-    };
-
+    if (lookup_glyph(sft->font, charCode, &glyph) < 0) return -1;
     if (lastGlyph != 0) {
-      if (sft_kerning(sft, lastGlyph, glyph, &kerning) < 0) return -1;
-      charStart += kerning.xShift;
+      charStart += (double)lookup_kerning(sft->font, lastGlyph, glyph) / sft->font->unitsPerEm * sft->xScale;
     }
-    glyph_start = fast_floor(charStart + metrics.leftSideBearing);
-    // Rounding error for subpixel placement
-    rounding_error = (charStart + metrics.leftSideBearing) - glyph_start;
-    sft->xOffset = rounding_error;
-    sft_render(sft, glyph, charImage);
-
-    // Copy the character pixels to the image
-    for (int y = 0; y < charImage.height; y++) {
-      int target_y = y + lmetrics.ascender + metrics.yOffset;
-      if (target_y < image.height) {
-        for (int x = 0; x < charImage.width; x++) {
-          int target_x = glyph_start + x;
-          if (target_x < image.width) {
-            uint8_t *target_pixel = &target_pixels[(target_y * image.width) + target_x];
-            if (x < charImage.width) {
-              uint8_t pixel = char_pixels[y * charImage.width + x];
-              // If glyphs overlap, take the maximum value
-              *target_pixel = *target_pixel > pixel ? *target_pixel : pixel;
-            }
-          }
-        }
-      }
+    if (render_glyph_at(sft, glyph, charStart, baseline, image) < 0) return -1;
+    charStart += lookup_advance(sft->font, glyph) * xScale;
+    lastGlyph = glyph;
+  }
+  return 0;
+}
+
+// Shapes length bytes of a UTF-8 string that does not have to be null terminated. For each character it stores the glyph id,
+// the pen position where the glyph is drawn (after kerning) and the byte offset of the character. ends[i] is the width of the
+// first i + 1 characters. Each array needs room for one entry per byte of text. Returns the number of characters or -1 on error.
+int SFT_ShapeUTF8(SFT *sft, const uint8_t *text, int length, SFT_Glyph *glyphs, double *pens, double *ends, int *offsets) {
+  SFT_Font *font = sft->font;
+  SFT_UChar charCode;
+  SFT_Glyph glyph;
+  SFT_Glyph lastGlyph = 0;
+  double xScale = sft->xScale / font->unitsPerEm;
+  double width = 0;
+  int i = 0;
+  int count = 0;
+  while (i < length) {
+    // Runs of ASCII bytes skip UTF-8 decoding and are looked up in the Latin-1 table
+    int asciiEnd = ascii_run_end(text, i, length);
+    for (; i < asciiEnd; i++) {
+      const SFT_LatinGlyph *latin = &font->latin[text[i]];
+      glyph = latin->glyph;
+      // Kerning is scaled the same way as in sft_kerning, most pairs have none
+      int kerningUnits = lastGlyph != 0 ? lookup_kerning(font, lastGlyph, glyph) : 0;
+      double kerning = kerningUnits != 0 ? (double)kerningUnits / font->unitsPerEm * sft->xScale : 0;
+      offsets[count] = i;
+      glyphs[count] = glyph;
+      pens[count] = width + kerning;
+      width = pens[count] + latin->advance * xScale;
+      ends[count] = width;
+      count++;
+      lastGlyph = glyph;
+    }
+    if (i >= length) break;
+
+    offsets[count] = i;
+    int step = utf8_to_utf32(&text[i], &charCode);
+    // Step over invalid bytes one at a time
+    if (step == 0 || i + step > length) {
+      step = 1;
+      charCode = 0xFFFD;
+    }
+    i += step;
+    if (charCode < 256) {
+      glyph = font->latin[charCode].glyph;
+    } else if (lookup_glyph(font, charCode, &glyph) < 0) {
+      return -1;
     }
-    // Free the image pixels
-    free(char_pixels);
-    charStart += metrics.advanceWidth;
+    int kerningUnits = lastGlyph != 0 ? lookup_kerning(font, lastGlyph, glyph) : 0;
+    double kerning = kerningUnits != 0 ? (double)kerningUnits / font->unitsPerEm * sft->xScale : 0;
+    glyphs[count] = glyph;
+    pens[count] = width + kerning;
+    width = pens[count] + lookup_advance(font, glyph) * xScale;
+    ends[count] = width;
+    count++;
     lastGlyph = glyph;
   }
+  return count;
+}
+
+// Renders shaped glyphs into an image. The pen positions are moved by x pixels, so a part of a shaped string can be drawn
+// at the left edge of the image by passing the negated pen position of its first glyph. The baseline is moved down by
+// y pixels, so an image that only covers the visible part of a line can be drawn by passing a negative y.
+int SFT_RenderShaped(SFT *sft, const SFT_Glyph *glyphs, const double *pens, int count, double x, int y, SFT_Image image) {
+  SFT_LMetrics lmetrics;
+  sft_lmetrics(sft, &lmetrics);
+  int baseline = (int)lmetrics.ascender + y;
+  for (int i = 0; i < count; i++) {
+    if (render_glyph_at(sft, glyphs[i], pens[i] + x, baseline, image) < 0) return -1;
+  }
   return 0;
 }
 
@@ -0,0 +1,231 @@
+#ifndef C9_TEXT_RASTER
+
+#include <SDL2/SDL.h> // SDL_Rect
+#include <stdbool.h> // bool
+#include <stdlib.h> // malloc, realloc, free
+#include <string.h> // memcmp, memcpy, memmove, memset
+#include "color.c" // RGBA
+#include "font.c" // on_close_fonts
+#include "draw_shapes.c" // PixelData, TextCoverage, get_text_area, rasterize_text, blend_text_coverage, draw_text, draw_multiline_text
+#include "string.c" // s8
+#include "types.c" // i32, i64, u8, u64
+#include "types_common.c" // Padding
+
+/*
+
+The text raster cache keeps the coverage of the text of an element after it has been rasterized, so that an element that is drawn again with the same text, font variant and text position (like a menu item whose background changes on hover) only blends the coverage over its new background. The color is not part of the key, so changing the text color does not rasterize the text again either.
+
+Coverages are kept in an LRU cache that is shared by all elements and limited to TEXT_RASTER_CACHE_CAPACITY bytes. Texts longer than TEXT_RASTER_MAX_TEXT bytes are always drawn directly, since they are seldom drawn the same way twice and their key would be as large as their coverage.
+
+*/
+
+#define TEXT_RASTER_BUCKETS 512 // Must be a power of two
+#define TEXT_RASTER_CACHE_CAPACITY (4 * 1024 * 1024)
+#define TEXT_RASTER_MAX_TEXT 4096
+
+typedef struct TextRaster TextRaster;
+struct TextRaster {
+  u64 hash;
+  u8 font_variant;
+  bool multiline;
+  SDL_Rect text_position;
+  Padding padding;
+  i32 target_width;
+  i32 target_height;
+  s8 text; // Copy of the text, in the same allocation
+  TextCoverage coverage; // Cropped to the pixels the text covers, after the text in the same allocation
+  i64 bytes; // Size of the allocation
+  TextRaster *hash_next;
+  TextRaster *lru_prev;
+  TextRaster *lru_next;
+};
+
+typedef struct {
+  TextRaster *buckets[TEXT_RASTER_BUCKETS];
+  TextRaster *lru_head; // Most recently used raster
+  TextRaster *lru_tail; // Least recently used raster
+  i64 bytes;
+  i64 capacity;
+  u64 hits;
+  u64 misses;
+} TextRasterCache;
+
+TextRasterCache text_raster_cache = {.capacity = TEXT_RASTER_CACHE_CAPACITY};
+
+static u64 hash_text_raster(u8 font_variant, bool multiline, SDL_Rect text_position, Padding padding, PixelData target, s8 text) {
+  // FNV-1a
+  u64 hash = 14695981039346656037ULL ^ font_variant;
+  i32 key[] = {multiline, text_position.x, text_position.y, text_position.w, text_position.h, padding.left, padding.right, target.width, target.height};
+  for (i32 i = 0; i < (i32)(sizeof(key) / sizeof(key[0])); i++) {
+    hash = (hash ^ (u32)key[i]) * 1099511628211ULL;
+  }
+  for (i32 i = 0; i < text.length; i++) {
+    hash = (hash ^ text.data[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static void unlink_text_raster(TextRaster *raster) {
+  if (raster->lru_prev != 0) {
+    raster->lru_prev->lru_next = raster->lru_next;
+  } else {
+    text_raster_cache.lru_head = raster->lru_next;
+  }
+  if (raster->lru_next != 0) {
+    raster->lru_next->lru_prev = raster->lru_prev;
+  } else {
+    text_raster_cache.lru_tail = raster->lru_prev;
+  }
+  raster->lru_prev = 0;
+  raster->lru_next = 0;
+}
+
+static void push_text_raster(TextRaster *raster) {
+  raster->lru_prev = 0;
+  raster->lru_next = text_raster_cache.lru_head;
+  if (text_raster_cache.lru_head != 0) {
+    text_raster_cache.lru_head->lru_prev = raster;
+  } else {
+    text_raster_cache.lru_tail = raster;
+  }
+  text_raster_cache.lru_head = raster;
+}
+
+// Removes the least recently used raster from the cache and frees it
+static void evict_text_raster(void) {
+  TextRaster *raster = text_raster_cache.lru_tail;
+  TextRaster **link = &text_raster_cache.buckets[raster->hash & (TEXT_RASTER_BUCKETS - 1)];
+  while (*link != raster) {
+    link = &(*link)->hash_next;
+  }
+  *link = raster->hash_next;
+  unlink_text_raster(raster);
+  text_raster_cache.bytes -= raster->bytes;
+  free(raster);
+}
+
+// Frees every raster in the cache
+void clear_text_raster_cache(void) {
+  while (text_raster_cache.lru_tail != 0) {
+    evict_text_raster();
+  }
+}
+
+// Sets the memory limit of the cache in bytes, evicting rasters until it fits. A capacity of 0 turns the cache off.
+void set_text_raster_cache_capacity(i64 capacity) {
+  text_raster_cache.capacity = capacity;
+  while (text_raster_cache.lru_tail != 0 && text_raster_cache.bytes > capacity) {
+    evict_text_raster();
+  }
+}
+
+// Crops the coverage of a raster to the pixels that the text covers and shrinks its allocation
+static TextRaster *crop_text_raster(TextRaster *raster) {
+  TextCoverage coverage = raster->coverage;
+  i32 left = coverage.rect.w;
+  i32 right = 0;
+  i32 top = coverage.rect.h;
+  i32 bottom = 0;
+  for (i32 y = 0; y < coverage.rect.h; y++) {
+    u8 *row = coverage.pixels + y * coverage.rect.w;
+    for (i32 x = 0; x < coverage.rect.w; x++) {
+      if (row[x] == 0) continue;
+      if (x < left) left = x;
+      if (x >= right) right = x + 1;
+      if (y < top) top = y;
+      bottom = y + 1;
+    }
+  }
+  SDL_Rect rect = {0};
+  if (left < right) {
+    rect = (SDL_Rect){coverage.rect.x + left, coverage.rect.y + top, right - left, bottom - top};
+  }
+  // The cropped rows start at the front of the coverage
+  for (i32 y = 0; y < rect.h; y++) {
+    memmove(coverage.pixels + y * rect.w, coverage.pixels + (top + y) * coverage.rect.w + left, rect.w);
+  }
+  i64 bytes = sizeof(TextRaster) + raster->text.length + (i64)rect.w * rect.h;
+  TextRaster *cropped = realloc(raster, bytes);
+  if (cropped == 0) {
+    cropped = raster;
+  }
+  cropped->text.data = (u8 *)(cropped + 1);
+  cropped->coverage = (TextCoverage){.pixels = cropped->text.data + cropped->text.length, .rect = rect};
+  cropped->bytes = bytes;
+  return cropped;
+}
+
+// Returns the cached coverage of the text at a position in a target, rasterizing it if it is not in the cache
+static TextRaster *get_text_raster(PixelData target, u8 font_variant, s8 text, SDL_Rect text_position, Padding padding, bool multiline) {
+  u64 hash = hash_text_raster(font_variant, multiline, text_position, padding, target, text);
+  TextRaster **bucket = &text_raster_cache.buckets[hash & (TEXT_RASTER_BUCKETS - 1)];
+  for (TextRaster *raster = *bucket; raster != 0; raster = raster->hash_next) {
+    if (raster->hash == hash && raster->font_variant == font_variant && raster->multiline == multiline &&
+        raster->text_position.x == text_position.x && raster->text_position.y == text_position.y &&
+        raster->text_position.w == text_position.w && raster->text_position.h == text_position.h &&
+        raster->padding.left == padding.left && raster->padding.right == padding.right &&
+        raster->target_width == target.width && raster->target_height == target.height &&
+        raster->text.length == text.length && memcmp(raster->text.data, text.data, text.length) == 0) {
+      unlink_text_raster(raster);
+      push_text_raster(raster);
+      text_raster_cache.hits++;
+      return raster;
+    }
+  }
+  text_raster_cache.misses++;
+
+  SDL_Rect area = get_text_area(target, text_position, padding);
+  i64 coverage_bytes = (i64)area.w * area.h;
+  i64 bytes = sizeof(TextRaster) + text.length + coverage_bytes;
+  if (bytes > text_raster_cache.capacity) return 0;
+  TextRaster *raster = malloc(bytes);
+  if (raster == 0) return 0;
+  u8 *text_copy = (u8 *)(raster + 1);
+  u8 *coverage_pixels = text_copy + text.length;
+  memcpy(text_copy, text.data, text.length);
+  memset(coverage_pixels, 0, coverage_bytes);
+  *raster = (TextRaster){
+    .hash = hash,
+    .font_variant = font_variant,
+    .multiline = multiline,
+    .text_position = text_position,
+    .padding = padding,
+    .target_width = target.width,
+    .target_height = target.height,
+    .text = {.data = text_copy, .length = text.length},
+    .coverage = {.pixels = coverage_pixels, .rect = area},
+    .bytes = bytes,
+  };
+  if (coverage_bytes > 0) {
+    rasterize_text(target, &raster->coverage, font_variant, text, text_position, padding, multiline);
+    raster = crop_text_raster(raster);
+  }
+  while (text_raster_cache.lru_tail != 0 && text_raster_cache.bytes + raster->bytes > text_raster_cache.capacity) {
+    evict_text_raster();
+  }
+  raster->hash_next = *bucket;
+  *bucket = raster;
+  push_text_raster(raster);
+  text_raster_cache.bytes += raster->bytes;
+  on_close_fonts(&clear_text_raster_cache);
+  return raster;
+}
+
+// Draws text like draw_text (or draw_multiline_text if multiline is set), reusing the coverage of the last time it was drawn at the same position in a target of the same size
+void draw_cached_text(PixelData target, u8 font_variant, s8 text, RGBA color, SDL_Rect text_position, Padding padding, bool multiline) {
+  if (text.data == 0 || text.length <= 0) return;
+  TextRaster *raster = 0;
+  if (text.length <= TEXT_RASTER_MAX_TEXT) {
+    raster = get_text_raster(target, font_variant, text, text_position, padding, multiline);
+  }
+  if (raster != 0) {
+    blend_text_coverage(target, raster->coverage, color);
+  } else if (multiline) {
+    draw_multiline_text(target, font_variant, text, color, text_position, padding);
+  } else {
+    draw_text(target, font_variant, text, color, text_position, padding);
+  }
+}
+
+#define C9_TEXT_RASTER
+#endif
@@ -0,0 +1,341 @@
+#ifndef C9_TEXT_RUN
+
+#include <math.h> // ceil
+#include <stdbool.h> // bool
+#include <string.h> // memcmp, memcpy, memset
+#include "arena.c" // Arena, arena_open, arena_fill, arena_close, arena_capacity
+#include "array.c" // Array
+#include "font.c" // get_sft, on_close_fonts
+#include "schrift.c" // SFT, SFT_Glyph, SFT_ShapeUTF8
+#include "string.c" // s8
+#include "types.c" // i32, u8, u64, f64
+#include "types_common.c" // Line
+
+/*
+
+A text run is a string shaped with one font variant: the glyph id, pen position and byte offset of every character, and the width of the text after each character. A run is shaped once and then shared by measuring, wrapping, caret placement, selection and painting, which all become lookups into its arrays.
+
+Runs are kept in a global LRU cache keyed by the font variant and the text content, so strings that are not null terminated (like input lines) can be shaped without copying them first. shape_text_run only reads the font, so a run can be shaped on another thread and moved into the cache with add_text_run (see text_worker.c). The cache holds at most TEXT_RUN_CACHE_SIZE runs, and the arenas of the cached runs (about 25 bytes per byte of text) are charged against TEXT_RUN_CACHE_BYTES, so that a few large texts can not hold on to hundreds of MB. When a new run is added, the least recently used runs are evicted until the cache fits, but the last TEXT_RUN_CACHE_MIN_RUNS runs are always kept. A run returned by get_text_run stays valid until that many other runs have been shaped, so it should not be kept between frames.
+
+*/
+
+#define TEXT_RUN_CACHE_SIZE 1024
+#define TEXT_RUN_CACHE_BYTES (64 * 1024 * 1024) // Memory budget for the arenas of all cached runs
+#define TEXT_RUN_CACHE_MIN_RUNS 16 // Most recently used runs that are kept even if the budget is exceeded
+#define TEXT_RUN_BUCKETS 2048 // Must be a power of two
+
+typedef struct TextRun TextRun;
+
+struct TextRun {
+  u8 font_variant;
+  s8 text; // Copy of the shaped text
+  i32 glyph_count; // Number of characters in the text
+  SFT_Glyph *glyphs; // Glyph id of each character
+  f64 *pens; // Pen position of each character, where its glyph is drawn
+  f64 *ends; // Width of the text up to and including each character
+  i32 *offsets; // Byte offset of each character, plus the text length as a last entry
+  i32 width; // Width of the whole text in pixels, rounded up
+  Array *lines; // Lines of the last wrap (Line), 0 if the run has not been wrapped
+  i32 wrap_width; // Maximum width the lines were wrapped at
+  Arena *wrap_arena; // Holds the lines, opened on the first wrap
+  u64 hash; // Hash of the font variant and text
+  Arena *arena; // Holds the text copy and the arrays
+  i32 size; // Bytes of the arenas that are charged to the cache
+  bool cached; // If the run is in the cache
+  TextRun *hash_next; // Next run in the same bucket
+  TextRun *lru_prev; // Towards the most recently used run
+  TextRun *lru_next; // Towards the least recently used run
+};
+
+typedef struct {
+  TextRun runs[TEXT_RUN_CACHE_SIZE];
+  TextRun *buckets[TEXT_RUN_BUCKETS];
+  TextRun *lru_head; // Most recently used run
+  TextRun *lru_tail; // Least recently used run
+  TextRun *free_runs; // Slots of evicted runs, linked through hash_next
+  i32 run_count; // Number of slots that have been used
+  i32 cached_count; // Number of runs in the cache
+  i64 size; // Bytes of the arenas of all cached runs
+} TextRunCache;
+
+TextRunCache text_run_cache = {0};
+
+static u64 hash_text_run(u8 font_variant, s8 text) {
+  // FNV-1a over 8 bytes at a time, so that looking up a large text each frame stays cheap
+  u64 hash = 14695981039346656037ULL ^ font_variant;
+  i32 i = 0;
+  for (; i + 8 <= text.length; i += 8) {
+    u64 word;
+    memcpy(&word, text.data + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211ULL;
+    hash ^= hash >> 32;
+  }
+  for (; i < text.length; i++) {
+    hash = (hash ^ text.data[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static void unlink_text_run(TextRun *run) {
+  if (run->lru_prev != 0) {
+    run->lru_prev->lru_next = run->lru_next;
+  } else {
+    text_run_cache.lru_head = run->lru_next;
+  }
+  if (run->lru_next != 0) {
+    run->lru_next->lru_prev = run->lru_prev;
+  } else {
+    text_run_cache.lru_tail = run->lru_prev;
+  }
+  run->lru_prev = 0;
+  run->lru_next = 0;
+}
+
+static void push_text_run(TextRun *run) {
+  run->lru_prev = 0;
+  run->lru_next = text_run_cache.lru_head;
+  if (text_run_cache.lru_head != 0) {
+    text_run_cache.lru_head->lru_prev = run;
+  } else {
+    text_run_cache.lru_tail = run;
+  }
+  text_run_cache.lru_head = run;
+}
+
+// Returns the bytes held by the arenas of a run
+static i32 get_text_run_size(TextRun *run) {
+  i32 size = arena_capacity(run->arena);
+  if (run->wrap_arena != 0) {
+    size += arena_capacity(run->wrap_arena);
+  }
+  return size;
+}
+
+// Removes a run from the cache, frees its arenas and adds its slot to the free slots
+static void remove_text_run(TextRun *run) {
+  TextRun **link = &text_run_cache.buckets[run->hash & (TEXT_RUN_BUCKETS - 1)];
+  while (*link != run) {
+    link = &(*link)->hash_next;
+  }
+  *link = run->hash_next;
+  unlink_text_run(run);
+  arena_close(run->arena);
+  if (run->wrap_arena != 0) {
+    arena_close(run->wrap_arena);
+  }
+  text_run_cache.size -= run->size;
+  text_run_cache.cached_count--;
+  run->cached = false;
+  run->hash_next = text_run_cache.free_runs;
+  text_run_cache.free_runs = run;
+}
+
+// Charges the cache for the arenas that a cached run has grown since it was added, like the lines of a new wrap
+void update_text_run_size(TextRun *run) {
+  if (!run->cached) return;
+  i32 size = get_text_run_size(run);
+  text_run_cache.size += size - run->size;
+  run->size = size;
+}
+
+// Evicts the least recently used runs until the cache fits in its memory budget
+static void trim_text_run_cache(void) {
+  while (text_run_cache.size > TEXT_RUN_CACHE_BYTES && text_run_cache.cached_count > TEXT_RUN_CACHE_MIN_RUNS) {
+    remove_text_run(text_run_cache.lru_tail);
+  }
+}
+
+// Frees all cached runs
+void clear_text_run_cache(void) {
+  while (text_run_cache.lru_tail != 0) {
+    remove_text_run(text_run_cache.lru_tail);
+  }
+  memset(&text_run_cache, 0, sizeof(text_run_cache));
+}
+
+// Returns the cached run of the text, or 0 if it has not been shaped
+static TextRun *find_cached_text_run(u8 font_variant, s8 text, u64 hash) {
+  TextRun **bucket = &text_run_cache.buckets[hash & (TEXT_RUN_BUCKETS - 1)];
+  for (TextRun *run = *bucket; run != 0; run = run->hash_next) {
+    if (run->hash == hash && run->font_variant == font_variant && run->text.length == text.length &&
+        memcmp(run->text.data, text.data, text.length) == 0) {
+      if (text_run_cache.lru_head != run) {
+        unlink_text_run(run);
+        push_text_run(run);
+      }
+      return run;
+    }
+  }
+  return 0;
+}
+
+// Shapes the text into a run that is not in the cache. Only the font is read, so runs can be shaped on another thread and added with add_text_run.
+void shape_text_run(TextRun *run, SFT *sft, u8 font_variant, s8 text) {
+  if (text.data == 0 || text.length < 0) {
+    text.length = 0;
+  }
+  // One allocation holds the text and all arrays, with room for one character per byte
+  i32 capacity = text.length + 1;
+  Arena *arena = arena_open(capacity * (sizeof(SFT_Glyph) + 2 * sizeof(f64) + sizeof(i32) + 1) + 64);
+  *run = (TextRun){
+    .font_variant = font_variant,
+    .text = {
+      .data = arena_fill(arena, capacity),
+      .length = text.length,
+      .capacity = 0,
+    },
+    .glyphs = arena_fill(arena, capacity * sizeof(SFT_Glyph)),
+    .pens = arena_fill(arena, capacity * sizeof(f64)),
+    .ends = arena_fill(arena, capacity * sizeof(f64)),
+    .offsets = arena_fill(arena, capacity * sizeof(i32)),
+    .hash = hash_text_run(font_variant, text),
+    .arena = arena,
+  };
+  if (text.length > 0) {
+    memcpy(run->text.data, text.data, text.length);
+  }
+  run->text.data[text.length] = '\0';
+  i32 glyph_count = SFT_ShapeUTF8(sft, run->text.data, text.length, run->glyphs, run->pens, run->ends, run->offsets);
+  run->glyph_count = glyph_count > 0 ? glyph_count : 0;
+  run->offsets[run->glyph_count] = text.length;
+  if (run->glyph_count > 0) {
+    run->width = (i32)ceil(run->ends[run->glyph_count - 1]);
+  }
+}
+
+// Moves a run from shape_text_run into the cache, replacing the cached run of the same text. Returns the cached run.
+TextRun *add_text_run(TextRun *shaped) {
+  TextRun *run = find_cached_text_run(shaped->font_variant, shaped->text, shaped->hash);
+  if (run != 0) {
+    // Keep the slot and its place in the bucket and the LRU list
+    arena_close(run->arena);
+    if (run->wrap_arena != 0) {
+      arena_close(run->wrap_arena);
+    }
+    TextRun links = *run;
+    *run = *shaped;
+    run->hash_next = links.hash_next;
+    run->lru_prev = links.lru_prev;
+    run->lru_next = links.lru_next;
+    run->cached = true;
+    run->size = links.size;
+    update_text_run_size(run);
+    trim_text_run_cache();
+    return run;
+  }
+  if (text_run_cache.free_runs == 0 && text_run_cache.run_count == TEXT_RUN_CACHE_SIZE) {
+    remove_text_run(text_run_cache.lru_tail);
+  }
+  if (text_run_cache.free_runs != 0) {
+    run = text_run_cache.free_runs;
+    text_run_cache.free_runs = run->hash_next;
+  } else {
+    run = &text_run_cache.runs[text_run_cache.run_count++];
+  }
+  *run = *shaped;
+  TextRun **bucket = &text_run_cache.buckets[run->hash & (TEXT_RUN_BUCKETS - 1)];
+  run->hash_next = *bucket;
+  *bucket = run;
+  push_text_run(run);
+  run->cached = true;
+  run->size = get_text_run_size(run);
+  text_run_cache.size += run->size;
+  text_run_cache.cached_count++;
+  trim_text_run_cache();
+  on_close_fonts(&clear_text_run_cache);
+  return run;
+}
+
+// Returns the cached run of the text without shaping it, or 0 if it is not in the cache
+TextRun *find_text_run(u8 font_variant, s8 text) {
+  if (text.data == 0 || text.length < 0) {
+    text.length = 0;
+  }
+  return find_cached_text_run(font_variant, text, hash_text_run(font_variant, text));
+}
+
+// Returns the shaped run of the text, shaping it if it is not in the cache. Returns 0 if the font could not be loaded.
+TextRun *get_text_run(u8 font_variant, s8 text) {
+  if (text.data == 0 || text.length < 0) {
+    text.length = 0;
+  }
+  TextRun *run = find_cached_text_run(font_variant, text, hash_text_run(font_variant, text));
+  if (run != 0) return run;
+  SFT *sft = get_sft(font_variant);
+  if (sft == 0) return 0;
+  TextRun shaped;
+  shape_text_run(&shaped, sft, font_variant, text);
+  return add_text_run(&shaped);
+}
+
+// Returns the width of the text in pixels, rounded up
+i32 get_text_width(u8 font_variant, s8 text) {
+  TextRun *run = get_text_run(font_variant, text);
+  if (run == 0) return 0;
+  return run->width;
+}
+
+// Returns the index of the character that starts at or after a byte index
+i32 get_text_run_index(TextRun *run, i32 byte_index) {
+  i32 low = 0;
+  i32 high = run->glyph_count;
+  while (low < high) {
+    i32 mid = (low + high) / 2;
+    if (run->offsets[mid] < byte_index) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Returns the width of the first characters of the run
+f64 get_text_run_x(TextRun *run, i32 character_index) {
+  if (character_index <= 0) return 0;
+  if (character_index > run->glyph_count) {
+    character_index = run->glyph_count;
+  }
+  return run->ends[character_index - 1];
+}
+
+// Returns the index of the first character that ends after x, or the character count if no character does
+i32 get_text_run_index_at_x(TextRun *run, f64 x) {
+  i32 low = 0;
+  i32 high = run->glyph_count;
+  while (low < high) {
+    i32 mid = (low + high) / 2;
+    if (run->ends[mid] <= x) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Returns the width of the text before a byte index in pixels, rounded up like SFT_text_width
+i32 get_text_run_prefix_width(TextRun *run, i32 byte_index) {
+  return (i32)ceil(get_text_run_x(run, get_text_run_index(run, byte_index)));
+}
+
+// Returns how many characters from start_character fit within max_width, measured from the pen position of the first character
+i32 get_text_run_fit(TextRun *run, i32 start_character, i32 max_width) {
+  if (start_character >= run->glyph_count) return 0;
+  f64 start = run->pens[start_character];
+  // Binary search for the first character that ends outside max_width
+  i32 low = start_character;
+  i32 high = run->glyph_count;
+  while (low < high) {
+    i32 mid = (low + high) / 2;
+    if (run->ends[mid] - start < max_width) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low - start_character;
+}
+
+#define C9_TEXT_RUN
+#endif
@@ -0,0 +1,325 @@
+#ifndef C9_TEXT_WORKER
+
+#include <SDL2/SDL.h> // SDL_Thread, SDL_mutex, SDL_cond, SDL_Event, SDL_CreateThread, SDL_WaitThread, SDL_CreateMutex, SDL_CreateCond, SDL_CondWait, SDL_CondSignal, SDL_PushEvent, SDL_RegisterEvents
+#include <stdbool.h> // bool
+#include <stdio.h> // printf
+#include <stdlib.h> // malloc, free
+#include <string.h> // memchr, memcmp, memcpy, memmove, memset
+#include "array.c" // Array
+#include "element_tree.c" // ElementTree, Element
+#include "font.c" // get_sft
+#include "font_layout.c" // wrap_text_run, get_text_lines_height, get_text_block_height
+#include "schrift.c" // sft_scratch_free
+#include "string.c" // s8
+#include "text_run.c" // TextRun, shape_text_run, add_text_run, find_text_run, get_text_run, get_text_width
+#include "types.c" // i32, u8, u32, f64
+
+/*
+
+The text worker shapes and wraps large texts on a background thread, so that a label with hundreds of KB of text does not block layout and drawing the first time it is shown or after every resize. Texts of at least TEXT_WORKER_MIN_LENGTH bytes are sent to the worker, smaller texts are still laid out on the calling thread.
+
+Until the worker is done, layout uses an estimated width and height (from the average advance of the start of the text and the length of each paragraph), and the text is drawn with the lines of the last layout, or not at all if it has never been laid out. When a layout is done, the worker pushes a TEXT_WORKER_EVENT so that handle_events wakes up and calls apply_text_layouts. That moves the run into the text run cache, marks the elements that show the text as changed and lays out the tree again. get_pending_text_layouts and text_worker.completed can be shown as progress.
+
+The worker copies the text of every layout, so the elements can change or free their text at any time. The fonts must stay loaded until close_text_worker is called.
+
+```c
+init_text_worker(); // After init_fonts
+...
+close_text_worker(); // Before close_fonts
+```
+
+*/
+
+#define TEXT_WORKER_MIN_LENGTH (64 * 1024) // Texts of at least this many bytes are laid out on the worker
+#define TEXT_WORKER_MAX_JOBS 16 // Layouts that can be pending, running or waiting to be applied
+#define TEXT_WORKER_SAMPLE_LENGTH 4096 // Bytes at the start of a text used to estimate its advance
+
+typedef struct {
+  u8 font_variant;
+  SFT sft;
+  s8 text; // Copy of the text, owned by the job
+  i32 max_width; // Width the lines are wrapped at
+  TextRun run; // Shaped and wrapped by the worker
+} TextJob;
+
+typedef struct {
+  SDL_Thread *thread;
+  SDL_mutex *mutex;
+  SDL_cond *wake; // Signaled when a job is added or the worker should quit
+  TextJob *pending[TEXT_WORKER_MAX_JOBS]; // Oldest first
+  i32 pending_count;
+  TextJob *running;
+  TextJob *done[TEXT_WORKER_MAX_JOBS];
+  i32 done_count;
+  bool quit;
+  u32 event_type; // Pushed when a job is done
+  u32 completed; // Number of layouts applied
+} TextWorker;
+
+TextWorker text_worker = {0};
+
+#define TEXT_WORKER_EVENT (text_worker.event_type)
+
+// Shapes and wraps one text at a time until close_text_worker is called
+static int run_text_worker(void *data) {
+  (void)data;
+  SDL_LockMutex(text_worker.mutex);
+  while (true) {
+    while (!text_worker.quit && text_worker.pending_count == 0) {
+      SDL_CondWait(text_worker.wake, text_worker.mutex);
+    }
+    if (text_worker.quit) break;
+    TextJob *job = text_worker.pending[0];
+    text_worker.pending_count--;
+    memmove(text_worker.pending, text_worker.pending + 1, text_worker.pending_count * sizeof(TextJob *));
+    text_worker.running = job;
+    SDL_UnlockMutex(text_worker.mutex);
+
+    shape_text_run(&job->run, &job->sft, job->font_variant, job->text);
+    wrap_text_run(&job->run, job->max_width);
+
+    SDL_LockMutex(text_worker.mutex);
+    text_worker.running = 0;
+    text_worker.done[text_worker.done_count++] = job;
+    SDL_Event event = {.type = text_worker.event_type};
+    SDL_PushEvent(&event);
+  }
+  SDL_UnlockMutex(text_worker.mutex);
+  // The rasterizer scratch is per thread
+  sft_scratch_free();
+  return 0;
+}
+
+// Starts the worker thread. Large texts are laid out on the calling thread until this is called.
+bool init_text_worker(void) {
+  if (text_worker.thread != 0) return true;
+  text_worker.event_type = SDL_RegisterEvents(1);
+  text_worker.mutex = SDL_CreateMutex();
+  text_worker.wake = SDL_CreateCond();
+  if (text_worker.event_type == (u32)-1 || text_worker.mutex == 0 || text_worker.wake == 0) {
+    printf("Failed to start text worker: %s\n", SDL_GetError());
+    return false;
+  }
+  text_worker.thread = SDL_CreateThread(run_text_worker, "text worker", 0);
+  if (text_worker.thread == 0) {
+    printf("Failed to start text worker: %s\n", SDL_GetError());
+    return false;
+  }
+  return true;
+}
+
+static void free_text_job(TextJob *job, bool shaped) {
+  if (shaped) {
+    arena_close(job->run.arena);
+    if (job->run.wrap_arena != 0) {
+      arena_close(job->run.wrap_arena);
+    }
+  }
+  free(job->text.data);
+  free(job);
+}
+
+// Waits for the running layout, stops the worker and drops the layouts that have not been applied
+void close_text_worker(void) {
+  if (text_worker.thread == 0) return;
+  SDL_LockMutex(text_worker.mutex);
+  text_worker.quit = true;
+  SDL_CondSignal(text_worker.wake);
+  SDL_UnlockMutex(text_worker.mutex);
+  SDL_WaitThread(text_worker.thread, 0);
+  for (i32 i = 0; i < text_worker.pending_count; i++) {
+    free_text_job(text_worker.pending[i], false);
+  }
+  for (i32 i = 0; i < text_worker.done_count; i++) {
+    free_text_job(text_worker.done[i], true);
+  }
+  SDL_DestroyCond(text_worker.wake);
+  SDL_DestroyMutex(text_worker.mutex);
+  memset(&text_worker, 0, sizeof(text_worker));
+}
+
+// Returns true if the text is laid out on the worker
+static bool is_worker_text(s8 text) {
+  return text_worker.thread != 0 && text.data != 0 && text.length >= TEXT_WORKER_MIN_LENGTH;
+}
+
+static bool is_job_text(TextJob *job, u8 font_variant, s8 text) {
+  return job->font_variant == font_variant && job->text.length == text.length && memcmp(job->text.data, text.data, text.length) == 0;
+}
+
+// Queues a layout of the text at a width, unless the same layout is already queued or running.
+// A queued layout of the same text that has not started yet is moved to the new width. With any_width, a layout at any width is enough.
+static void request_text_layout(u8 font_variant, s8 text, i32 max_width, bool any_width) {
+  SFT *sft = get_sft(font_variant);
+  if (sft == 0) return;
+  SDL_LockMutex(text_worker.mutex);
+  bool queued = false;
+  for (i32 i = 0; i < text_worker.pending_count && !queued; i++) {
+    TextJob *job = text_worker.pending[i];
+    if (is_job_text(job, font_variant, text)) {
+      if (!any_width) {
+        job->max_width = max_width;
+      }
+      queued = true;
+    }
+  }
+  TextJob *running = text_worker.running;
+  if (running != 0 && is_job_text(running, font_variant, text) && (any_width || running->max_width == max_width)) {
+    queued = true;
+  }
+  for (i32 i = 0; i < text_worker.done_count && !queued; i++) {
+    TextJob *job = text_worker.done[i];
+    queued = is_job_text(job, font_variant, text) && (any_width || job->max_width == max_width);
+  }
+  i32 job_count = text_worker.pending_count + text_worker.done_count + (running != 0 ? 1 : 0);
+  // When the queue is full the layout is requested again by the next layout pass
+  if (!queued && job_count < TEXT_WORKER_MAX_JOBS) {
+    TextJob *job = malloc(sizeof(TextJob));
+    u8 *text_copy = malloc(text.length);
+    if (job != 0 && text_copy != 0) {
+      memcpy(text_copy, text.data, text.length);
+      *job = (TextJob){
+        .font_variant = font_variant,
+        .sft = *sft,
+        .text = {.data = text_copy, .length = text.length},
+        .max_width = max_width,
+      };
+      text_worker.pending[text_worker.pending_count++] = job;
+      SDL_CondSignal(text_worker.wake);
+    } else {
+      free(job);
+      free(text_copy);
+    }
+  }
+  SDL_UnlockMutex(text_worker.mutex);
+}
+
+// Returns the number of layouts that are queued, running or waiting to be applied
+i32 get_pending_text_layouts(void) {
+  if (text_worker.thread == 0) return 0;
+  SDL_LockMutex(text_worker.mutex);
+  i32 count = text_worker.pending_count + text_worker.done_count + (text_worker.running != 0 ? 1 : 0);
+  SDL_UnlockMutex(text_worker.mutex);
+  return count;
+}
+
+// Returns the average advance of the characters at the start of the text
+static f64 get_sample_advance(u8 font_variant, s8 text) {
+  s8 sample = text;
+  if (sample.length > TEXT_WORKER_SAMPLE_LENGTH) {
+    sample.length = TEXT_WORKER_SAMPLE_LENGTH;
+    // End the sample at a character boundary
+    while (sample.length > 0 && has_continuation_byte(sample.data[sample.length])) {
+      sample.length--;
+    }
+  }
+  if (sample.length == 0) return 0;
+  return (f64)get_text_width(font_variant, sample) / sample.length;
+}
+
+// Estimates the number of lines of the text at a width from the length of each paragraph
+// A width of 0 or less is estimated as a single line, like a text without a width limit
+static i32 estimate_text_line_count(u8 font_variant, s8 text, i32 max_width) {
+  if (max_width <= 0) return 1;
+  f64 advance = get_sample_advance(font_variant, text);
+  i32 line_count = 0;
+  u8 *paragraph = text.data;
+  u8 *text_end = text.data + text.length;
+  while (paragraph <= text_end) {
+    u8 *newline = memchr(paragraph, '\n', text_end - paragraph);
+    u8 *paragraph_end = newline != 0 ? newline : text_end;
+    f64 paragraph_width = (paragraph_end - paragraph) * advance;
+    i32 paragraph_lines = (i32)(paragraph_width / max_width) + 1;
+    line_count += paragraph_lines;
+    paragraph = paragraph_end + 1;
+  }
+  return line_count;
+}
+
+// Returns the cached run of a large text, queuing a layout at max_width if it is missing or was wrapped at another width.
+// Returns 0 until the text has been shaped. Small texts are shaped on the calling thread.
+TextRun *get_text_run_async(u8 font_variant, s8 text, i32 max_width) {
+  if (!is_worker_text(text)) return get_text_run(font_variant, text);
+  TextRun *run = find_text_run(font_variant, text);
+  if (run == 0 || run->lines == 0 || run->wrap_width != max_width) {
+    request_text_layout(font_variant, text, max_width, false);
+  }
+  return run;
+}
+
+// Returns the cached run of a large text at any width, queuing a layout if it has not been shaped.
+// Returns 0 until the text has been shaped. Small texts are shaped on the calling thread.
+TextRun *get_shaped_text_run_async(u8 font_variant, s8 text) {
+  if (!is_worker_text(text)) return get_text_run(font_variant, text);
+  TextRun *run = find_text_run(font_variant, text);
+  if (run == 0) {
+    request_text_layout(font_variant, text, 0, true);
+  }
+  return run;
+}
+
+// Returns the lines of a run at max_width. Runs of large texts keep the lines of their last layout until the worker has
+// wrapped them at the new width, and have no lines (0) before their first layout.
+Array *wrap_text_run_async(TextRun *run, i32 max_width) {
+  if (!is_worker_text(run->text)) return wrap_text_run(run, max_width);
+  return run->lines;
+}
+
+// Returns the width of the text in pixels, or an estimate while a large text is being shaped
+i32 get_text_width_async(u8 font_variant, s8 text) {
+  if (!is_worker_text(text)) return get_text_width(font_variant, text);
+  TextRun *run = get_shaped_text_run_async(font_variant, text);
+  if (run != 0) return run->width;
+  return (i32)(get_sample_advance(font_variant, text) * text.length);
+}
+
+// Returns the height of a text block at a maximum width, or an estimate while a large text is being wrapped
+i32 get_text_block_height_async(u8 font_variant, s8 text, i32 max_width) {
+  if (!is_worker_text(text) || max_width == 0) return get_text_block_height(font_variant, text, max_width);
+  TextRun *run = get_text_run_async(font_variant, text, max_width);
+  if (run != 0 && run->lines != 0 && run->wrap_width == max_width) {
+    return get_text_lines_height(font_variant, array_length(run->lines));
+  }
+  return get_text_lines_height(font_variant, estimate_text_line_count(font_variant, text, max_width));
+}
+
+// Marks the elements that show the text as changed
+static void mark_text_elements(Element *element, u8 font_variant, s8 text) {
+  if (element == 0) return;
+  if (element->text.data != 0 && element->font_variant == font_variant && element->text.length == text.length &&
+      memcmp(element->text.data, text.data, text.length) == 0) {
+    element->changed = true;
+  }
+  if (element->children == 0) return;
+  for (i32 i = 0; i < array_length(element->children); i++) {
+    mark_text_elements(array_get(element->children, i), font_variant, text);
+  }
+}
+
+// Moves the finished layouts into the text run cache and marks the elements that show them as changed.
+// Returns true if any layout was applied, so that the tree is laid out again.
+bool apply_text_layouts(ElementTree *tree) {
+  if (text_worker.thread == 0) return false;
+  TextJob *done[TEXT_WORKER_MAX_JOBS];
+  SDL_LockMutex(text_worker.mutex);
+  i32 done_count = text_worker.done_count;
+  memcpy(done, text_worker.done, done_count * sizeof(TextJob *));
+  text_worker.done_count = 0;
+  SDL_UnlockMutex(text_worker.mutex);
+  for (i32 i = 0; i < done_count; i++) {
+    TextJob *job = done[i];
+    TextRun *run = add_text_run(&job->run);
+    mark_text_elements(tree->root, job->font_variant, run->text);
+    mark_text_elements(tree->overlay, job->font_variant, run->text);
+    // The cache owns the run now
+    free_text_job(job, false);
+    text_worker.completed++;
+  }
+  if (done_count > 0) {
+    tree->rerender = true;
+  }
+  return done_count > 0;
+}
+
+#define C9_TEXT_WORKER
+#endif
@@ -26,6 +26,7 @@ typedef struct {
 typedef struct {
   i32 start_index;
   i32 end_index;
+  i32 width; // Width of the line in pixels, rounded up
 } Line;
 
 #define C9_TYPES_COMMON
@@ -0,0 +1,204 @@
+#ifndef C9_VIRTUAL_LIST
+
+#include <SDL2/SDL.h> // SDL_DestroyTexture
+#include <stdbool.h> // bool
+#include "arena.c" // Arena
+#include "array.c" // Array, array_create, array_push, array_get, array_set, array_pop
+#include "element_tree.c" // Element, VirtualList, empty_element, add_new_element, free_textures, layout_direction, overflow_type
+#include "types.c" // i32, i64, u8
+
+/*
+
+A virtual list is an element that holds a very large number of rows without creating an Element for each of them. Only the rows that are visible (plus an overscan margin above and below) are materialized as children. The rows are stored in a fixed pool of child elements that is recycled while scrolling, so memory and layout cost only depend on the height of the list, not on the number of items.
+
+Rows are filled by the on_fill callback, which is called with the list, a recycled element and the item index it should show. The recycled element keeps its children array (cleared) and its texture, so the callback should add children with add_new_element instead of replacing the children array. Strings assigned to the row should be owned by the data source, as rows are refilled on every recycle. If recycle_rows is set, the row is passed to on_fill as it was left by the previous fill, so the callback can update existing children in place and keep their textures.
+
+Each row is bound to the pool slot item_index % pool_size. When scrolling one row, only the row that scrolls into view is refilled and the other rows keep their cached textures.
+
+The scroll position is stored in the virtual list as an i64, as the total height of the list can be much larger than the i32 range of LayoutProps.
+
+*/
+
+// Function pointer typedef for filling a virtual list row
+// The function takes the list, the recycled row element and the item index
+typedef void (*OnFillItem)(VirtualList *, Element *, i32);
+
+const i32 UNBOUND_ITEM_INDEX = -1;
+
+// Set by on_fill when a row has changed the width of its list, so that the tree is laid out again
+bool virtual_list_resized = false;
+
+struct VirtualList {
+  Arena *arena; // Arena used for the row pool
+  OnFillItem on_fill; // Fills a recycled row with the item at index
+  void *source; // Data source available to on_fill
+  Array *item_indexes; // Item index bound to each pool slot (i32)
+  i64 scroll_offset; // Distance from the top of the list in pixels
+  i32 item_count; // Total number of items in the list
+  i32 row_height; // Height of each row
+  i32 first_index; // First materialized item index
+  i32 pool_size; // Number of materialized rows
+  u8 overscan; // Extra rows materialized above and below the visible rows
+  bool recycle_rows; // If true, rows are not reset before on_fill
+};
+
+// Create a new virtual list and return a pointer to it
+VirtualList *new_virtual_list(Arena *arena, i32 item_count, i32 row_height, OnFillItem on_fill) {
+  VirtualList *list = arena_fill(arena, sizeof(VirtualList));
+  *list = (VirtualList){
+    .arena = arena,
+    .on_fill = on_fill,
+    .source = 0,
+    .item_indexes = array_create(arena, sizeof(i32)),
+    .scroll_offset = 0,
+    .item_count = item_count,
+    .row_height = row_height > 0 ? row_height : 1,
+    .first_index = 0,
+    .pool_size = 0,
+    .overscan = 2,
+    .recycle_rows = false,
+  };
+  return list;
+}
+
+// Marks all rows as unbound so that they are filled again on the next layout
+void refresh_virtual_list(VirtualList *list) {
+  for (i32 i = 0; i < array_length(list->item_indexes); i++) {
+    array_set(list->item_indexes, i, (void *)&UNBOUND_ITEM_INDEX);
+  }
+}
+
+// Changes the number of items and refills all rows
+void set_virtual_list_item_count(VirtualList *list, i32 item_count) {
+  list->item_count = item_count < 0 ? 0 : item_count;
+  refresh_virtual_list(list);
+}
+
+// Returns the distance between the top of two consecutive rows
+i32 get_virtual_row_stride(Element *element) {
+  return element->virtual_list->row_height + element->gutter;
+}
+
+// Returns the total height of all items in the list, without padding
+i64 get_virtual_list_height(Element *element) {
+  VirtualList *list = element->virtual_list;
+  if (list->item_count == 0) return 0;
+  return (i64)list->item_count * get_virtual_row_stride(element) - element->gutter;
+}
+
+// Returns the height available for rows inside the list element
+i32 get_virtual_list_viewport(Element *element) {
+  i32 viewport = element->layout.max_height - element->padding.top - element->padding.bottom;
+  return viewport > 0 ? viewport : 0;
+}
+
+// Keeps the scroll offset between the top and the bottom of the list
+void cap_virtual_list_scroll(Element *element) {
+  VirtualList *list = element->virtual_list;
+  i64 max_offset = get_virtual_list_height(element) - get_virtual_list_viewport(element);
+  if (list->scroll_offset > max_offset) {
+    list->scroll_offset = max_offset;
+  }
+  if (list->scroll_offset < 0) {
+    list->scroll_offset = 0;
+  }
+}
+
+// Resets a pool row and fills it with the item at index
+static void fill_virtual_row(VirtualList *list, Element *row, i32 index) {
+  if (list->recycle_rows) {
+    list->on_fill(list, row, index);
+    row->changed = true;
+    return;
+  }
+  // Keep the children array and texture of the recycled row
+  Array *children = row->children;
+  RenderProps render = row->render;
+  if (children != 0) {
+    for (i32 i = 0; i < array_length(children); i++) {
+      free_textures(array_get(children, i));
+    }
+    array_clear(children);
+  }
+  *row = empty_element;
+  row->children = children;
+  list->on_fill(list, row, index);
+  // Reuse the old texture unless the callback replaced it
+  if (row->render.texture == 0) {
+    row->render = render;
+  } else if (render.texture != 0 && render.texture != row->render.texture) {
+    SDL_DestroyTexture(render.texture);
+  }
+  row->changed = true;
+}
+
+// Binds the visible item range to the row pool and fills rows whose item has changed. Returns true if any row was filled.
+bool materialize_virtual_list(Element *element) {
+  VirtualList *list = element->virtual_list;
+  // Rows are always stacked vertically and scrolled by the list itself
+  element->layout_direction = layout_direction.vertical;
+  element->overflow = overflow_type.scroll_y;
+  if (element->children == 0) {
+    element->children = array_create_width(list->arena, sizeof(Element), 4);
+  }
+  cap_virtual_list_scroll(element);
+
+  i32 stride = get_virtual_row_stride(element);
+  i32 visible_rows = get_virtual_list_viewport(element) / stride + 2;
+  i32 pool_size = visible_rows + 2 * list->overscan;
+  if (pool_size > list->item_count) {
+    pool_size = list->item_count;
+  }
+
+  // Resize the pool if the viewport or item count has changed
+  if (pool_size != list->pool_size) {
+    while (array_length(element->children) > pool_size) {
+      Element *row = array_pop(element->children);
+      free_textures(row);
+    }
+    while (array_length(element->children) < pool_size) {
+      add_new_element(list->arena, element);
+    }
+    array_clear(list->item_indexes);
+    for (i32 i = 0; i < pool_size; i++) {
+      array_push(list->item_indexes, (void *)&UNBOUND_ITEM_INDEX);
+    }
+    list->pool_size = pool_size;
+  }
+  if (pool_size == 0) {
+    list->first_index = 0;
+    return false;
+  }
+
+  // First row, including overscan, kept so that the whole pool is in range
+  i32 first_index = (i32)(list->scroll_offset / stride) - list->overscan;
+  if (first_index > list->item_count - pool_size) {
+    first_index = list->item_count - pool_size;
+  }
+  if (first_index < 0) {
+    first_index = 0;
+  }
+  list->first_index = first_index;
+
+  bool filled = false;
+  for (i32 index = first_index; index < first_index + pool_size; index++) {
+    i32 slot = index % pool_size;
+    i32 *bound_index = array_get(list->item_indexes, slot);
+    if (*bound_index != index) {
+      fill_virtual_row(list, array_get(element->children, slot), index);
+      *bound_index = index;
+      filled = true;
+    }
+  }
+  return filled;
+}
+
+// Returns the pool row that shows the n:th materialized item, counted from first_index
+Element *get_virtual_row(Element *element, i32 order) {
+  VirtualList *list = element->virtual_list;
+  if (order < 0 || order >= list->pool_size) return 0;
+  return array_get(element->children, (list->first_index + order) % list->pool_size);
+}
+
+#define C9_VIRTUAL_LIST
+#endif
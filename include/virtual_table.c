@@ -0,0 +1,222 @@
+#ifndef C9_VIRTUAL_TABLE
+
+#include <stdbool.h> // bool
+#include "arena.c" // Arena, arena_fill
+#include "array.c" // Array, array_create, array_push, array_get, array_set, array_length
+#include "color.c" // RGBA
+#include "element_tree.c" // Element, add_new_element, layout_direction, overflow_type
+#include "font.c" // get_font_height, font_variant
+#include "string.c" // s8
+#include "text_run.c" // get_text_width
+#include "types.c" // i32, u8, u16
+#include "types_common.c" // Padding, Border
+#include "virtual_list.c" // VirtualList, new_virtual_list, refresh_virtual_list, set_virtual_list_item_count, virtual_list_resized
+
+/*
+
+A virtual table shows rows and columns from a data source without creating an Element for every cell. The table adds a header row and a virtual list to a parent element. The list only materializes the visible rows, and every row keeps one cell element per column that is updated in place when the row is recycled. This way the cell textures are reused while scrolling and only the text in them is redrawn.
+
+The cell text is read from the get_cell_text callback with a row index and a column index. The header row is read with the row index TABLE_HEADER_ROW. The returned strings must be null terminated and stay valid while they are shown, as they are not copied.
+
+Column widths are not measured on every layout. They are measured once from the header and a sample of the rows (the first rows and rows spread evenly over the rest of the table) and cached in column_widths. After that, the cells of every filled row are measured, and a column grows when a cell is wider than it. The header and the rows then get the new widths and the tree is laid out again (see virtual_list_resized). Columns never shrink while scrolling. Call measure_virtual_table_columns to measure them again after the data has changed.
+
+*/
+
+// Function pointer typedef for reading the text of a table cell
+// The function takes the row index and the column index
+typedef s8 (*OnCellText)(i32, i32);
+
+const i32 TABLE_HEADER_ROW = -1;
+
+typedef struct {
+  OnCellText get_cell_text; // Reads the text of a cell from the data source
+  Element *header; // Header row element
+  Element *list; // Element holding the virtual list of rows
+  Array *column_widths; // Cached width of each column including cell padding (i32)
+  i32 row_count; // Number of rows, not counting the header
+  i32 column_count; // Number of columns
+  u16 sample_count; // Number of rows measured when sizing columns
+  Padding cell_padding; // Padding inside each cell
+  u8 font_variant; // Font of the cells
+  u8 header_font_variant; // Font of the header cells
+  RGBA text_color; // Text color of all cells
+  RGBA border_color; // Color of the line below the header
+} VirtualTable;
+
+// Returns the width of a cell text including the cell padding
+static i32 get_table_cell_width(VirtualTable *table, s8 text, u8 variant) {
+  i32 text_width = 0;
+  if (text.data != 0) {
+    text_width = get_text_width(variant, text);
+  }
+  // Add 1 for the cursor like fill_scroll_width
+  return text_width + 1 + table->cell_padding.left + table->cell_padding.right;
+}
+
+// Returns the text width of a cell including the cell padding
+static i32 measure_table_cell(VirtualTable *table, i32 row, i32 column, u8 variant) {
+  return get_table_cell_width(table, table->get_cell_text(row, column), variant);
+}
+
+// Sets the cached column widths on all cells of a row
+static void set_table_row_widths(VirtualTable *table, Element *row) {
+  if (row->children == 0) return;
+  for (i32 column = 0; column < array_length(row->children); column++) {
+    Element *cell = array_get(row->children, column);
+    i32 *width = array_get(table->column_widths, column);
+    if (cell->width != *width) {
+      cell->width = *width;
+      cell->changed = true;
+      row->changed = true;
+    }
+  }
+}
+
+// Sets the width of the table from the cached column widths and updates the header and the materialized rows
+static void set_virtual_table_widths(VirtualTable *table) {
+  // Total width of the table so that it can scroll horizontally
+  i32 table_width = 0;
+  for (i32 column = 0; column < table->column_count; column++) {
+    i32 *width = array_get(table->column_widths, column);
+    table_width += *width;
+  }
+  table->header->width = table_width;
+  table->list->width = table_width + table->list->padding.left + table->list->padding.right;
+
+  set_table_row_widths(table, table->header);
+  for (i32 i = 0; table->list->children != 0 && i < array_length(table->list->children); i++) {
+    set_table_row_widths(table, array_get(table->list->children, i));
+  }
+}
+
+// Measures the header and a sample of the rows and caches the widest cell of each column
+void measure_virtual_table_columns(VirtualTable *table) {
+  for (i32 column = 0; column < table->column_count; column++) {
+    i32 width = measure_table_cell(table, TABLE_HEADER_ROW, column, table->header_font_variant);
+    array_set(table->column_widths, column, &width);
+  }
+
+  // Measure the first rows and then rows spread evenly over the rest of the table
+  i32 head_count = table->sample_count / 2;
+  if (head_count > table->row_count) {
+    head_count = table->row_count;
+  }
+  i32 spread_count = table->sample_count - head_count;
+  i32 spread_step = 1;
+  if (spread_count > 0 && table->row_count > head_count) {
+    spread_step = (table->row_count - head_count) / spread_count;
+    if (spread_step < 1) {
+      spread_step = 1;
+    }
+  }
+  i32 sampled = 0;
+  for (i32 row = 0; row < table->row_count && sampled < table->sample_count; sampled++) {
+    for (i32 column = 0; column < table->column_count; column++) {
+      i32 width = measure_table_cell(table, row, column, table->font_variant);
+      i32 *cached_width = array_get(table->column_widths, column);
+      if (width > *cached_width) {
+        *cached_width = width;
+      }
+    }
+    row += row < head_count ? 1 : spread_step;
+  }
+  set_virtual_table_widths(table);
+}
+
+// Creates the cell elements of a row
+static void add_table_cells(VirtualTable *table, Arena *arena, Element *row, u8 variant) {
+  row->layout_direction = layout_direction.horizontal;
+  for (i32 column = 0; column < table->column_count; column++) {
+    Element *cell = add_new_element(arena, row);
+    i32 *width = array_get(table->column_widths, column);
+    *cell = (Element){
+      .width = *width,
+      .padding = table->cell_padding,
+      .font_variant = variant,
+      .text_color = table->text_color,
+    };
+  }
+}
+
+// Fills a recycled row with the cells of the table row at index
+static void fill_virtual_table_row(VirtualList *list, Element *row, i32 index) {
+  VirtualTable *table = list->source;
+  // Cells are only created the first time a pool row is filled
+  if (row->children == 0 || array_length(row->children) != table->column_count) {
+    *row = empty_element;
+    row->height = list->row_height;
+    add_table_cells(table, list->arena, row, table->font_variant);
+  }
+  // Keep the widest cell of each column, so that rows filled after the sample are not clipped
+  bool widened = false;
+  for (i32 column = 0; column < table->column_count; column++) {
+    Element *cell = array_get(row->children, column);
+    cell->text = table->get_cell_text(index, column);
+    cell->changed = true;
+    i32 width = get_table_cell_width(table, cell->text, table->font_variant);
+    i32 *cached_width = array_get(table->column_widths, column);
+    if (width > *cached_width) {
+      *cached_width = width;
+      widened = true;
+    }
+  }
+  if (widened) {
+    set_virtual_table_widths(table);
+    virtual_list_resized = true;
+  }
+}
+
+// Adds a virtual table with a header row to the parent element and returns a pointer to it
+VirtualTable *new_virtual_table(Arena *arena, Element *parent, i32 row_count, i32 column_count, OnCellText get_cell_text) {
+  VirtualTable *table = arena_fill(arena, sizeof(VirtualTable));
+  *table = (VirtualTable){
+    .get_cell_text = get_cell_text,
+    .column_widths = array_create(arena, sizeof(i32)),
+    .row_count = row_count,
+    .column_count = column_count,
+    .sample_count = 100,
+    .cell_padding = (Padding){6, 10, 6, 10},
+    .font_variant = font_variant.regular,
+    .header_font_variant = font_variant.bold,
+    .text_color = 0x000000FF,
+    .border_color = 0xDDDDDDFF,
+  };
+  i32 zero_width = 0;
+  for (i32 column = 0; column < column_count; column++) {
+    array_push(table->column_widths, &zero_width);
+  }
+
+  // The parent stacks the header above the list and scrolls both horizontally
+  parent->layout_direction = layout_direction.vertical;
+  parent->overflow = overflow_type.scroll_x;
+
+  i32 row_height = get_font_height(table->font_variant) + table->cell_padding.top + table->cell_padding.bottom;
+  table->header = add_new_element(arena, parent);
+  *table->header = (Element){
+    .height = get_font_height(table->header_font_variant) + table->cell_padding.top + table->cell_padding.bottom + 1,
+    .border = (Border){0, 0, 1, 0},
+    .border_color = table->border_color,
+  };
+  add_table_cells(table, arena, table->header, table->header_font_variant);
+  for (i32 column = 0; column < column_count; column++) {
+    Element *cell = array_get(table->header->children, column);
+    cell->text = get_cell_text(TABLE_HEADER_ROW, column);
+  }
+
+  table->list = add_new_element(arena, parent);
+  table->list->virtual_list = new_virtual_list(arena, row_count, row_height, &fill_virtual_table_row);
+  table->list->virtual_list->source = table;
+  table->list->virtual_list->recycle_rows = true;
+
+  measure_virtual_table_columns(table);
+  return table;
+}
+
+// Changes the number of rows and refills the visible rows. Column widths are kept.
+void set_virtual_table_row_count(VirtualTable *table, i32 row_count) {
+  table->row_count = row_count;
+  set_virtual_list_item_count(table->list->virtual_list, row_count);
+}
+
+#define C9_VIRTUAL_TABLE
+#endif
@@ -12,8 +12,10 @@
 #include "include/element_tree.c" // Element, ElementTree, new_element_tree, add_new_element, layout_direction, background_type, Border, Padding
 #include "include/event.c" // click_handler, blur_handler, input_handler, handle_events
 #include "include/font.c" // init_fonts, close_fonts
+#include "include/glyph_atlas.c" // init_accelerated_glyph_atlas, close_glyph_atlas
 #include "include/layout.c" // set_dimensions
 #include "include/renderer.c" // render_element_tree
+#include "include/text_worker.c" // init_text_worker, close_text_worker
 #include "include/types.c" // i32
 
 i32 main() {
@@ -64,6 +66,10 @@ i32 main() {
 
   // Initialize font
   if (init_fonts() == status.ERROR) return -1;
+  // Lay out large texts in the background
+  init_text_worker();
+  // Draw changing labels from a glyph atlas on accelerated renderers
+  init_accelerated_glyph_atlas(renderer);
 
   Arena *element_arena = arena_open(4096);
   // Root element
@@ -180,6 +186,7 @@ i32 main() {
   if (tree->target_texture) {
     SDL_DestroyTexture(tree->target_texture);
   }
+  close_glyph_atlas();
   if (renderer) {
     SDL_DestroyRenderer(renderer);
   }
@@ -191,6 +198,7 @@ i32 main() {
   // printf("Size of element_arena %d\n", arena_size(element_arena));
   free_textures(tree->root);
   arena_close(element_arena);
+  close_text_worker();
   close_fonts();
   SDL_Quit();
 
@@ -0,0 +1,191 @@
+#include <stdio.h> // printf, fopen, fwrite, fseek, ftell, fclose
+#include <stdlib.h> // atof, strtol
+#include <string.h> // memset, strcmp, strlen, strncpy
+#include "../include/arena.c" // Arena, arena_open, arena_fill, arena_close
+#include "../include/baked_fonts.c" // BakedFontsHeader, BakedFontRecord, BakedSizeRecord, BAKED_FONTS_MAGIC, BAKED_FONTS_VERSION
+#include "../include/font.c" // font_files, font_variants, add_font_variant, get_sft, close_fonts
+#include "../include/schrift.c" // SFT, SFT_BakedGlyph, sft_lookup, sft_font_hash, glyph_cache_get, GLYPH_CACHE_SUBPIXELS, COMMON_GLYPH_COUNT
+#include "../include/types.c" // i32, u8, u32, u64, f64
+
+/*
+
+Bakes the glyph bitmaps, metrics and kerning of fonts into a file that load_baked_fonts maps at startup (see include/baked_fonts.c). Every registered font variant is baked (the four defaults and the ones added with --font), and every glyph of the character ranges is rendered at the four quarter pixel offsets of the glyph cache, so the baked bitmaps are the ones the glyph cache would have rendered. Run from the repository root so that the fonts are found.
+
+```
+./bake_fonts fonts.baked
+./bake_fonts fonts.baked --font InterDisplay-Medium-Tiny.ttf 28 --range 32-126 --range 0x2013-0x2026
+```
+
+The default range is printable Latin-1 (32-126 and 160-255).
+
+*/
+
+#define MAX_RANGES 16
+
+typedef struct {
+  u32 first;
+  u32 last;
+} CodePointRange;
+
+CodePointRange ranges[MAX_RANGES] = {
+  {32, 126},
+  {160, 255},
+};
+i32 range_count = 2;
+
+// Writes a block at the next offset that is a multiple of 8 and returns the offset
+u64 write_block(FILE *file, const void *data, u64 size) {
+  u64 offset = (u64)ftell(file);
+  while (offset % 8 != 0) {
+    fputc(0, file);
+    offset++;
+  }
+  if (size > 0) {
+    fwrite(data, 1, size, file);
+  }
+  return offset;
+}
+
+// Renders the glyphs of the ranges at every subpixel offset and writes them with their index. Returns the size record.
+BakedSizeRecord write_size(FILE *file, Arena *arena, SFT *sft) {
+  SFT_Font *font = sft->font;
+  u32 index_count = font->numGlyphs * GLYPH_CACHE_SUBPIXELS;
+  u32 *glyph_index = arena_fill(arena, index_count * sizeof(u32));
+  SFT_BakedGlyph *glyphs = arena_fill(arena, index_count * sizeof(SFT_BakedGlyph));
+  memset(glyph_index, 0, index_count * sizeof(u32));
+  BakedSizeRecord record = {
+    .x_scale = sft->xScale,
+    .y_scale = sft->yScale,
+  };
+  // The pixels are written as the glyphs are rendered
+  record.pixels = write_block(file, 0, 0);
+  for (i32 r = 0; r < range_count; r++) {
+    for (u32 code_point = ranges[r].first; code_point <= ranges[r].last; code_point++) {
+      SFT_Glyph glyph;
+      if (sft_lookup(sft, code_point, &glyph) < 0 || glyph >= font->numGlyphs) continue;
+      for (i32 subpixel = 0; subpixel < GLYPH_CACHE_SUBPIXELS; subpixel++) {
+        u32 index = glyph * GLYPH_CACHE_SUBPIXELS + subpixel;
+        if (glyph_index[index] != 0) continue;
+        // Render through the glyph cache so that the bitmap is placed exactly like at runtime
+        SFT_CachedGlyph *cached = glyph_cache_get(sft, glyph, subpixel);
+        if (cached == 0) continue;
+        glyphs[record.glyph_count] = (SFT_BakedGlyph){
+          .left = cached->left,
+          .top = cached->top,
+          .width = cached->width,
+          .height = cached->height,
+          .pixels = record.pixel_bytes,
+        };
+        u32 pixel_bytes = cached->width * cached->height;
+        fwrite(cached->pixels, 1, pixel_bytes, file);
+        record.pixel_bytes += pixel_bytes;
+        glyph_index[index] = ++record.glyph_count;
+      }
+    }
+  }
+  record.glyph_index = write_block(file, glyph_index, index_count * sizeof(u32));
+  record.glyphs = write_block(file, glyphs, record.glyph_count * sizeof(SFT_BakedGlyph));
+  return record;
+}
+
+// Parses a range like 32-126 or 0x2013-0x2026
+bool parse_range(char *text, CodePointRange *range) {
+  char *end;
+  range->first = (u32)strtol(text, &end, 0);
+  if (*end != '-') return false;
+  range->last = (u32)strtol(end + 1, &end, 0);
+  return *end == 0 && range->first <= range->last;
+}
+
+i32 main(i32 argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: %s output [--font file size]... [--range first-last]...\n", argv[0]);
+    return -1;
+  }
+  // Replace the default ranges if any are given
+  bool custom_ranges = false;
+  for (i32 i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--font") == 0 && i + 2 < argc) {
+      add_font_variant(argv[i + 1], atof(argv[i + 2]));
+      i += 2;
+    } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+      if (!custom_ranges) {
+        range_count = 0;
+        custom_ranges = true;
+      }
+      if (range_count == MAX_RANGES || !parse_range(argv[i + 1], &ranges[range_count])) {
+        printf("Invalid range %s\n", argv[i + 1]);
+        return -1;
+      }
+      range_count++;
+      i += 1;
+    } else {
+      printf("Unknown argument %s\n", argv[i]);
+      return -1;
+    }
+  }
+  // Load every variant, which also loads its font file
+  for (u8 v = 0; v < font_variant_count; v++) {
+    if (get_sft(v) == 0) return -1;
+  }
+  // Keep every rendered glyph in the cache while baking
+  sft_glyph_cache_set_capacity(256 * 1024 * 1024);
+
+  FILE *file = fopen(argv[1], "wb");
+  if (file == 0) {
+    printf("Failed to open %s\n", argv[1]);
+    return -1;
+  }
+  Arena *arena = arena_open(64 * 1024);
+  BakedFontsHeader header = {
+    .magic = BAKED_FONTS_MAGIC,
+    .version = BAKED_FONTS_VERSION,
+    .font_count = font_file_count,
+  };
+  BakedFontRecord *records = arena_fill(arena, font_file_count * sizeof(BakedFontRecord));
+  memset(records, 0, font_file_count * sizeof(BakedFontRecord));
+  // The header and records are written again when the offsets are known
+  write_block(file, &header, sizeof(header));
+  write_block(file, records, font_file_count * sizeof(BakedFontRecord));
+
+  u64 glyph_total = 0;
+  u64 pixel_total = 0;
+  for (i32 f = 0; f < font_file_count; f++) {
+    SFT_Font *font = font_files[f].font;
+    BakedFontRecord *record = &records[f];
+    if (strlen(font_files[f].file_name) >= BAKED_FONT_NAME_LENGTH) {
+      printf("Font file name too long: %s\n", font_files[f].file_name);
+      return -1;
+    }
+    strncpy(record->file_name, font_files[f].file_name, BAKED_FONT_NAME_LENGTH - 1);
+    record->file_size = font->size;
+    record->file_hash = sft_font_hash(font);
+    record->glyph_count = font->numGlyphs;
+    record->kerning_slots = font->kernMask > 0 ? font->kernMask + 1 : 0;
+    record->common_glyphs = write_block(file, font->commonGlyphs, COMMON_GLYPH_COUNT * sizeof(u16));
+    record->advances = write_block(file, font->advances, font->numGlyphs * sizeof(u16));
+    record->kerning_keys = write_block(file, font->kernKeys, record->kerning_slots * sizeof(u32));
+    record->kerning_values = write_block(file, font->kernValues, record->kerning_slots * sizeof(i16));
+
+    BakedSizeRecord *sizes = arena_fill(arena, font_variant_count * sizeof(BakedSizeRecord));
+    for (u8 v = 0; v < font_variant_count; v++) {
+      if (font_variants[v].file != f) continue;
+      BakedSizeRecord size = write_size(file, arena, &font_variants[v].sft);
+      printf("%s %.0f: %u glyphs, %u bytes of bitmaps\n", font_files[f].file_name, size.y_scale, size.glyph_count, size.pixel_bytes);
+      glyph_total += size.glyph_count;
+      pixel_total += size.pixel_bytes;
+      sizes[record->size_count++] = size;
+    }
+    record->sizes = write_block(file, sizes, record->size_count * sizeof(BakedSizeRecord));
+  }
+  u64 file_size = write_block(file, 0, 0);
+  fseek(file, 0, SEEK_SET);
+  write_block(file, &header, sizeof(header));
+  write_block(file, records, font_file_count * sizeof(BakedFontRecord));
+  fclose(file);
+  printf("Baked %llu glyphs (%llu bytes of bitmaps) into %s, %llu bytes\n", (unsigned long long)glyph_total, (unsigned long long)pixel_total, argv[1], (unsigned long long)file_size);
+
+  arena_close(arena);
+  close_fonts();
+  return 0;
+}